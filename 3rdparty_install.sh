@@ -5,7 +5,7 @@ export CPP_STANDARD="17"
 export AVRO_VER="release-1.9.0"
 export AWS_SDK_VER="1.7.220"
 export GRPC_VER="v1.22.1"
-export LIBRDKAFKA_VER="v1.1.0"
+export LIBRDKAFKA_VER="v1.4.4"
 export PROMETHEUS_CPP_VER="v0.7.0"
 export RAPIDJSON_VER="v1.1.0"
 export NLOHMANN_JSON_VER="3.7.1"
@@ -0,0 +1,196 @@
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <avro/ValidSchema.hh>
+#include <kspp/avro/avro_fast_codec.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * one column of an avro_column_batch
+   * fixed width values (int, long, float, double, bool as uint8_t) are stored back to back in values<T>()
+   * strings and bytes are stored as size() + 1 offsets into a shared byte buffer
+   * nullable columns carry a validity bitmap, bit set == value present (arrow layout)
+   * null rows hold a zero value / an empty string
+   */
+  class avro_column {
+  public:
+    avro_column(std::string name, avro::Type type, bool nullable);
+
+    inline const std::string &name() const {
+      return _name;
+    }
+
+    inline avro::Type type() const {
+      return _type;
+    }
+
+    inline bool nullable() const {
+      return _nullable;
+    }
+
+    inline size_t size() const {
+      return _size;
+    }
+
+    inline bool is_variable_width() const {
+      return _type == avro::AVRO_STRING || _type == avro::AVRO_BYTES;
+    }
+
+    inline bool is_null(size_t row) const {
+      return _nullable && (_validity[row >> 3] & (1 << (row & 7))) == 0;
+    }
+
+    /**
+     * validity bitmap, nullptr for non nullable columns
+     */
+    inline const uint8_t *validity() const {
+      return _nullable ? _validity.data() : nullptr;
+    }
+
+    /**
+     * T must match the column type: int32_t, int64_t, float, double or uint8_t for bool
+     */
+    template<class T>
+    inline const T *values() const {
+      return reinterpret_cast<const T *>(_values.data());
+    }
+
+    inline const uint32_t *offsets() const {
+      return _offsets.data();
+    }
+
+    inline const char *bytes() const {
+      return _bytes.data();
+    }
+
+    inline std::string_view string_at(size_t row) const {
+      return std::string_view(_bytes.data() + _offsets[row], _offsets[row + 1] - _offsets[row]);
+    }
+
+    void reserve(size_t rows);
+
+    void clear();
+
+  private:
+    friend class avro_column_decoder;
+    friend class avro_column_batch;
+
+    void append_null();
+
+    void append_value(avro_fast::reader &r);
+
+    void set_valid(bool valid);
+
+    void truncate(size_t rows);
+
+    size_t value_size() const;
+
+    std::string _name;
+    avro::Type _type;
+    bool _nullable;
+    size_t _size = 0;
+    std::vector<uint8_t> _validity;
+    std::vector<uint8_t> _values;
+    std::vector<uint32_t> _offsets;
+    std::vector<char> _bytes;
+  };
+
+  /*
+   * rows of records sharing one writer schema, stored column by column
+   * created by avro_column_decoder, reuse the batch after clear() to keep the allocations
+   */
+  class avro_column_batch {
+  public:
+    inline size_t rows() const {
+      return _rows;
+    }
+
+    inline int32_t schema_id() const {
+      return _schema_id;
+    }
+
+    inline const std::vector<avro_column> &columns() const {
+      return _columns;
+    }
+
+    /**
+     * @return nullptr if there is no such column
+     */
+    const avro_column *column(const std::string &name) const;
+
+    void reserve(size_t rows);
+
+    void clear();
+
+  private:
+    friend class avro_column_decoder;
+
+    void truncate(size_t rows);
+
+    int32_t _schema_id = -1;
+    size_t _rows = 0;
+    std::vector<avro_column> _columns;
+  };
+
+  /*
+   * decodes confluent framed avro records written with one schema into an avro_column_batch
+   * top level primitive and nullable primitive fields become columns, other fields are skipped
+   */
+  class avro_column_decoder {
+  public:
+    /**
+     * throws std::invalid_argument if the writer schema is not a record
+     */
+    avro_column_decoder(std::shared_ptr<const avro::ValidSchema> writer_schema, int32_t schema_id);
+
+    inline std::shared_ptr<const avro::ValidSchema> writer_schema() const {
+      return _writer_schema;
+    }
+
+    inline int32_t schema_id() const {
+      return _schema_id;
+    }
+
+    /**
+     * an empty batch with one column per decoded field
+     */
+    std::shared_ptr<avro_column_batch> make_batch() const;
+
+    /**
+     * appends one confluent framed payload as a row
+     * @return false if the payload is corrupt or written with another schema id, the batch is left unchanged
+     */
+    bool append(const char *payload, size_t size, avro_column_batch &batch) const;
+
+    /**
+     * appends a range of payload holders that expose data() and size(), ie std::string or std::vector<uint8_t>
+     * @return number of rows appended
+     */
+    template<class ITER>
+    size_t append(ITER begin, ITER end, avro_column_batch &batch) const {
+      batch.reserve(batch.rows() + std::distance(begin, end));
+      size_t appended = 0;
+      for (ITER i = begin; i != end; ++i) {
+        if (append((const char *) i->data(), i->size(), batch))
+          ++appended;
+      }
+      return appended;
+    }
+
+  private:
+    struct step {
+      avro::NodePtr node; // writer node
+      int column;         // -1 == skip
+      size_t null_branch; // for nullable columns
+    };
+
+    std::shared_ptr<const avro::ValidSchema> _writer_schema;
+    const int32_t _schema_id;
+    std::vector<step> _steps;
+    std::vector<avro_column> _prototype;
+  };
+}
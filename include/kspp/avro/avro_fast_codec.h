@@ -0,0 +1,284 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/array.hpp>
+#include <avro/Exception.hh>
+#include <kspp/utils/output_buffer.h>
+#pragma once
+
+// avro floats and doubles are little endian on the wire and copied as is
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "avro_fast codecs requires a little endian host");
+
+namespace kspp {
+  /*
+   * straight line avro binary codecs for kspp_avrogencpp generated types
+   * specializations are generated with kspp_avrogencpp --fast-codec
+   */
+  template<class T>
+  struct avro_fast_codec_traits;
+
+  namespace avro_fast {
+    /*
+     * avro binary reader over a raw buffer - throws avro::Exception on truncated or corrupt data
+     */
+    class reader {
+    public:
+      enum { MAX_VARINT_SIZE = 10 };
+
+      reader(const uint8_t *data, size_t size)
+          : _begin(data), _p(data), _end(data + size) {
+      }
+
+      inline size_t consumed() const {
+        return _p - _begin;
+      }
+
+      inline int64_t read_long() {
+        uint64_t v = 0;
+        int shift = 0;
+        uint8_t b;
+        if (_end - _p >= MAX_VARINT_SIZE) {
+          // enough data for the longest varint - no bounds check per byte
+          do {
+            b = *_p++;
+            v |= (uint64_t) (b & 0x7f) << shift;
+            shift += 7;
+          } while ((b & 0x80) && shift < 7 * MAX_VARINT_SIZE);
+        } else {
+          do {
+            if (_p == _end)
+              throw avro::Exception("avro_fast: truncated varint");
+            b = *_p++;
+            v |= (uint64_t) (b & 0x7f) << shift;
+            shift += 7;
+          } while ((b & 0x80) && shift < 7 * MAX_VARINT_SIZE);
+        }
+        if (b & 0x80)
+          throw avro::Exception("avro_fast: varint too long");
+        return (int64_t) (v >> 1) ^ -(int64_t) (v & 1); // zigzag
+      }
+
+      inline int32_t read_int() {
+        int64_t v = read_long();
+        if (v < INT32_MIN || v > INT32_MAX)
+          throw avro::Exception("avro_fast: int out of range");
+        return (int32_t) v;
+      }
+
+      inline bool read_bool() {
+        return *consume(1) != 0;
+      }
+
+      inline float read_float() {
+        float v;
+        memcpy(&v, consume(sizeof(v)), sizeof(v));
+        return v;
+      }
+
+      inline double read_double() {
+        double v;
+        memcpy(&v, consume(sizeof(v)), sizeof(v));
+        return v;
+      }
+
+      inline size_t read_size() {
+        int64_t sz = read_long();
+        if (sz < 0)
+          throw avro::Exception("avro_fast: negative length");
+        return (size_t) sz;
+      }
+
+      inline void read_string(std::string &s) {
+        size_t sz = read_size();
+        s.assign((const char *) consume(sz), sz);
+      }
+
+      inline void read_bytes(std::vector<uint8_t> &v) {
+        size_t sz = read_size();
+        const uint8_t *p = consume(sz);
+        v.assign(p, p + sz);
+      }
+
+      inline void read_fixed(uint8_t *dst, size_t sz) {
+        memcpy(dst, consume(sz), sz);
+      }
+
+      inline void skip(size_t n) {
+        consume(n);
+      }
+
+      inline const uint8_t *position() const {
+        return _p;
+      }
+
+      /**
+       * item count of the next array / map block, 0 ends the array / map
+       */
+      inline size_t read_block_count() {
+        int64_t n = read_long();
+        if (n < 0) {
+          read_long(); // block size in bytes - not needed
+          n = -n;
+        }
+        return (size_t) n;
+      }
+
+    private:
+      inline const uint8_t *consume(size_t n) {
+        if ((size_t) (_end - _p) < n)
+          throw avro::Exception("avro_fast: truncated data");
+        const uint8_t *p = _p;
+        _p += n;
+        return p;
+      }
+
+      const uint8_t *_begin;
+      const uint8_t *_p;
+      const uint8_t *_end;
+    };
+
+    /*
+     * avro binary writer appending to an output_buffer
+     */
+    class writer {
+    public:
+      writer(output_buffer &buf)
+          : _buf(buf), _start(buf.size()) {
+      }
+
+      inline size_t written() const {
+        return _buf.size() - _start;
+      }
+
+      inline void write_long(int64_t v) {
+        uint64_t n = ((uint64_t) v << 1) ^ (uint64_t) (v >> 63); // zigzag
+        uint8_t *p = (uint8_t *) _buf.prepare(reader::MAX_VARINT_SIZE);
+        uint8_t *start = p;
+        while (n & ~0x7fULL) {
+          *p++ = (uint8_t) ((n & 0x7f) | 0x80);
+          n >>= 7;
+        }
+        *p++ = (uint8_t) n;
+        _buf.commit(p - start);
+      }
+
+      inline void write_int(int32_t v) {
+        write_long(v);
+      }
+
+      inline void write_bool(bool v) {
+        *_buf.prepare(1) = v ? 1 : 0;
+        _buf.commit(1);
+      }
+
+      inline void write_float(float v) {
+        write_raw(&v, sizeof(v));
+      }
+
+      inline void write_double(double v) {
+        write_raw(&v, sizeof(v));
+      }
+
+      inline void write_string(const std::string &s) {
+        write_long((int64_t) s.size());
+        write_raw(s.data(), s.size());
+      }
+
+      inline void write_bytes(const std::vector<uint8_t> &v) {
+        write_long((int64_t) v.size());
+        write_raw(v.data(), v.size());
+      }
+
+      inline void write_raw(const void *data, size_t sz) {
+        memcpy(_buf.prepare(sz), data, sz);
+        _buf.commit(sz);
+      }
+
+    private:
+      output_buffer &_buf;
+      const size_t _start;
+    };
+
+    inline void encode(writer &w, int32_t v) { w.write_int(v); }
+    inline void encode(writer &w, int64_t v) { w.write_long(v); }
+    inline void encode(writer &w, bool v) { w.write_bool(v); }
+    inline void encode(writer &w, float v) { w.write_float(v); }
+    inline void encode(writer &w, double v) { w.write_double(v); }
+    inline void encode(writer &w, const std::string &v) { w.write_string(v); }
+    inline void encode(writer &w, const std::vector<uint8_t> &v) { w.write_bytes(v); }
+
+    inline void decode(reader &r, int32_t &v) { v = r.read_int(); }
+    inline void decode(reader &r, int64_t &v) { v = r.read_long(); }
+    inline void decode(reader &r, bool &v) { v = r.read_bool(); }
+    inline void decode(reader &r, float &v) { v = r.read_float(); }
+    inline void decode(reader &r, double &v) { v = r.read_double(); }
+    inline void decode(reader &r, std::string &v) { r.read_string(v); }
+    inline void decode(reader &r, std::vector<uint8_t> &v) { r.read_bytes(v); }
+
+    // declared up front so nested containers find each other
+    template<class T> void encode(writer &w, const std::vector<T> &v);
+    template<class T> void decode(reader &r, std::vector<T> &v);
+    template<class T> void encode(writer &w, const std::map<std::string, T> &v);
+    template<class T> void decode(reader &r, std::map<std::string, T> &v);
+
+    template<size_t N>
+    inline void encode(writer &w, const boost::array<uint8_t, N> &v) { w.write_raw(v.data(), N); }
+
+    template<size_t N>
+    inline void decode(reader &r, boost::array<uint8_t, N> &v) { r.read_fixed(v.data(), N); }
+
+    // generated records, enums and unions
+    template<class T>
+    inline void encode(writer &w, const T &v) { avro_fast_codec_traits<T>::encode(w, v); }
+
+    template<class T>
+    inline void decode(reader &r, T &v) { avro_fast_codec_traits<T>::decode(r, v); }
+
+    template<class T>
+    inline void encode(writer &w, const std::vector<T> &v) {
+      if (v.size()) {
+        w.write_long((int64_t) v.size());
+        for (const auto &i : v)
+          encode(w, i);
+      }
+      w.write_long(0);
+    }
+
+    template<class T>
+    inline void decode(reader &r, std::vector<T> &v) {
+      v.clear();
+      for (size_t n = r.read_block_count(); n != 0; n = r.read_block_count()) {
+        size_t offset = v.size();
+        v.resize(offset + n);
+        for (size_t i = 0; i != n; ++i)
+          decode(r, v[offset + i]);
+      }
+    }
+
+    template<class T>
+    inline void encode(writer &w, const std::map<std::string, T> &v) {
+      if (v.size()) {
+        w.write_long((int64_t) v.size());
+        for (const auto &i : v) {
+          w.write_string(i.first);
+          encode(w, i.second);
+        }
+      }
+      w.write_long(0);
+    }
+
+    template<class T>
+    inline void decode(reader &r, std::map<std::string, T> &v) {
+      v.clear();
+      std::string key;
+      for (size_t n = r.read_block_count(); n != 0; n = r.read_block_count()) {
+        for (size_t i = 0; i != n; ++i) {
+          r.read_string(key);
+          decode(r, v[key]);
+        }
+      }
+    }
+  }
+}
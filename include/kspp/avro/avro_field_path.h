@@ -0,0 +1,143 @@
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <avro/Generic.hh>
+#include <avro/ValidSchema.hh>
+#include <kspp/avro/avro_utils.h>
+#include <kspp/avro/generic_avro.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * a field name or dotted path (ie "customer.address.zip") resolved to field indices for one schema
+   * nullable records (union of null and record) along the path are followed
+   */
+  class avro_field_path {
+  public:
+    avro_field_path(const avro::ValidSchema &schema, const std::string &path)
+        : _path(path) {
+      avro::NodePtr node = schema.root();
+      size_t begin = 0;
+      while (true) {
+        size_t end = path.find('.', begin);
+        std::string member = path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+        node = record_node(node);
+        size_t index = 0;
+        if (!node || !node->nameIndex(member, index))
+          throw std::invalid_argument(path + ": no such member: " + member);
+        _indices.push_back(index);
+        node = node->leafAt(index);
+        if (end == std::string::npos)
+          break;
+        begin = end + 1;
+      }
+    }
+
+    inline const std::string &path() const {
+      return _path;
+    }
+
+    inline const std::vector<size_t> &indices() const {
+      return _indices;
+    }
+
+    /**
+     * @return the field or nullptr if a record on the path is null
+     */
+    inline const avro::GenericDatum *find(const avro::GenericDatum &record) const {
+      const avro::GenericDatum *datum = &record;
+      for (size_t index : _indices) {
+        if (datum->type() != avro::AVRO_RECORD)
+          return nullptr;
+        datum = &datum->value<avro::GenericRecord>().fieldAt(index);
+      }
+      return datum;
+    }
+
+    inline avro::GenericDatum *find(avro::GenericDatum &record) const {
+      return const_cast<avro::GenericDatum *>(find(static_cast<const avro::GenericDatum &>(record)));
+    }
+
+    template<class T>
+    std::optional<T> get_optional(const generic_avro &src) const {
+      const avro::GenericDatum *datum = find(*src.generic_datum());
+      if (datum == nullptr || datum->type() == avro::AVRO_NULL)
+        return std::nullopt;
+      if (datum->type() == avro_utils::cpp_to_avro_type<T>())
+        return datum->value<T>();
+      throw std::invalid_argument(_path + ": wrong type, expected:" + avro_utils::to_string(avro_utils::cpp_to_avro_type<T>()) + ", actual: " + avro_utils::to_string(datum->type()));
+    }
+
+    template<class T>
+    T get(const generic_avro &src) const {
+      auto v = get_optional<T>(src);
+      if (!v)
+        throw std::invalid_argument(_path + ": is null");
+      return *v;
+    }
+
+  private:
+    static avro::NodePtr record_node(avro::NodePtr node) {
+      if (node && node->type() == avro::AVRO_SYMBOLIC)
+        node = avro::resolveSymbol(node);
+      if (node && node->type() == avro::AVRO_UNION) {
+        for (size_t i = 0; i != node->leaves(); ++i) {
+          auto leaf = node->leafAt(i);
+          if (leaf->type() == avro::AVRO_SYMBOLIC)
+            leaf = avro::resolveSymbol(leaf);
+          if (leaf->type() == avro::AVRO_RECORD)
+            return leaf;
+        }
+        return nullptr;
+      }
+      return (node && node->type() == avro::AVRO_RECORD) ? node : nullptr;
+    }
+
+    std::string _path;
+    std::vector<size_t> _indices;
+  };
+
+  /*
+   * a set of field paths that are compiled once per schema and then accessed by index
+   * schemas from the registry are shared per schema id so this is in effect a cache per schema id
+   * not thread safe - use one per consumer / producer
+   */
+  class avro_field_accessor {
+  public:
+    avro_field_accessor(std::vector<std::string> paths)
+        : _paths(std::move(paths)) {
+    }
+
+    inline const std::vector<std::string> &paths() const {
+      return _paths;
+    }
+
+    /**
+     * @return the compiled paths for schema, in the order given in the constructor
+     */
+    const std::vector<avro_field_path> &compile(std::shared_ptr<const avro::ValidSchema> schema) const {
+      if (schema.get() == _last_schema)
+        return *_last;
+      auto item = _compiled.find(schema.get());
+      if (item == _compiled.end()) {
+        std::vector<avro_field_path> v;
+        for (const auto &i : _paths)
+          v.emplace_back(*schema, i);
+        item = _compiled.emplace(schema.get(), std::make_pair(schema, std::move(v))).first;
+      }
+      _last_schema = schema.get();
+      _last = &item->second.second;
+      return *_last;
+    }
+
+  private:
+    const std::vector<std::string> _paths;
+    // the schema is kept so the address is not reused by another schema
+    mutable std::map<const avro::ValidSchema *, std::pair<std::shared_ptr<const avro::ValidSchema>, std::vector<avro_field_path>>> _compiled;
+    mutable const avro::ValidSchema *_last_schema = nullptr;
+    mutable const std::vector<avro_field_path> *_last = nullptr;
+  };
+}
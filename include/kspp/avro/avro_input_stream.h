@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <avro/Stream.hh>
+#pragma once
+
+namespace kspp {
+  /*
+   * avro input stream over a memory range that can be reset and reused - avoids the allocation in avro::memoryInputStream
+   */
+  class avro_input_stream : public avro::InputStream {
+  public:
+    void reset(const uint8_t *data, size_t size) {
+      _data = data;
+      _size = size;
+      _pos = 0;
+    }
+
+    bool next(const uint8_t **data, size_t *len) override {
+      if (_pos >= _size)
+        return false;
+      *data = _data + _pos;
+      *len = _size - _pos;
+      _pos = _size;
+      return true;
+    }
+
+    void backup(size_t len) override {
+      _pos -= len;
+    }
+
+    void skip(size_t len) override {
+      _pos = std::min(_size, _pos + len);
+    }
+
+    size_t byteCount() const override {
+      return _pos;
+    }
+
+  private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+    size_t _pos = 0;
+  };
+}
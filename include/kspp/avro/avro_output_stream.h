@@ -0,0 +1,44 @@
+#include <avro/Stream.hh>
+#include <kspp/utils/output_buffer.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * avro output stream that writes directly into an output_buffer - no intermediate chunks or snapshots
+   */
+  class avro_output_stream : public avro::OutputStream {
+  public:
+    enum { MIN_CHUNK_SIZE = 256 };
+
+    void reset(output_buffer *buf) {
+      _buf = buf;
+      _count = 0;
+    }
+
+    bool next(uint8_t **data, size_t *len) override {
+      uint8_t *p = (uint8_t *) _buf->prepare(MIN_CHUNK_SIZE);
+      size_t sz = _buf->spare();
+      _buf->commit(sz);
+      _count += sz;
+      *data = p;
+      *len = sz;
+      return true;
+    }
+
+    void backup(size_t len) override {
+      _buf->backup(len);
+      _count -= len;
+    }
+
+    uint64_t byteCount() const override {
+      return _count;
+    }
+
+    void flush() override {
+    }
+
+  private:
+    output_buffer *_buf = nullptr;
+    uint64_t _count = 0;
+  };
+}
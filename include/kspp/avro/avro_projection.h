@@ -0,0 +1,76 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <avro/Generic.hh>
+#include <avro/ValidSchema.hh>
+#include <kspp/avro/avro_fast_codec.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * decodes a subset of the top level fields of a record written with writer_schema
+   * fields not in the projection are skipped at the binary level and never materialized
+   * the result is a record of reader_schema() that holds the projected fields in the given order
+   */
+  class avro_projection {
+  public:
+    /**
+     * throws std::invalid_argument if a field does not exist or the writer schema is not a record
+     */
+    avro_projection(std::shared_ptr<const avro::ValidSchema> writer_schema, const std::vector<std::string> &fields);
+
+    inline std::shared_ptr<const avro::ValidSchema> writer_schema() const {
+      return _writer_schema;
+    }
+
+    inline std::shared_ptr<const avro::ValidSchema> reader_schema() const {
+      return _reader_schema;
+    }
+
+    /**
+     * dst must be created from reader_schema()
+     * throws avro::Exception on corrupt data
+     * @return number of bytes consumed
+     */
+    size_t decode(const uint8_t *data, size_t size, avro::GenericDatum &dst) const;
+
+    /**
+     * advances r past one value of node without materializing it
+     */
+    static void skip(avro_fast::reader &r, const avro::NodePtr &node);
+
+    /**
+     * follows a named type reference to its definition
+     */
+    static avro::NodePtr resolve(const avro::NodePtr &node);
+
+    /**
+     * string, bytes, int, long, float, double or bool
+     */
+    static bool is_primitive(avro::Type type);
+
+    /**
+     * true for a union of null and one primitive, ie ["null","string"]
+     * null_branch is set to the index of the null branch
+     */
+    static bool is_nullable_primitive(const avro::NodePtr &node, size_t &null_branch);
+
+  private:
+    enum step_kind { SKIP, NULLABLE, DIRECT, GENERIC };
+
+    struct step {
+      avro::NodePtr node; // writer node
+      step_kind kind;
+      size_t reader_index;
+      avro::Type type; // value type for DIRECT and NULLABLE
+      size_t null_branch;
+      std::shared_ptr<const avro::ValidSchema> schema; // for GENERIC
+    };
+
+    static void decode_primitive(avro_fast::reader &r, avro::Type type, avro::GenericDatum &dst);
+
+    std::shared_ptr<const avro::ValidSchema> _writer_schema;
+    std::shared_ptr<const avro::ValidSchema> _reader_schema;
+    std::vector<step> _steps;
+  };
+}
@@ -2,9 +2,11 @@
 #include <regex>
 #include <future>
 #include <memory>
+#include <functional>
 #include <avro/Schema.hh>
 #include <kspp/utils/http_client.h>
 #include <kspp/avro/confluent_http_proxy.h>
+#include <kspp/utils/concurrent_id_map.h>
 #pragma once
 
 namespace kspp {
@@ -15,6 +17,8 @@ namespace kspp {
     ~avro_schema_registry();
     bool validate();
     int32_t put_schema(std::string name, std::shared_ptr<const avro::ValidSchema> schema);
+    // cb is called from the registry thread with the schema id or -1 on failure
+    void put_schema(std::string name, std::shared_ptr<const avro::ValidSchema> schema, std::function<void(int32_t)> cb);
     std::shared_ptr<const avro::ValidSchema> get_schema(int32_t schema_id);
   private:
     boost::asio::io_service _ios;
@@ -22,7 +26,6 @@ namespace kspp {
     std::unique_ptr<boost::asio::io_service::work> _work;
     std::thread _thread;
     std::shared_ptr<confluent_http_proxy> _proxy;
-    kspp::spinlock _spinlock;
-    std::map<int32_t, std::shared_ptr<const avro::ValidSchema>> _cache;
+    concurrent_id_map<std::shared_ptr<const avro::ValidSchema>> _cache; // lock free lookups
   };
 } // kspp
\ No newline at end of file
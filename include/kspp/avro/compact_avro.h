@@ -0,0 +1,304 @@
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <avro/Generic.hh>
+#include <avro/ValidSchema.hh>
+#include <kspp/avro/avro_utils.h>
+#include <kspp/avro/avro_fast_codec.h>
+#include <kspp/avro/generic_avro.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * per schema layout of a compact_avro record - compiled once and shared between all records of the schema
+   */
+  class compact_avro_layout {
+  public:
+    enum field_kind {
+      SCALAR,   // primitive, stored in the slot (string and bytes inline in the arena)
+      NULLABLE, // union of null and a primitive
+      RAW       // anything else, kept as avro binary in the arena and decoded on demand
+    };
+
+    struct field {
+      std::string name;
+      field_kind kind;
+      avro::Type type;    // value type for SCALAR and NULLABLE, the writer type for RAW
+      size_t null_branch; // for NULLABLE
+      avro::NodePtr node; // writer node
+    };
+
+    /**
+     * throws std::invalid_argument if the schema is not a record
+     */
+    explicit compact_avro_layout(std::shared_ptr<const avro::ValidSchema> schema);
+
+    inline std::shared_ptr<const avro::ValidSchema> valid_schema() const {
+      return _schema;
+    }
+
+    inline const std::vector<field> &fields() const {
+      return _fields;
+    }
+
+    inline const std::string &name() const {
+      return _name;
+    }
+
+    /**
+     * @return false if there is no such member
+     */
+    bool field_index(const std::string &member, size_t &index) const;
+
+  private:
+    std::shared_ptr<const avro::ValidSchema> _schema;
+    std::string _name;
+    std::vector<field> _fields;
+  };
+
+  /*
+   * read only avro record stored in one contiguous arena
+   * the arena starts with one fixed size slot per top level field followed by the string, bytes and raw values
+   * decoding a record costs a single allocation, compared to one per field for generic_avro
+   * records decoded by the same avro_serdes share one compact_avro_layout per schema id
+   */
+  class compact_avro {
+  public:
+    struct slot {
+      union {
+        int32_t i;
+        int64_t l;
+        float f;
+        double d;
+        bool b;
+        struct {
+          uint32_t offset;
+          uint32_t size;
+        } ref; // string, bytes and raw values
+      } v;
+      avro::Type type; // AVRO_NULL for null values
+    };
+
+    class compact_record {
+    public:
+      compact_record(const compact_avro &record)
+          : record_(record) {
+      }
+
+      /**
+      * resolve a member name once and use the index based accessors per record
+      */
+      size_t field_index(const std::string &member) const {
+        size_t index = 0;
+        if (!record_._layout->field_index(member, index))
+          throw std::invalid_argument(name() + "." + member + ": no such member");
+        return index;
+      }
+
+      /**
+       * materializes a field as GenericDatum, ie for arrays, maps and nested records
+       */
+      avro::GenericDatum get_generic_datum(size_t index) const;
+
+      inline avro::GenericDatum get_generic_datum(const std::string &member) const {
+        return get_generic_datum(field_index(member));
+      }
+
+      template<class T>
+      T get(size_t index) const {
+        const slot &s = record_.slot_at(index);
+        if (s.type == avro_utils::cpp_to_avro_type<T>())
+          return value<T>(index, s);
+        throw std::invalid_argument(name() + "." + member_name(index) + ":  wrong type, expected:" + avro_utils::to_string(avro_utils::cpp_to_avro_type<T>()) + ", actual: " + avro_utils::to_string(s.type));
+      }
+
+      template<class T>
+      std::optional<T> get_optional(size_t index) const {
+        const slot &s = record_.slot_at(index);
+        if (s.type == avro::AVRO_NULL)
+          return std::nullopt;
+        if (s.type == avro_utils::cpp_to_avro_type<T>())
+          return value<T>(index, s);
+        throw std::invalid_argument(name() + "." + member_name(index) + ": wrong type, expected:" + avro_utils::to_string(avro_utils::cpp_to_avro_type<T>()) + ", actual: " + avro_utils::to_string(s.type));
+      }
+
+      inline bool is_null(size_t index) const {
+        return record_.slot_at(index).type == avro::AVRO_NULL;
+      }
+
+      template<class T>
+      T get(const std::string &member) const {
+        return get<T>(field_index(member));
+      }
+
+      template<class T>
+      std::optional<T> get_optional(const std::string &member) const {
+        return get_optional<T>(field_index(member));
+      }
+
+      template<class T>
+      T get(const std::string &member, const T &default_value) const {
+        size_t index = 0;
+        if (!record_._layout->field_index(member, index))
+          return default_value;
+        const slot &s = record_.slot_at(index);
+        if (s.type == avro_utils::cpp_to_avro_type<T>())
+          return value<T>(index, s);
+        if (s.type == avro::AVRO_NULL)
+          return default_value;
+        throw std::invalid_argument(name() + "." + member + ": wrong type, expected:" + avro_utils::to_string(avro_utils::cpp_to_avro_type<T>()) + ", actual: " + avro_utils::to_string(s.type));
+      }
+
+      std::optional<std::string> get_optional_as_string(const std::string &member) const;
+
+      bool is_null(const std::string &member) const {
+        return is_null(field_index(member));
+      }
+
+      std::vector<std::string> members() const {
+        std::vector<std::string> v;
+        for (const auto &f : record_._layout->fields())
+          v.push_back(f.name);
+        return v;
+      }
+
+      std::string name() const {
+        return record_._layout->name();
+      }
+
+    private:
+      inline const std::string &member_name(size_t index) const {
+        return record_._layout->fields()[index].name;
+      }
+
+      template<class T>
+      T value(size_t index, const slot &s) const {
+        if constexpr (std::is_same<T, int32_t>::value)
+          return s.v.i;
+        else if constexpr (std::is_same<T, int64_t>::value)
+          return s.v.l;
+        else if constexpr (std::is_same<T, float>::value)
+          return s.v.f;
+        else if constexpr (std::is_same<T, double>::value)
+          return s.v.d;
+        else if constexpr (std::is_same<T, bool>::value)
+          return s.v.b;
+        else if constexpr (std::is_same<T, std::string>::value)
+          return std::string((const char *) record_.bytes(s), s.v.ref.size);
+        else if constexpr (std::is_same<T, std::vector<uint8_t>>::value)
+          return std::vector<uint8_t>(record_.bytes(s), record_.bytes(s) + s.v.ref.size);
+        else
+          return get_generic_datum(index).value<T>();
+      }
+
+      const compact_avro &record_;
+    };
+
+    compact_avro()
+        : _schema_id(-1) {
+    }
+
+    /**
+     * throws std::invalid_argument if the schema is not a record
+     */
+    compact_avro(std::shared_ptr<const avro::ValidSchema> s, int32_t schema_id) {
+      create(s, schema_id);
+    }
+
+    /**
+     * an empty record with null / zero scalars - fill it with decode before encoding it
+     * compiles a new layout unless the record already has one for s
+     */
+    void create(std::shared_ptr<const avro::ValidSchema> s, int32_t schema_id);
+
+    /**
+     * as above with a layout shared by the caller, ie avro_serdes keeps one per schema id
+     */
+    void create(std::shared_ptr<const compact_avro_layout> layout, int32_t schema_id);
+
+    /**
+     * replaces the content with avro binary data written with valid_schema()
+     * throws avro::Exception on corrupt data
+     * @return number of bytes consumed
+     */
+    size_t decode(const uint8_t *data, size_t size);
+
+    /**
+     * writes the record as avro binary
+     */
+    void encode(avro_fast::writer &w) const;
+
+    void encode(avro::Encoder &e) const;
+
+    // compiles a layout for every call - use avro_serdes::decode per record
+    static compact_avro from_generic(const generic_avro &src);
+
+    generic_avro to_generic() const;
+
+    inline std::shared_ptr<const avro::ValidSchema> valid_schema() const {
+      return _layout ? _layout->valid_schema() : nullptr;
+    }
+
+    inline int32_t schema_id() const {
+      return _schema_id;
+    }
+
+    inline avro::Type type() const {
+      return avro::AVRO_RECORD;
+    }
+
+    /**
+     * bytes held by the arena
+     */
+    inline size_t arena_size() const {
+      return _arena.size();
+    }
+
+    compact_avro::compact_record record() const {
+      if (!_layout)
+        throw std::invalid_argument("compact_avro: not created");
+      return compact_avro::compact_record(*this);
+    }
+
+  private:
+    inline const slot &slot_at(size_t index) const {
+      if (index >= _layout->fields().size())
+        throw std::out_of_range("compact_avro: field index out of range");
+      return reinterpret_cast<const slot *>(_arena.data())[index];
+    }
+
+    inline const uint8_t *bytes(const slot &s) const {
+      return _arena.data() + s.v.ref.offset;
+    }
+
+    void append(slot &s, const uint8_t *data, size_t size);
+
+    std::shared_ptr<const compact_avro_layout> _layout;
+    std::vector<uint8_t> _arena;
+    int32_t _schema_id;
+  };
+}
+
+template <> struct avro::codec_traits<kspp::compact_avro> {
+  static void encode(avro::Encoder& e, const kspp::compact_avro& ca) {
+    ca.encode(e);
+  }
+};
+
+template<>
+inline std::string kspp:: avro_utils::avro_utils<kspp::compact_avro>::schema_name(const kspp::compact_avro& dummy){
+  return normalize(*dummy.valid_schema());
+}
+
+template<>
+inline std::string kspp:: avro_utils::avro_utils<kspp::compact_avro>::schema_as_string(const kspp::compact_avro& dummy){
+  return normalize(*dummy.valid_schema());
+}
+
+template<>
+inline std::shared_ptr<const avro::ValidSchema> kspp:: avro_utils::avro_utils<kspp::compact_avro>::valid_schema(const kspp::compact_avro& dummy){
+  return dummy.valid_schema();
+}
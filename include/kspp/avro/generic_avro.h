@@ -21,6 +21,42 @@ namespace kspp {
         return record_.field(member);
       }
 
+      /**
+      * resolve a member name once and use the index based accessors per record
+      */
+      size_t field_index(const std::string& member) const {
+        size_t index = 0;
+        if (!record_.schema()->nameIndex(member, index))
+          throw std::invalid_argument(name() + "." + member + ": no such member");
+        return index;
+      }
+
+      inline const avro::GenericDatum& get_generic_datum(size_t index) const {
+        return record_.fieldAt(index);
+      }
+
+      template<class T>
+      T get(size_t index) const {
+        const avro::GenericDatum &datum = record_.fieldAt(index);
+        if(datum.type() == avro_utils::cpp_to_avro_type<T>())
+          return datum.value<T>();
+        throw std::invalid_argument(name() + "." + record_.schema()->nameAt(index) + ":  wrong type, expected:" + avro_utils::to_string( avro_utils::cpp_to_avro_type<T>()) +  ", actual: " +  avro_utils::to_string(datum.type()));
+      }
+
+      template<class T>
+      std::optional<T> get_optional(size_t index) const {
+        const avro::GenericDatum &datum = record_.fieldAt(index);
+        if (datum.type() == avro::AVRO_NULL)
+          return std::nullopt;
+        if(datum.type() == avro_utils::cpp_to_avro_type<T>())
+          return datum.value<T>();
+        throw std::invalid_argument(name() + "." + record_.schema()->nameAt(index) + ": wrong type, expected:" + avro_utils::to_string(avro_utils::cpp_to_avro_type<T>()) +  ", actual: " +  avro_utils::to_string(datum.type()));
+      }
+
+      inline bool is_null(size_t index) const {
+        return record_.fieldAt(index).type() == avro::AVRO_NULL;
+      }
+
       std::vector<std::string> members() const {
         size_t sz = record_.schema()->names();
         std::vector<std::string> v;
@@ -2,12 +2,17 @@
 #include <chrono>
 #include <mutex>
 #include <memory>
+#include <map>
 #include <kspp/serdes/avro_serdes.h>
 #pragma once
 
 namespace kspp {
   class cluster_metadata;
   class avro_schema_registry;
+  class kafka_shared_consumer;
+  class worker_pool;
+  class memory_budget;
+  class kafka_mock_cluster;
 
   class cluster_config {
   public:
@@ -22,6 +27,13 @@ namespace kspp {
     void set_brokers(std::string uri);
     std::string get_brokers() const;
 
+    /**
+     * starts librdkafka mock brokers in process and uses them as brokers - for tests and benchmarks
+     * KSPP_KAFKA_MOCK_BROKERS=<nr of brokers> does the same from load_config_from_env()
+     */
+    void set_mock_cluster(size_t nr_of_brokers);
+    std::shared_ptr<kafka_mock_cluster> get_mock_cluster() const;
+
     std::string get_consumer_group() const;
 
     void set_consumer_buffering_time(std::chrono::milliseconds timeout);
@@ -62,6 +74,37 @@ namespace kspp {
     void set_fail_fast(bool state);
     bool get_fail_fast() const;
 
+    /**
+     * kafka sources with the same consumer group share one librdkafka consumer instead of one each
+     */
+    void set_shared_consumer(bool state);
+    bool get_shared_consumer() const;
+
+    std::shared_ptr<kafka_shared_consumer> shared_consumer(std::string consumer_group) const;
+
+    /**
+     * threads decoding kafka messages in parallel, shared by all kafka sources - 0 decodes on the consumer thread
+     * the codecs used by the sources must be thread safe
+     */
+    void set_decode_threads(size_t nr_of_threads);
+    size_t get_decode_threads() const;
+
+    std::shared_ptr<worker_pool> get_decode_pool() const;
+
+    /**
+     * payload bytes all sources together may read ahead of processing
+     */
+    void set_max_buffered_bytes(size_t bytes);
+    size_t get_max_buffered_bytes() const;
+
+    /**
+     * how much work, measured in processing time, each source reads ahead - bounded by max_buffered_bytes
+     */
+    void set_read_ahead_time(std::chrono::milliseconds);
+    std::chrono::milliseconds get_read_ahead_time() const;
+
+    std::shared_ptr<memory_budget> get_memory_budget() const;
+
     std::shared_ptr<cluster_metadata> get_cluster_metadata() const;
 
     void set_cluster_state_timeout(std::chrono::seconds);
@@ -92,15 +135,23 @@ namespace kspp {
     std::chrono::milliseconds producer_message_timeout_;
     std::chrono::milliseconds consumer_buffering_;
     std::chrono::milliseconds schema_registry_timeout_;
+    std::chrono::milliseconds read_ahead_time_;
     std::chrono::seconds cluster_state_timeout_;
     size_t max_pending_sink_messages_;
+    size_t decode_threads_;
+    size_t max_buffered_bytes_;
     std::string root_path_;
     std::string schema_registry_uri_;
     std::string pushgateway_uri_;
 
     bool fail_fast_;
+    bool shared_consumer_;
     mutable std::shared_ptr<cluster_metadata> meta_data_;
     mutable std::shared_ptr<kspp::avro_schema_registry> avro_schema_registry_;
     mutable std::shared_ptr<kspp::avro_serdes> avro_serdes_;
+    mutable std::map<std::string, std::weak_ptr<kafka_shared_consumer>> shared_consumers_;
+    mutable std::shared_ptr<worker_pool> decode_pool_;
+    mutable std::shared_ptr<memory_budget> memory_budget_;
+    std::shared_ptr<kafka_mock_cluster> mock_cluster_;
   };
 }
\ No newline at end of file
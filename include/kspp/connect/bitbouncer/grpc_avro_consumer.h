@@ -7,6 +7,7 @@
 #include <kspp/avro/generic_avro.h>
 #include <kspp/utils/offset_storage_provider.h>
 #include <kspp/internal/commit_chain.h>
+#include <kspp/utils/memory_budget.h>
 #include <bb_streaming.grpc.pb.h>
 #include "grpc_avro_schema_resolver.h"
 #include "grpc_avro_serdes.h"
@@ -24,8 +25,10 @@ namespace kspp {
                             std::shared_ptr<offset_storage> offset_store,
                             std::shared_ptr<grpc::Channel> channel,
                             std::string api_key,
-                            std::string secret_access_key)
-        : offset_storage_(offset_store), topic_name_(topic_name), partition_(partition), commit_chain_(topic_name, partition), bg_([this]() { _thread(); }), channel_(channel), api_key_(api_key), secret_access_key_(secret_access_key) {
+                            std::string secret_access_key,
+                            std::shared_ptr<memory_budget> budget,
+                            std::chrono::milliseconds read_ahead_time)
+        : offset_storage_(offset_store), topic_name_(topic_name), partition_(partition), commit_chain_(topic_name, partition), bg_([this]() { _thread(); }), channel_(channel), api_key_(api_key), secret_access_key_(secret_access_key), read_ahead_(budget, read_ahead_time) {
     }
 
     virtual ~grpc_avro_consumer_base() {
@@ -71,6 +74,11 @@ namespace kspp {
       return incomming_msg_;
     };
 
+    // called by the owner for events popped from queue()
+    inline read_ahead_buffer &read_ahead() {
+      return read_ahead_;
+    }
+
     void commit(bool flush) {
       int64_t offset = commit_chain_.last_good_offset();
       if (offset > 0 && offset_storage_)
@@ -116,8 +124,8 @@ namespace kspp {
         bitbouncer::streaming::SubscriptionBundle reply;
 
         while (!exit_) {
-          //backpressure
-          if (incomming_msg_.size() > 50000) {
+          // read ahead limit or memory budget reached - back off and let the consumers work
+          if (read_ahead_.full()) {
             std::this_thread::sleep_for(100ms);
             continue;
           }
@@ -143,6 +151,7 @@ namespace kspp {
             auto e = std::make_shared<kevent<K, V>>(krec, commit_chain_.create(record.offset()));
             assert(e.get() != nullptr);
             ++msg_cnt_;
+            read_ahead_.add(1, record.key().size() + record.value().size());
             incomming_msg_.push_back(e);
           }
           eof_ = reply.eof();
@@ -200,6 +209,7 @@ namespace kspp {
     std::string api_key_;
     std::string secret_access_key_;
     std::unique_ptr<grpc_avro_serdes> serdes_;
+    read_ahead_buffer read_ahead_;
   };
 
   template<class K, class V>
@@ -210,8 +220,10 @@ namespace kspp {
                        std::shared_ptr<offset_storage> offset_store,
                        std::shared_ptr<grpc::Channel> channel,
                        std::string api_key,
-                       std::string secret_access_key)
-        : grpc_avro_consumer_base<K, V>(partition, topic_name, offset_store, channel, api_key, secret_access_key) {
+                       std::string secret_access_key,
+                       std::shared_ptr<memory_budget> budget,
+                       std::chrono::milliseconds read_ahead_time)
+        : grpc_avro_consumer_base<K, V>(partition, topic_name, offset_store, channel, api_key, secret_access_key, budget, read_ahead_time) {
     }
 
     virtual ~grpc_avro_consumer() {
@@ -252,8 +264,10 @@ namespace kspp {
                        std::shared_ptr<offset_storage> offset_store,
                        std::shared_ptr<grpc::Channel> channel,
                        std::string api_key,
-                       std::string secret_access_key)
-        : grpc_avro_consumer_base<kspp::generic_avro, V>(partition, topic_name, offset_store, channel, api_key, secret_access_key) {
+                       std::string secret_access_key,
+                       std::shared_ptr<memory_budget> budget,
+                       std::chrono::milliseconds read_ahead_time)
+        : grpc_avro_consumer_base<kspp::generic_avro, V>(partition, topic_name, offset_store, channel, api_key, secret_access_key, budget, read_ahead_time) {
     }
 
     virtual ~grpc_avro_consumer() {
@@ -297,8 +311,10 @@ namespace kspp {
                        std::shared_ptr<offset_storage> offset_store,
                        std::shared_ptr<grpc::Channel> channel,
                        std::string api_key,
-                       std::string secret_access_key)
-        : grpc_avro_consumer_base<K, void>(partition, topic_name, offset_store, channel, api_key, secret_access_key) {
+                       std::string secret_access_key,
+                       std::shared_ptr<memory_budget> budget,
+                       std::chrono::milliseconds read_ahead_time)
+        : grpc_avro_consumer_base<K, void>(partition, topic_name, offset_store, channel, api_key, secret_access_key, budget, read_ahead_time) {
     }
 
     std::shared_ptr<kspp::krecord<K, void>> decode(const bitbouncer::streaming::SubscriptionData &record) override {
@@ -321,8 +337,10 @@ namespace kspp {
                        std::shared_ptr<offset_storage> offset_store,
                        std::shared_ptr<grpc::Channel> channel,
                        std::string api_key,
-                       std::string secret_access_key)
-        : grpc_avro_consumer_base<void, V>(partition, topic_name, offset_store, channel, api_key, secret_access_key) {
+                       std::string secret_access_key,
+                       std::shared_ptr<memory_budget> budget,
+                       std::chrono::milliseconds read_ahead_time)
+        : grpc_avro_consumer_base<void, V>(partition, topic_name, offset_store, channel, api_key, secret_access_key, budget, read_ahead_time) {
     }
 
     virtual ~grpc_avro_consumer() {
@@ -20,7 +20,14 @@ namespace kspp {
                           std::string api_key,
                           std::string secret_access_key)
         : partition_source<K, V>(nullptr, partition)
-        , _impl(partition, topic, offset_store, channel, api_key, secret_access_key) {
+        , _impl(partition, topic, offset_store, channel, api_key, secret_access_key, config->get_memory_budget(), config->get_read_ahead_time())
+        , _memory_budget(config->get_memory_budget())
+        , _buffered_bytes("buffered_bytes", "bytes")
+        , _read_ahead_limit("read_ahead_limit", "bytes")
+        , _memory_budget_used("memory_budget_used", "bytes") {
+      this->add_metric(&_buffered_bytes);
+      this->add_metric(&_read_ahead_limit);
+      this->add_metric(&_memory_budget_used);
     }
 
     virtual ~grpc_avro_source() {
@@ -69,19 +76,21 @@ namespace kspp {
     }
 
     size_t process(int64_t tick) override {
-      if (_impl.queue().size() == 0)
-        return 0;
       size_t processed = 0;
       while (!_impl.queue().empty()) {
         auto p = _impl.queue().front();
         if (p == nullptr || p->event_time() > tick)
-          return processed;
+          break;
         _impl.queue().pop_front();
         this->send_to_sinks(p);
         ++(this->_processed_count);
         ++processed;
         this->_lag.add_event_time(tick, p->event_time());
       }
+      _impl.read_ahead().remove(processed);
+      _buffered_bytes.set(_impl.read_ahead().bytes());
+      _read_ahead_limit.set(_impl.read_ahead().limit());
+      _memory_budget_used.set(_memory_budget->used());
       return processed;
     }
 
@@ -91,6 +100,10 @@ namespace kspp {
 
   protected:
     grpc_avro_consumer<K, V> _impl;
+    std::shared_ptr<memory_budget> _memory_budget;
+    metric_gauge _buffered_bytes;
+    metric_gauge _read_ahead_limit;
+    metric_gauge _memory_budget_used;
   };
 }
 
@@ -1,6 +1,7 @@
 #include <avro/Generic.hh>
 #include <avro/Schema.hh>
 #include <kspp/avro/generic_avro.h>
+#include <kspp/avro/avro_field_path.h>
 #pragma once
 
 namespace kspp {
@@ -11,6 +12,8 @@ namespace kspp {
   std::string avro_2_raw_column_value(const avro::GenericDatum &column);
 
   std::string avro2elastic_key_values(const avro::ValidSchema &schema, const std::string &key, const avro::GenericDatum &datum);
+  // key compiled once per schema with avro_field_accessor
+  std::string avro2elastic_key_values(const avro_field_path &key, const avro::GenericDatum &datum);
   std::string avro2elastic_json(const avro::ValidSchema &schema, const avro::GenericDatum &datum);
 
   class avro2elastic_IsChars {
@@ -2,6 +2,7 @@
 #include <avro/Generic.hh>
 #include <avro/Schema.hh>
 #include <kspp/avro/generic_avro.h>
+#include <kspp/avro/avro_field_path.h>
 
 #pragma once
 
@@ -67,6 +68,11 @@ namespace kspp {
     //std::vector<std::shared_ptr<avro::GenericDatum>> to_avro(std::shared_ptr<avro::ValidSchema> schema, const PGresult *res);
     void load_avro_by_name(kspp::generic_avro *avro, PGresult *pgres, size_t row);
 
+    // the pg column of each field in schema - resolve once per result and use for every row
+    std::vector<int> column_indices(const avro::ValidSchema &schema, const PGresult *pgres);
+
+    void load_avro_by_name(kspp::generic_avro *avro, PGresult *pgres, size_t row, const std::vector<int> &columns);
+
     //by index - order in schema and res must match
     //std::vector<std::shared_ptr<avro::GenericDatum>> to_avro(std::shared_ptr<avro::ValidSchema> schema, const PGresult *res);
     //by name - the names in schema must match those in res, used for extraction of key's
@@ -90,6 +96,8 @@ namespace kspp {
 
     std::string avro2sql_key_values(const avro::ValidSchema &schema, const std::vector<std::string> &keys, const avro::GenericDatum &datum);
 
+    std::string avro2sql_key_values(const std::vector<avro_field_path> &keys, const avro::GenericDatum &datum);
+
     std::string avro2sql_delete_key_values(const avro::ValidSchema &schema,  const std::vector<std::string> &keys, const avro::GenericDatum &datum);
   } // namespace pq
 } // namespace kspp
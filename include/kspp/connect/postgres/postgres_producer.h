@@ -4,6 +4,7 @@
 #include <kspp/connect/postgres/postgres_connection.h>
 #include <kspp/topology.h>
 #include <kspp/connect/generic_producer.h>
+#include <kspp/avro/avro_field_path.h>
 #pragma once
 
 namespace kspp {
@@ -70,6 +71,7 @@ namespace kspp {
     const kspp::connect::connection_params cp_;
 
     const std::vector<std::string> _id_columns;
+    kspp::avro_field_accessor _id_accessor; // _id_columns resolved per schema
     const std::string _client_encoding;
 
     event_queue<kspp::generic_avro, kspp::generic_avro> _incomming_msg;
@@ -73,7 +73,8 @@ namespace kspp {
     int64_t parse_ts(DBPROCESS *stream);
     int64_t parse_id(DBPROCESS *stream);
 
-    static void load_avro_by_name(kspp::generic_avro* avro, DBPROCESS *stream, COL *columns); // COL should go away
+    // src_columns is resolved on first use and reused for the rest of the result set
+    static void load_avro_by_name(kspp::generic_avro* avro, DBPROCESS *stream, COL *columns, std::vector<int>& src_columns); // COL should go away
 
     int parse_row(DBPROCESS* stream, COL* columns);
     int parse_response(DBPROCESS* stream);
@@ -100,6 +101,8 @@ namespace kspp {
     std::shared_ptr<avro::ValidSchema> _val_schema;
     std::shared_ptr<avro::ValidSchema> _key_schema;
     std::unique_ptr<kspp::generic_avro> _last_key;
+    std::vector<int> _key_columns; // result set column of each key field
+    std::vector<int> _val_columns; // result set column of each value field
     int32_t _key_schema_id;
     int32_t _val_schema_id;
     event_queue<kspp::generic_avro, kspp::generic_avro> _incomming_msg;
@@ -1,4 +1,5 @@
 #include <deque>
+#include <vector>
 #include <memory>
 #include <cstdint>
 #include <kspp/utils/spinlock.h>
@@ -44,6 +45,20 @@ namespace kspp {
       }
     }
 
+    // takes the whole batch under one lock, leaves v empty
+    inline void push_back(std::vector<std::shared_ptr<kevent<K, V>>> &v) {
+      if (v.empty())
+        return;
+      spinlock::scoped_lock xxx(_spinlock);
+      {
+        if (_queue.size() == 0)
+          _next_event_time = v[0]->event_time();
+        for (auto &p : v)
+          _queue.push_back(std::move(p));
+      }
+      v.clear();
+    }
+
     // used for error handling
     inline void push_front(std::shared_ptr<kevent<K, V>> p) {
       if (p) {
@@ -0,0 +1,85 @@
+#include <cstdint>
+#include <cstring>
+#include <kspp/internal/hash/murmurhash2.h>
+#include <kspp/serdes/buffer_codec.h>
+#pragma once
+
+namespace kspp {
+  enum { PARTITION_HASH_SEED = 0x9747b28c };
+
+  /*
+   * MurmurHash2 over a sequence of pieces - same result as MurmurHash2 over the concatenation
+   * the total length must be known up front
+   */
+  class murmur2_stream {
+  public:
+    murmur2_stream(size_t total_len, uint32_t seed = PARTITION_HASH_SEED)
+        : _h(seed ^ (uint32_t) total_len) {
+    }
+
+    inline void add(const void *data, size_t len) {
+      const uint8_t *p = (const uint8_t *) data;
+      // complete a partial block from the last piece first
+      while (_tail_size && len) {
+        _tail[_tail_size++] = *p++;
+        --len;
+        if (_tail_size == 4) {
+          mix(_tail);
+          _tail_size = 0;
+        }
+      }
+      while (len >= 4) {
+        mix(p);
+        p += 4;
+        len -= 4;
+      }
+      while (len--)
+        _tail[_tail_size++] = *p++;
+    }
+
+    inline uint32_t finish() {
+      switch (_tail_size) {
+        case 3: _h ^= _tail[2] << 16;
+        case 2: _h ^= _tail[1] << 8;
+        case 1: _h ^= _tail[0];
+          _h *= M;
+      };
+      _h ^= _h >> 13;
+      _h *= M;
+      _h ^= _h >> 15;
+      return _h;
+    }
+
+  private:
+    enum : uint32_t { M = 0x5bd1e995 };
+
+    inline void mix(const uint8_t *p) {
+      uint32_t k;
+      memcpy(&k, p, 4);
+      k *= M;
+      k ^= k >> 24;
+      k *= M;
+      _h *= M;
+      _h ^= k;
+    }
+
+    uint32_t _h;
+    uint8_t _tail[4];
+    size_t _tail_size = 0;
+  };
+
+  /*
+   * partition hash of a key - MurmurHash2 of the bytes CODEC would encode the key to
+   * codecs specialize this for key types where the bytes can be hashed without encoding the key first,
+   * specializations must give the same hash as the generic version to keep partitioning compatible
+   */
+  template<class CODEC, class PK, class = void>
+  struct partition_hash_traits {
+    static uint32_t hash(const PK &key, CODEC &codec) {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(codec, key, key_buf);
+      return MurmurHash2(key_buf.data(), (int) ksize, PARTITION_HASH_SEED);
+    }
+  };
+}
@@ -0,0 +1,101 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <rocksdb/db.h>
+#include <rocksdb/statistics.h>
+#include <kspp/kspp.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * rocksdb internal statistics exported as store metrics
+   * the statistics object must be set in rocksdb::Options before the database(s) is opened
+   * rocksdb tickers are cumulative and exported as counters, properties are point in time and exported as gauges
+   */
+  struct rocksdb_metrics {
+    // a counter fed by the increase of a rocksdb ticker since the last update
+    struct ticker_counter {
+      ticker_counter(std::string what, std::string unit, uint32_t ticker)
+          : counter(what, unit)
+          , ticker(ticker) {
+      }
+
+      void update(const rocksdb::Statistics &statistics) {
+        uint64_t value = statistics.getTickerCount(ticker);
+        if (value > last)
+          counter += (double) (value - last);
+        last = value;
+      }
+
+      metric_counter counter;
+      const uint32_t ticker;
+      uint64_t last = 0;
+    };
+
+    rocksdb_metrics()
+        : statistics(rocksdb::CreateDBStatistics())
+        , block_cache_hits("rocksdb_block_cache_hits", "count", rocksdb::BLOCK_CACHE_HIT)
+        , block_cache_misses("rocksdb_block_cache_misses", "count", rocksdb::BLOCK_CACHE_MISS)
+        , bytes_read("rocksdb_bytes_read", "bytes", rocksdb::BYTES_READ)
+        , bytes_written("rocksdb_bytes_written", "bytes", rocksdb::BYTES_WRITTEN)
+        , compaction_bytes_read("rocksdb_compaction_bytes_read", "bytes", rocksdb::COMPACT_READ_BYTES)
+        , compaction_bytes_written("rocksdb_compaction_bytes_written", "bytes", rocksdb::COMPACT_WRITE_BYTES)
+        , stall_time("rocksdb_stall_time", "us", rocksdb::STALL_MICROS)
+        , running_compactions("rocksdb_running_compactions", "count")
+        , pending_compaction_bytes("rocksdb_pending_compaction_bytes", "bytes")
+        , delayed_write_rate("rocksdb_delayed_write_rate", "bytes/s")
+        , write_stopped("rocksdb_write_stopped", "bool") {
+    }
+
+    void add_metrics(processor *p) {
+      p->add_metric(&block_cache_hits.counter);
+      p->add_metric(&block_cache_misses.counter);
+      p->add_metric(&bytes_read.counter);
+      p->add_metric(&bytes_written.counter);
+      p->add_metric(&compaction_bytes_read.counter);
+      p->add_metric(&compaction_bytes_written.counter);
+      p->add_metric(&stall_time.counter);
+      p->add_metric(&running_compactions);
+      p->add_metric(&pending_compaction_bytes);
+      p->add_metric(&delayed_write_rate);
+      p->add_metric(&write_stopped);
+    }
+
+    void update(const std::vector<rocksdb::DB *> &dbs) {
+      block_cache_hits.update(*statistics);
+      block_cache_misses.update(*statistics);
+      bytes_read.update(*statistics);
+      bytes_written.update(*statistics);
+      compaction_bytes_read.update(*statistics);
+      compaction_bytes_written.update(*statistics);
+      stall_time.update(*statistics);
+      running_compactions.set(sum_property(dbs, "rocksdb.num-running-compactions"));
+      pending_compaction_bytes.set(sum_property(dbs, "rocksdb.estimate-pending-compaction-bytes"));
+      delayed_write_rate.set(sum_property(dbs, "rocksdb.actual-delayed-write-rate"));
+      write_stopped.set(sum_property(dbs, "rocksdb.is-write-stopped") ? 1 : 0);
+    }
+
+    static uint64_t sum_property(const std::vector<rocksdb::DB *> &dbs, const char *property) {
+      uint64_t sum = 0;
+      for (auto db : dbs) {
+        uint64_t value = 0;
+        if (db && db->GetIntProperty(property, &value))
+          sum += value;
+      }
+      return sum;
+    }
+
+    std::shared_ptr<rocksdb::Statistics> statistics;
+    ticker_counter block_cache_hits;
+    ticker_counter block_cache_misses;
+    ticker_counter bytes_read;
+    ticker_counter bytes_written;
+    ticker_counter compaction_bytes_read;
+    ticker_counter compaction_bytes_written;
+    ticker_counter stall_time;
+    metric_gauge running_compactions;
+    metric_gauge pending_compaction_bytes;
+    metric_gauge delayed_write_rate;
+    metric_gauge write_stopped;
+  };
+}
@@ -0,0 +1,38 @@
+#include <memory>
+#include <rocksdb/db.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * owns a rocksdb snapshot - keeps the database open until the last reader is done
+   */
+  class rocksdb_snapshot_handle {
+  public:
+    rocksdb_snapshot_handle(std::shared_ptr<rocksdb::DB> db)
+        : _db(db)
+        , _snapshot(db->GetSnapshot()) {
+    }
+
+    ~rocksdb_snapshot_handle() {
+      _db->ReleaseSnapshot(_snapshot);
+    }
+
+    rocksdb_snapshot_handle(const rocksdb_snapshot_handle &) = delete;
+
+    rocksdb_snapshot_handle &operator=(const rocksdb_snapshot_handle &) = delete;
+
+    inline rocksdb::DB *db() const {
+      return _db.get();
+    }
+
+    inline rocksdb::ReadOptions read_options() const {
+      rocksdb::ReadOptions options;
+      options.snapshot = _snapshot;
+      return options;
+    }
+
+  private:
+    std::shared_ptr<rocksdb::DB> _db;
+    const rocksdb::Snapshot *_snapshot;
+  };
+}
@@ -1,9 +1,10 @@
 #include <boost/uuid/uuid.hpp>
 #include <ostream>
 #include <istream>
-#include <strstream>
 #include <vector>
 #include <typeinfo>
+#include <kspp/serdes/buffer_codec.h>
+#include <kspp/internal/hash/partition_hash.h>
 #pragma once
 
 namespace kspp {
@@ -22,6 +23,10 @@ namespace kspp {
       return 0;
     }
 
+    template<class T>
+    void register_schema_async(std::string name, const T& dummy){
+    }
+
     template<class T>
     size_t encode(const T& src, std::ostream& dst) {
       static_assert(fake_dependency<T>::value, "you must use specialization to provide a encode for T");
@@ -38,16 +43,65 @@ namespace kspp {
       return sz;
     }
 
+    /*
+     * buffer based encoding of the built in types - no stream state involved
+     * exact types only so an enum or short is not silently written as an int32_t
+     * user types that only specialize the stream interface are adapted through codec_encode
+     */
+    template<class T, enable_if_one_of<T, std::string> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      uint32_t sz = (uint32_t) src.size();
+      char* p = dst.prepare(sizeof(uint32_t) + sz);
+      memcpy(p, &sz, sizeof(uint32_t));
+      memcpy(p + sizeof(uint32_t), src.data(), sz);
+      dst.commit(sizeof(uint32_t) + sz);
+      return sz + sizeof(uint32_t);
+    }
+
+    template<class T, enable_if_one_of<T, int64_t> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      return write_raw(&src, sizeof(int64_t), dst);
+    }
+
+    template<class T, enable_if_one_of<T, int32_t> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      return write_raw(&src, sizeof(int32_t), dst);
+    }
+
+    template<class T, enable_if_one_of<T, uint8_t> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      return write_raw(&src, sizeof(uint8_t), dst);
+    }
+
+    template<class T, enable_if_one_of<T, bool> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      char ch = src ? 0x01 : 0x00;
+      return write_raw(&ch, 1, dst);
+    }
+
+    template<class T, enable_if_one_of<T, boost::uuids::uuid> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      return write_raw(src.data, 16, dst);
+    }
+
     template<class T>
-    inline size_t decode(const char* payload, size_t size, T& dst) {
-      std::istrstream src(payload, size);
-      return decode(src, dst);
+    size_t encode(const std::vector<T>& v, output_buffer& dst) {
+      uint32_t vsz = (uint32_t) v.size();
+      size_t sz = write_raw(&vsz, sizeof(uint32_t), dst);
+      for (auto & i : v)
+        sz += codec_encode(*this, i, dst);
+      return sz;
     }
 
     template<class T>
-    inline size_t decode(const char* payload, size_t size, std::vector<T>& dst) {
-      std::istrstream src(payload, size);
-      return decode(src, dst);
+    inline size_t decode(const char* payload, size_t size, T& dst) {
+      input_buffer src(payload, size);
+      if constexpr (has_buffer_decode<binary_serdes, T>::value) {
+        return decode(src, dst);
+      } else {
+        std::istream is(&src);
+        return decode(is, dst);
+      }
     }
 
     template<class T>
@@ -71,6 +125,67 @@ namespace kspp {
       }
       return src.good() ? sz : 0;
     }
+
+    inline size_t decode(input_buffer& src, std::string& dst) {
+      uint32_t sz = 0;
+      if (!src.read(&sz, sizeof(uint32_t)) || sz > 1048576) // sanity (not more that 1 MB)
+        return 0;
+      const char* p = src.consume(sz);
+      if (p == nullptr)
+        return 0;
+      dst.assign(p, sz);
+      return sz + sizeof(uint32_t);
+    }
+
+    inline size_t decode(input_buffer& src, int64_t& dst) {
+      return src.read(&dst, sizeof(int64_t)) ? sizeof(int64_t) : 0;
+    }
+
+    inline size_t decode(input_buffer& src, int32_t& dst) {
+      return src.read(&dst, sizeof(int32_t)) ? sizeof(int32_t) : 0;
+    }
+
+    inline size_t decode(input_buffer& src, uint8_t& dst) {
+      return src.read(&dst, sizeof(uint8_t)) ? sizeof(uint8_t) : 0;
+    }
+
+    inline size_t decode(input_buffer& src, bool& dst) {
+      char ch = 0;
+      if (!src.read(&ch, 1))
+        return 0;
+      dst = (ch == 0x00) ? false : true;
+      return 1;
+    }
+
+    inline size_t decode(input_buffer& src, boost::uuids::uuid& dst) {
+      return src.read(dst.data, 16) ? 16 : 0;
+    }
+
+    template<class T>
+    inline size_t decode(input_buffer& src, std::vector<T>& dst) {
+      uint32_t len = 0;
+      if (!src.read(&len, sizeof(uint32_t)) || len > 1048576) // sanity (not more that 1 MB)
+        return 0;
+      size_t sz = 4;
+      dst.clear();
+      dst.reserve(len);
+      for (uint32_t i = 0; i != len; ++i) {
+        T t;
+        size_t item_sz = codec_decode(*this, src, t);
+        if (item_sz == 0)
+          return 0;
+        sz += item_sz;
+        dst.push_back(t);
+      }
+      return sz;
+    }
+
+  private:
+    static inline size_t write_raw(const void* src, size_t size, output_buffer& dst) {
+      memcpy(dst.prepare(size), src, size);
+      dst.commit(size);
+      return size;
+    }
   };
 
   template<> inline size_t binary_serdes::encode(const std::string& src, std::ostream& dst) {
@@ -148,5 +263,38 @@ namespace kspp {
     src.read((char*) dst.data, 16);
     return src.good() ? 16 : 0;
   }
+
+  // partition hashes straight from the key - same bytes as the encoders above
+  template<>
+  struct partition_hash_traits<binary_serdes, int64_t> {
+    static inline uint32_t hash(const int64_t& key, binary_serdes&) {
+      return MurmurHash2(&key, sizeof(int64_t), PARTITION_HASH_SEED);
+    }
+  };
+
+  template<>
+  struct partition_hash_traits<binary_serdes, int32_t> {
+    static inline uint32_t hash(const int32_t& key, binary_serdes&) {
+      return MurmurHash2(&key, sizeof(int32_t), PARTITION_HASH_SEED);
+    }
+  };
+
+  template<>
+  struct partition_hash_traits<binary_serdes, std::string> {
+    static inline uint32_t hash(const std::string& key, binary_serdes&) {
+      uint32_t sz = (uint32_t) key.size();
+      murmur2_stream h(sizeof(uint32_t) + sz);
+      h.add(&sz, sizeof(uint32_t));
+      h.add(key.data(), sz);
+      return h.finish();
+    }
+  };
+
+  template<>
+  struct partition_hash_traits<binary_serdes, boost::uuids::uuid> {
+    static inline uint32_t hash(const boost::uuids::uuid& key, binary_serdes&) {
+      return MurmurHash2(key.data, 16, PARTITION_HASH_SEED);
+    }
+  };
 }
 
@@ -21,6 +21,10 @@ class json_serdes
     return 0;
   }
 
+  template<class T>
+  void register_schema_async(std::string name, const T& dummy){
+  }
+
   template<class T>
   size_t encode(const T& src, std::ostream& dst) {
     static_assert(fake_dependency<T>::value, "you must use specialization to provide a encode for T");
@@ -2,12 +2,17 @@
 #include <string>
 #include <cstdint>
 #include <map>
+#include <vector>
 #include <librdkafka/rdkafkacpp.h>
 #include <kspp/kspp.h>
+#include <kspp/utils/output_buffer.h>
+#include <kspp/utils/spinlock.h>
 
 #pragma once
 
 namespace kspp {
+  struct producer_user_data;
+
   class kafka_producer
   {
 
@@ -22,9 +27,21 @@ namespace kspp {
 
     /**
     produce a message to partition -> (partition_hash % partition_cnt)
+    the partition is picked here from the partition count in cluster_metadata, librdkafka's partitioner is not involved
     */
     int produce(uint32_t partition_hash, memory_management_mode mode, void* key, size_t keysz, void* value, size_t valuesz, int64_t timestamp, std::shared_ptr<event_done_marker> autocommit_marker);
 
+    /**
+    encode targets of the next message - encode into them and call produce(partition_hash, timestamp, marker)
+    the buffers are handed to librdkafka without copying and reused when the message is delivered
+    a buffer that is not asked for is sent as null
+    */
+    output_buffer& key_buffer();
+
+    output_buffer& value_buffer();
+
+    int produce(uint32_t partition_hash, int64_t timestamp, std::shared_ptr<event_done_marker> autocommit_marker);
+
     inline std::string topic() const {
       return _topic;
     }
@@ -50,25 +67,27 @@ namespace kspp {
     }
 
   private:
-    class MyHashPartitionerCb : public RdKafka::PartitionerCb
-    {
-    public:
-      int32_t partitioner_cb(const RdKafka::Topic *topic, const std::string *key, int32_t partition_cnt, void *msg_opaque);
-    };
-
     // better to have a static config of nr of parititions
     class MyDeliveryReportCb : public RdKafka::DeliveryReportCb
     {
     public:
-      MyDeliveryReportCb();
+      MyDeliveryReportCb(kafka_producer* producer);
       virtual void dr_cb(RdKafka::Message &message);
       inline RdKafka::ErrorCode status() const {
         return _status;
       }
     private:
+      kafka_producer* _producer;
       RdKafka::ErrorCode _status;
     };
 
+    enum { MAX_POOLED_USER_DATA = 10000, MAX_POOLED_BUFFER_SIZE = 64 * 1024 };
+
+    producer_user_data* acquire();
+
+    // called from the delivery report - fires the done marker and pools the message state
+    void release(producer_user_data* user_data);
+
 
     class MyEventCb : public RdKafka::EventCb {
     public:
@@ -83,7 +102,9 @@ namespace kspp {
     size_t                             _nr_of_partitions;
     uint64_t                           _msg_cnt;    // TODO move to metrics
     uint64_t                           _msg_bytes;  // TODO move to metrics
-    MyHashPartitionerCb                _default_partitioner;
+    spinlock                           _pool_lock;
+    std::vector<producer_user_data*>   _pool;
+    producer_user_data*                _next;       // being encoded
     MyDeliveryReportCb                 _delivery_report_cb;
     MyEventCb                          _event_cb;
   };
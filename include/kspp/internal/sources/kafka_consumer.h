@@ -1,6 +1,8 @@
 #include <chrono>
 #include <memory>
+#include <vector>
 #include <librdkafka/rdkafkacpp.h>
+#include <kspp/internal/sources/kafka_shared_consumer.h>
 #pragma once
 
 namespace kspp {
@@ -15,6 +17,12 @@ namespace kspp {
 
     std::unique_ptr<RdKafka::Message> consume(int librdkafka_timeout=0);
 
+    /**
+     * waits up to librdkafka_timeout for the first message and then takes what is already fetched
+     * @return number of messages appended to dst, at most max_messages
+     */
+    size_t consume(std::vector<std::unique_ptr<RdKafka::Message>>& dst, size_t max_messages, int librdkafka_timeout);
+
     inline bool eof() const {
       return _eof;
     }
@@ -29,8 +37,25 @@ namespace kspp {
 
     void start(int64_t offset);
 
+    /**
+     * starts at the first message at or after start_time_ms (ms since epoch) - or at offset if that is further ahead
+     * @return false if the broker cannot resolve the timestamp, then it starts at offset and the caller has to skip older messages
+     */
+    bool start(int64_t offset, int64_t start_time_ms);
+
     void stop();
 
+    /**
+     * stops fetching until resume() - what librdkafka already fetched can still be consumed
+     */
+    void pause();
+
+    void resume();
+
+    inline bool paused() const {
+      return _paused;
+    }
+
     int32_t commit(int64_t offset, bool flush = false);
 
     inline int64_t commited() const {
@@ -42,6 +67,14 @@ namespace kspp {
     bool consumer_group_exists(std::string consumer_group, std::chrono::seconds timeout) const;
 
   private:
+    // first offset with a timestamp >= ts, OFFSET_END if there is none
+    RdKafka::ErrorCode offset_for_time(int64_t ts, int64_t& offset);
+
+    // our own consumer or the shared one
+    inline RdKafka::KafkaConsumer* handle() const {
+      return _shared ? _shared->consumer() : _consumer.get();
+    }
+
     class MyEventCb : public RdKafka::EventCb {
     public:
       void event_cb (RdKafka::Event &event);
@@ -53,6 +86,8 @@ namespace kspp {
     const std::string                       _consumer_group;
     std::vector<RdKafka::TopicPartition*>   _topic_partition;
     std::unique_ptr<RdKafka::KafkaConsumer> _consumer;
+    std::shared_ptr<kafka_shared_consumer>  _shared;
+    std::shared_ptr<kafka_shared_consumer::partition> _shared_partition;
     int64_t                                 _can_be_committed;
     int64_t                                 _last_committed;
     size_t                                  _max_pending_commits;
@@ -60,6 +95,7 @@ namespace kspp {
     uint64_t                                _msg_bytes;  // TODO move to metrics
     bool                                    _eof;
     bool                                    _closed;
+    bool                                    _paused;
     MyEventCb                               _event_cb;
   };
 }
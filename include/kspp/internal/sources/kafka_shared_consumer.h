@@ -0,0 +1,105 @@
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <librdkafka/rdkafkacpp.h>
+#pragma once
+
+namespace kspp {
+  class cluster_config;
+
+  /*
+   * one RdKafka::KafkaConsumer shared by all kafka_consumers of a consumer group
+   * every assigned partition is split off to its own queue so each source still consumes independently
+   * saves the broker connections and librdkafka threads of one client per partition
+   */
+  class kafka_shared_consumer {
+  public:
+    class partition {
+    public:
+      partition(std::string topic, int32_t partition_id, int64_t offset)
+          : _topic(topic)
+          , _partition(partition_id)
+          , _next_offset(offset) {
+      }
+
+      inline const std::string& topic() const {
+        return _topic;
+      }
+
+      inline int32_t partition_id() const {
+        return _partition;
+      }
+
+    private:
+      friend class kafka_shared_consumer;
+      const std::string                             _topic;
+      const int32_t                                 _partition;
+      int64_t                                       _next_offset; // where to resume when the assignment changes
+      bool                                          _paused = false;
+      std::unique_ptr<RdKafka::Queue>               _queue;
+      std::mutex                                    _mutex;
+      std::deque<std::unique_ptr<RdKafka::Message>> _pending;     // fetched to the consumer queue before the split
+    };
+
+    kafka_shared_consumer(const cluster_config* config, std::string consumer_group);
+
+    ~kafka_shared_consumer();
+
+    /**
+     * adds a partition to the assignment starting at offset (may be a logical offset)
+     */
+    std::shared_ptr<partition> add(std::string topic, int32_t partition_id, int64_t offset);
+
+    void remove(std::shared_ptr<partition> p);
+
+    std::unique_ptr<RdKafka::Message> consume(partition& p, int librdkafka_timeout);
+
+    /**
+     * stops fetching for one partition, kept over reassignments
+     */
+    void pause(partition& p);
+
+    void resume(partition& p);
+
+    /**
+     * for commits, positions and watermarks - the handle is thread safe
+     */
+    inline RdKafka::KafkaConsumer* consumer() {
+      return _consumer.get();
+    }
+
+    inline std::string consumer_group() const {
+      return _consumer_group;
+    }
+
+  private:
+    class MyEventCb : public RdKafka::EventCb {
+    public:
+      void event_cb (RdKafka::Event &event);
+    };
+
+    // must be called with the assign lock held exclusively
+    void reassign();
+
+    void set_paused(partition& p, bool state);
+
+    // hands a message from the consumer queue to its partition
+    void route(std::unique_ptr<RdKafka::Message> msg);
+
+    void thread_f();
+
+    const std::string                                                   _consumer_group;
+    std::unique_ptr<RdKafka::KafkaConsumer>                             _consumer;
+    std::shared_mutex                                                   _assign_mutex;
+    std::map<std::pair<std::string, int32_t>, std::shared_ptr<partition>> _partitions;
+    std::atomic<bool>                                                   _exit;
+    MyEventCb                                                           _event_cb;
+    std::thread                                                         _thread;
+  };
+}
+
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#pragma once
+
+namespace kspp {
+  template<class V>
+  struct token_bucket_config {
+    token_bucket_config(int64_t filltime_, V capacity_)
+        : filltime(filltime_), capacity(capacity_), min_tick(std::max<int64_t>(1, filltime_ / capacity_)),
+          fillrate_per_ms(((double) capacity) / filltime) {}
+
+    int64_t filltime;
+    V capacity;
+    int64_t min_tick;
+    double fillrate_per_ms;
+  };
+
+  /*
+   * plain value type so it can be stored inline in a hash map or as raw bytes in rocksdb
+   */
+  template<class V>
+  class token_bucket {
+  public:
+    token_bucket(V capacity)
+        : _tokens(capacity), _tstamp(0) {}
+
+    token_bucket(V tokens, int64_t tstamp)
+        : _tokens(tokens), _tstamp(tstamp) {}
+
+    inline bool consume_one(const token_bucket_config<V> *conf, int64_t ts) {
+      __age(conf, ts);
+      if (_tokens == 0)
+        return false;
+      _tokens -= 1;
+      return true;
+    }
+
+    inline V token() const {
+      return _tokens;
+    }
+
+    inline int64_t timestamp() const {
+      return _tstamp;
+    }
+
+    /**
+     * @return the time when the bucket is refilled to capacity - from then on it's identical to a missing bucket
+     */
+    inline int64_t full_at(const token_bucket_config<V> *conf) const {
+      if (_tokens >= conf->capacity)
+        return _tstamp;
+      return _tstamp + (int64_t) std::ceil(((double) (conf->capacity - _tokens)) / conf->fillrate_per_ms);
+    }
+
+  protected:
+    void __age(const token_bucket_config<V> *conf, int64_t ts) {
+      auto delta_ts = ts - _tstamp;
+      int64_t delta_count = (int64_t) (delta_ts * conf->fillrate_per_ms);
+      if (delta_count > 0) { // no ageing on negative deltas
+        _tstamp = ts;
+        _tokens = (V) std::min<int64_t>(conf->capacity, _tokens + delta_count);
+      }
+    }
+
+    V _tokens;
+    int64_t _tstamp;
+  };
+}
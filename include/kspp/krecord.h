@@ -1,5 +1,6 @@
 #include <chrono>
 #include <memory>
+#include <mutex>
 #pragma once
 
 namespace kspp {
@@ -8,6 +9,25 @@ namespace kspp {
         (std::chrono::system_clock::now().time_since_epoch()).count();
   }
 
+  /*
+   * value still in its encoded form - decoded on the first access through krecord::value()
+   */
+  template<class V>
+  class lazy_value {
+  public:
+    virtual ~lazy_value() {}
+
+    // nullptr if the bytes cannot be decoded - see krecord::decode_failed()
+    virtual std::shared_ptr<const V> decode() const = 0;
+
+    virtual const void *data() const = 0;
+
+    virtual size_t size() const = 0;
+
+    // the codec instance the bytes are encoded with
+    virtual const void *codec() const = 0;
+  };
+
   template<class K, class V>
   class krecord {
   public:
@@ -23,8 +43,13 @@ namespace kspp {
         : event_time_(ts), key_(k), value_(nullptr) {
     }
 
+    krecord(const K &k, std::shared_ptr<const lazy_value<V>> v, int64_t ts = milliseconds_since_epoch())
+        : event_time_(ts), key_(k), encoded_value_(v) {
+    }
+
     krecord(const krecord& a)
-        : event_time_(a.event_time_), key_(a.key_), value_(a.value_) {
+        : event_time_(a.event_time_), key_(a.key_), value_(a.shared_value()), encoded_value_(a.encoded_value_) {
+      std::call_once(decoded_, []() {}); // value_ is already decoded
     }
 
     inline bool operator==(const krecord<K,V>& other) const
@@ -35,13 +60,13 @@ namespace kspp {
       if (key_ != other.key_)
         return false;
 
-      if (value_.get() == nullptr)
-        if (other.value_.get() == nullptr)
+      if (value() == nullptr)
+        if (other.value() == nullptr)
           return true;
         else
           return false;
 
-      return (*value_.get() == *other.value_.get());
+      return (*value() == *other.value());
     }
 
     inline const K &key() const {
@@ -49,20 +74,45 @@ namespace kspp {
     }
 
     inline const V *value() const {
+      decode();
       return value_.get();
     }
 
     inline std::shared_ptr<const V> shared_value() const {
+      decode();
       return value_;
     }
 
+    // checks for a null value without decoding it
+    inline bool has_value() const {
+      return encoded_value_ || value_;
+    }
+
+    // a lazy value that could not be decoded - value() is nullptr but the record is not a delete
+    inline bool decode_failed() const {
+      decode();
+      return encoded_value_ && !value_;
+    }
+
+    // nullptr unless the record was created with a lazy value - still valid after decoding
+    inline std::shared_ptr<const lazy_value<V>> encoded_value() const {
+      return encoded_value_;
+    }
+
     inline int64_t event_time() const {
       return event_time_;
     }
 
   private:
+    inline void decode() const {
+      if (encoded_value_)
+        std::call_once(decoded_, [this]() { value_ = encoded_value_->decode(); });
+    }
+
     const K key_;
-    const std::shared_ptr<const V> value_;
+    mutable std::shared_ptr<const V> value_;
+    const std::shared_ptr<const lazy_value<V>> encoded_value_;
+    mutable std::once_flag decoded_;
     const int64_t event_time_;
   };
 
@@ -78,8 +128,13 @@ namespace kspp {
         : event_time_(ts), value_(v) {
     }
 
+    krecord(std::shared_ptr<const lazy_value<V>> v, int64_t ts = milliseconds_since_epoch())
+        : event_time_(ts), encoded_value_(v) {
+    }
+
     krecord(const krecord& a)
-        : event_time_(a.event_time_), value_(a.value_) {
+        : event_time_(a.event_time_), value_(a.shared_value()), encoded_value_(a.encoded_value_) {
+      std::call_once(decoded_, []() {}); // value_ is already decoded
     }
 
     inline bool operator==(const krecord<void, V>& other) const
@@ -87,30 +142,52 @@ namespace kspp {
       if (event_time_ != other.event_time_)
         return false;
 
-      if (value_.get() == nullptr)
-        if (other.value_.get() == nullptr)
+      if (value() == nullptr)
+        if (other.value() == nullptr)
           return true;
         else
           return false;
 
-      return (*value_.get() == *other.value_.get());
+      return (*value() == *other.value());
     }
 
 
     inline const V *value() const {
+      decode();
       return value_.get();
     }
 
     inline std::shared_ptr<const V> shared_value() const {
+      decode();
       return value_;
     }
 
+    inline bool has_value() const {
+      return encoded_value_ || value_;
+    }
+
+    inline bool decode_failed() const {
+      decode();
+      return encoded_value_ && !value_;
+    }
+
+    inline std::shared_ptr<const lazy_value<V>> encoded_value() const {
+      return encoded_value_;
+    }
+
     inline int64_t event_time() const {
       return event_time_;
     }
 
   private:
-    const std::shared_ptr<const V> value_;
+    inline void decode() const {
+      if (encoded_value_)
+        std::call_once(decoded_, [this]() { value_ = encoded_value_->decode(); });
+    }
+
+    mutable std::shared_ptr<const V> value_;
+    const std::shared_ptr<const lazy_value<V>> encoded_value_;
+    mutable std::once_flag decoded_;
     const int64_t event_time_;
   };
 
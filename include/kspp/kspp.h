@@ -4,10 +4,10 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <iterator>
 #include <mutex>
 #include <thread>
 #include <chrono>
-#include <strstream>
 #include <experimental/filesystem>
 #include <boost/uuid/uuid.hpp>
 #include <boost/algorithm/string/replace.hpp>
@@ -18,7 +18,7 @@
 #include <kspp/type_name.h>
 #include <kspp/cluster_config.h>
 #include <kspp/internal/event_queue.h>
-#include <kspp/internal/hash/murmurhash2.h>
+#include <kspp/internal/hash/partition_hash.h>
 #include <kspp/utils/kspp_utils.h>
 #include <kspp/event_consumer.h>
 #pragma once
@@ -133,6 +133,12 @@ namespace kspp {
     */
     virtual void garbage_collect(int64_t tick) {}
 
+    /**
+    * called from topology::start
+    * use this to start asynchronous schema registration so the first produce does not block
+    */
+    virtual void register_schemas() {}
+
     /**
      *
      * @return returns the kafka topic
@@ -278,15 +284,25 @@ namespace kspp {
 
   template<class PK, class CODEC>
   inline uint32_t get_partition_hash(const PK &key, std::shared_ptr<CODEC> codec = std::make_shared<CODEC>()) {
-    enum { MAX_KEY_SIZE = 1000 };
-    uint32_t partition_hash = 0;
-    char key_buf[MAX_KEY_SIZE];
-    size_t ksize = 0;
-    std::strstream s(key_buf, MAX_KEY_SIZE);
-    ksize = codec->encode(key, s);
-    //partition_hash = djb_hash(key_buf, ksize);
-    partition_hash = MurmurHash2(key_buf, (int) ksize, 0x9747b28c);
-    return partition_hash;
+    return partition_hash_traits<CODEC, PK>::hash(key, *codec);
+  }
+
+  /**
+   * hashes [begin, end) into hashes, which must have room for all keys
+   */
+  template<class ITER, class CODEC>
+  inline void get_partition_hashes(ITER begin, ITER end, uint32_t *hashes, std::shared_ptr<CODEC> codec) {
+    typedef typename std::iterator_traits<ITER>::value_type PK;
+    CODEC &c = *codec;
+    for (ITER i = begin; i != end; ++i)
+      *hashes++ = partition_hash_traits<CODEC, PK>::hash(*i, c);
+  }
+
+  template<class PK, class CODEC>
+  inline std::vector<uint32_t> get_partition_hashes(const std::vector<PK> &keys, std::shared_ptr<CODEC> codec = std::make_shared<CODEC>()) {
+    std::vector<uint32_t> hashes(keys.size());
+    get_partition_hashes(keys.begin(), keys.end(), hashes.data(), codec);
+    return hashes;
   }
 
   template<class PK, class CODEC>
@@ -2,6 +2,7 @@
 #include <chrono>
 #include <deque>
 #include <kspp/kspp.h>
+#include <kspp/state_stores/state_store_snapshot.h>
 #pragma once
 
 namespace kspp {
@@ -26,6 +27,7 @@ namespace kspp {
     , next_punctuate_(0)
     , dirty_(false) {
       source->add_sink([this](auto e) { this->_queue.push_back(e); });
+      counter_store_.add_metrics(this);
       this->add_metrics_label(KSPP_PROCESSOR_TYPE_TAG, PROCESSOR_NAME);
       this->add_metrics_label(KSPP_PARTITION_TAG, std::to_string(source->partition()));
     }
@@ -69,10 +71,13 @@ namespace kspp {
         dirty_ = true; // aggregated but not committed
         counter_store_.insert(std::make_shared<krecord<K, V>>(trans->record()->key(), 1), trans->offset());
       }
+      counter_store_.publish_snapshot(tick);
+      counter_store_.refresh_metrics(tick);
       return processed;
     }
 
     void commit(bool flush) override {
+      counter_store_.commit(flush);
       stream_->commit(flush);
     }
 
@@ -115,6 +120,22 @@ namespace kspp {
       return counter_store_.end();
     }
 
+    /**
+     * makes the table queryable from other threads, must be called before the topology is started
+     * @param interval max staleness of snapshots for memory stores
+     */
+    void enable_snapshots(std::chrono::milliseconds interval = std::chrono::milliseconds(1000)) {
+      counter_store_.enable_snapshots(interval);
+    }
+
+    /**
+     * thread safe, never blocks the processing thread
+     * @return a consistent read only view or nullptr if not supported by the state store
+     */
+    std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const {
+      return counter_store_.snapshot();
+    }
+
   private:
     std::shared_ptr<partition_source < K, void>> stream_;
     STATE_STORE<K, V, CODEC> counter_store_;
@@ -1,6 +1,7 @@
 #include <fstream>
 #include <experimental/filesystem>
 #include <kspp/kspp.h>
+#include <kspp/state_stores/state_store_snapshot.h>
 
 #pragma once
 
@@ -15,8 +16,7 @@ namespace kspp {
         , materialized_source<K, V>(source.get()
         , source->partition())
         , source_(source)
-        ,state_store_(this->get_storage_path(config->get_storage_root()), args...)
-        ,state_store_count_("state_store_size", "msg") {
+        ,state_store_(this->get_storage_path(config->get_storage_root()), args...) {
       source_->add_sink([this](auto ev) {
         this->_lag.add_event_time(kspp::milliseconds_since_epoch(), ev->event_time());
         ++(this->_processed_count);
@@ -27,7 +27,7 @@ namespace kspp {
       state_store_.set_sink([this](auto ev) {
         this->send_to_sinks(ev);
       });
-      this->add_metric(&state_store_count_);
+      state_store_.add_metrics(this);
       this->add_metrics_label(KSPP_PROCESSOR_TYPE_TAG, PROCESSOR_NAME);
       this->add_metrics_label(KSPP_PARTITION_TAG, std::to_string(source->partition()));
     }
@@ -74,8 +74,8 @@ namespace kspp {
         this->send_to_sinks(trans);
       }
 
-      // TODO is this expensive??
-      state_store_count_.set(state_store_.aprox_size());
+      state_store_.publish_snapshot(tick);
+      state_store_.refresh_metrics(tick);
       return processed;
     }
 
@@ -111,9 +111,24 @@ namespace kspp {
       return state_store_.end();
     }
 
+    /**
+     * makes the table queryable from other threads, must be called before the topology is started
+     * @param interval max staleness of snapshots for memory stores
+     */
+    void enable_snapshots(std::chrono::milliseconds interval = std::chrono::milliseconds(1000)) {
+      state_store_.enable_snapshots(interval);
+    }
+
+    /**
+     * thread safe, never blocks the processing thread
+     * @return a consistent read only view or nullptr if not supported by the state store
+     */
+    std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const {
+      return state_store_.snapshot();
+    }
+
   private:
     std::shared_ptr<kspp::partition_source<K, V>> source_;
     STATE_STORE<K, V, CODEC> state_store_;
-    metric_gauge     state_store_count_;
   };
 }
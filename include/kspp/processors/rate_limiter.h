@@ -1,24 +1,25 @@
 #include <kspp/state_stores/mem_token_bucket_store.h>
 #include <chrono>
+#include <experimental/filesystem>
 
 #pragma once
 
-// this should be a template on storage type 
-// ie mem_bucket or rocksdb version
-// or virtual ptr to storage to be passed in constructor
+// the token bucket storage is a template ie mem_token_bucket_store or rocksdb_token_bucket_store
 // right now this is processing time rate limiting 
 // how do we swap betweeen processing and event time??? TBD
 namespace kspp {
-  template<class K, class V>
+  template<class K, class V, template<typename, typename, typename> class STATE_STORE = mem_token_bucket_store, class CODEC = void>
   class rate_limiter : public event_consumer<K, V>, public partition_source<K, V> {
     static constexpr const char* PROCESSOR_NAME = "rate_limiter";
   public:
-    rate_limiter(std::shared_ptr<cluster_config> config, std::shared_ptr<partition_source<K, V>> source, std::chrono::milliseconds agetime, size_t capacity)
+    template<typename... Args>
+    rate_limiter(std::shared_ptr<cluster_config> config, std::shared_ptr<partition_source<K, V>> source, std::chrono::milliseconds agetime, size_t capacity, Args... args)
         : event_consumer<K, V>()
         , partition_source<K, V>(source.get(), source->partition())
         , source_(source)
-        , token_bucket_(std::make_shared<mem_token_bucket_store<K, size_t>>(agetime, capacity))
+        , token_bucket_(std::make_shared<STATE_STORE<K, size_t, CODEC>>(get_storage_path(config->get_storage_root()), agetime, capacity, args...))
         , rejection_count_("rejection_count", "msg") {
+      token_bucket_->add_metrics(this);
       this->add_metrics_label(KSPP_PROCESSOR_TYPE_TAG, "rate_limiter");
       this->add_metrics_label(KSPP_PARTITION_TAG, std::to_string(source->partition()));
       source_->add_sink([this](auto r) {
@@ -39,10 +40,13 @@ namespace kspp {
       source_->start(offset);
       if (offset == kspp::OFFSET_BEGINNING)
         token_bucket_->clear();
+      else if (offset != kspp::OFFSET_STORED)
+        token_bucket_->start(offset);
     }
 
     void close() override {
       source_->close();
+      token_bucket_->close();
     }
 
     size_t process(int64_t tick) override {
@@ -55,17 +59,23 @@ namespace kspp {
         this->_lag.add_event_time(tick, trans->event_time());
         // milliseconds_since_epoch for processing time limiter
         //
-        if (token_bucket_->consume(trans->record()->key(), trans->event_time())) { // TBD tick???
+        if (token_bucket_->consume(trans->record()->key(), trans->event_time(), trans->offset())) { // TBD tick???
           this->send_to_sinks(trans);
         } else {
           ++rejection_count_;
         }
       }
+      token_bucket_->refresh_metrics(tick);
       return processed;
     }
 
+    void garbage_collect(int64_t tick) override {
+      token_bucket_->garbage_collect(tick);
+    }
+
     void commit(bool flush) override {
       source_->commit(flush);
+      token_bucket_->commit(flush);
     }
 
     bool eof() const override {
@@ -82,8 +92,13 @@ namespace kspp {
 
 
   private:
+    std::experimental::filesystem::path get_storage_path(std::experimental::filesystem::path storage_path) {
+      storage_path /= sanitize_filename(std::string(PROCESSOR_NAME) + this->record_type_name() + "#" + std::to_string(this->partition()));
+      return storage_path;
+    }
+
     std::shared_ptr<partition_source<K, V>> source_;
-    std::shared_ptr<mem_token_bucket_store<K, size_t>> token_bucket_;
+    std::shared_ptr<STATE_STORE<K, size_t, CODEC>> token_bucket_;
     metric_counter rejection_count_;
   };
 } // namespace
\ No newline at end of file
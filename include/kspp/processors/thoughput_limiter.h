@@ -51,7 +51,7 @@ namespace kspp {
       size_t processed = 0;
       while (this->_queue.next_event_time()<=tick) {
        auto trans = this->_queue.front();
-        if (token_bucket_->consume(0, tick)) {
+        if (token_bucket_->consume(0, tick, trans->offset())) {
           this->_lag.add_event_time(tick, trans->event_time());
           ++(this->_processed_count);
           ++processed;
@@ -0,0 +1,131 @@
+#include <ostream>
+#include <vector>
+#include <glog/logging.h>
+#include <kspp/serdes/avro_serdes.h>
+#include <kspp/avro/avro_fast_codec.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * confluent framed avro for kspp_avrogencpp types generated with --fast-codec
+   * payloads are encoded / decoded with the generated straight line codecs, schemas are registered through avro_serdes
+   * use as KEY_CODEC / VAL_CODEC in kafka_source and kafka_sink, ie
+   *   std::make_shared<kspp::avro_fast_serdes>(config->avro_serdes())
+   */
+  class avro_fast_serdes {
+  public:
+    avro_fast_serdes(std::shared_ptr<kspp::avro_serdes> serdes)
+        : _serdes(serdes) {
+    }
+
+    static std::string name() { return "kspp::avro_fast"; }
+
+    template<class T>
+    int32_t register_schema(std::string name, const T &dummy) {
+      return _serdes->register_schema(name, dummy);
+    }
+
+    template<class T>
+    void register_schema_async(std::string name, const T &dummy) {
+      _serdes->register_schema_async(name, dummy);
+    }
+
+    template<class T>
+    size_t encode(const T &src, std::ostream &dst) {
+      int32_t schema_id = _schema_id(avro_utils::avro_utils<T>::schema_name(src), avro_utils::avro_utils<T>::valid_schema(src));
+      if (schema_id < 0)
+        return 0;
+      return encode(schema_id, src, dst);
+    }
+
+    template<class T>
+    size_t encode(const T &src, output_buffer &dst) {
+      int32_t schema_id = _schema_id(avro_utils::avro_utils<T>::schema_name(src), avro_utils::avro_utils<T>::valid_schema(src));
+      if (schema_id < 0)
+        return 0;
+      return encode(schema_id, src, dst);
+    }
+
+    template<class T>
+    size_t encode(const std::string &name, const T &src, std::ostream &dst) {
+      int32_t schema_id = _serdes->get_schema_id(name, avro_utils::avro_utils<T>::valid_schema(src));
+      if (schema_id < 0)
+        return 0;
+      return encode(schema_id, src, dst);
+    }
+
+    template<class T>
+    size_t encode(int32_t schema_id, const T &src, std::ostream &dst) {
+      auto buf = dynamic_cast<output_buffer *>(dst.rdbuf());
+      if (buf)
+        return encode(schema_id, src, *buf);
+
+      static thread_local output_buffer tmp;
+      tmp.clear();
+      size_t sz = encode(schema_id, src, tmp);
+      dst.write(tmp.data(), sz);
+      return sz;
+    }
+
+    template<class T>
+    size_t encode(int32_t schema_id, const T &src, output_buffer &dst) {
+      /* write framing */
+      char *framing = dst.prepare(5);
+      framing[0] = 0x00;
+      int32_t encoded_schema_id = htonl(schema_id);
+      memcpy(&framing[1], &encoded_schema_id, 4);
+      dst.commit(5);
+
+      avro_fast::writer w(dst);
+      avro_fast::encode(w, src);
+      return w.written() + 5;
+    }
+
+    /*
+    * payloads written with another schema id are handed to avro_serdes
+    */
+    template<class T>
+    size_t decode(const char *payload, size_t size, T &dst) {
+      int32_t expected_schema_id = _schema_id(avro_utils::avro_utils<T>::schema_name(dst), avro_utils::avro_utils<T>::valid_schema(dst));
+      if (expected_schema_id < 0 || size < 5 || payload[0])
+        return 0;
+
+      /* read framing */
+      int32_t encoded_schema_id = -1;
+      memcpy(&encoded_schema_id, &payload[1], 4);
+      if ((int32_t) ntohl(encoded_schema_id) != expected_schema_id)
+        return _serdes->decode(payload, size, dst);
+
+      try {
+        avro_fast::reader r((const uint8_t *) payload + 5, size - 5);
+        avro_fast::decode(r, dst);
+        return r.consumed() + 5;
+      }
+      catch (const avro::Exception &e) {
+        LOG(ERROR) << "Avro deserialization failed: " << e.what();
+        return 0;
+      }
+    }
+
+  private:
+    // generated types have one schema instance each - resolved once instead of for every message
+    int32_t _schema_id(const std::string &name, std::shared_ptr<const avro::ValidSchema> schema) {
+      {
+        kspp::spinlock::scoped_lock xxx(_spinlock);
+        for (auto &i : _schema_ids)
+          if (i.first == schema)
+            return i.second;
+      }
+      int32_t schema_id = _serdes->get_schema_id(name, schema);
+      if (schema_id >= 0) {
+        kspp::spinlock::scoped_lock xxx(_spinlock);
+        _schema_ids.emplace_back(schema, schema_id);
+      }
+      return schema_id;
+    }
+
+    std::shared_ptr<kspp::avro_serdes> _serdes;
+    kspp::spinlock _spinlock;
+    std::vector<std::pair<std::shared_ptr<const avro::ValidSchema>, int32_t>> _schema_ids;
+  };
+}
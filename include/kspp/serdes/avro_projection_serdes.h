@@ -0,0 +1,79 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <glog/logging.h>
+#include <kspp/avro/generic_avro.h>
+#include <kspp/avro/avro_projection.h>
+#include <kspp/avro/avro_schema_registry.h>
+#include <kspp/utils/concurrent_id_map.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * decode only codec for confluent framed avro records that materializes only the given top level fields
+   * use as VAL_CODEC for kafka_source<K, generic_avro, ...>, ie
+   *   std::make_shared<kspp::avro_projection_serdes>(config->get_schema_registry(), std::vector<std::string>{"id", "ts"})
+   * the resulting generic_avro has the projected (unregistered) schema and schema id -1
+   */
+  class avro_projection_serdes {
+  public:
+    avro_projection_serdes(std::shared_ptr<avro_schema_registry> registry, std::vector<std::string> fields)
+        : _registry(registry)
+        , _fields(fields) {
+    }
+
+    static std::string name() { return "kspp::avro_projection"; }
+
+    size_t decode(const char *payload, size_t size, kspp::generic_avro &dst) {
+      if (size < 5 || payload[0])
+        return 0;
+
+      /* read framing */
+      int32_t encoded_schema_id = -1;
+      memcpy(&encoded_schema_id, &payload[1], 4);
+      int32_t schema_id = ntohl(encoded_schema_id);
+      if (schema_id < 0) {
+        LOG(ERROR) << "schema id invalid: " << schema_id;
+        return 0;
+      }
+
+      auto projection = get_projection(schema_id);
+      if (projection == nullptr)
+        return 0;
+
+      try {
+        dst.create(projection->reader_schema(), -1);
+        return projection->decode((const uint8_t *) payload + 5, size - 5, *dst.generic_datum()) + 5;
+      }
+      catch (const avro::Exception &e) {
+        LOG(ERROR) << "avro deserialization failed: " << e.what();
+        return 0;
+      }
+    }
+
+  private:
+    // compiled once per writer schema id, a schema that cannot be projected is remembered as nullptr
+    std::shared_ptr<const avro_projection> get_projection(int32_t schema_id) {
+      auto cached = _projections.find(schema_id);
+      if (cached)
+        return *cached;
+
+      auto writer_schema = _registry->get_schema(schema_id);
+      if (writer_schema == nullptr)
+        return nullptr; // try again next time
+
+      std::shared_ptr<const avro_projection> projection;
+      try {
+        projection = std::make_shared<const avro_projection>(writer_schema, _fields);
+      }
+      catch (const std::invalid_argument &e) {
+        LOG(ERROR) << "schema id: " << schema_id << ", " << e.what();
+      }
+      return *_projections.insert(schema_id, projection);
+    }
+
+    std::shared_ptr<avro_schema_registry> _registry;
+    const std::vector<std::string> _fields;
+    concurrent_id_map<std::shared_ptr<const avro_projection>> _projections;
+  };
+}
@@ -6,6 +6,10 @@
 #include <vector>
 #include <typeinfo>
 #include <tuple>
+#include <map>
+#include <future>
+#include <atomic>
+#include <chrono>
 #include <avro/Encoder.hh>
 #include <avro/Decoder.hh>
 #include <avro/Compiler.hh>
@@ -13,8 +17,16 @@
 #include <avro/Specific.hh>
 #include <glog/logging.h>
 #include <kspp/avro/generic_avro.h>
+#include <kspp/avro/compact_avro.h>
+#include <kspp/serdes/buffer_codec.h>
+#include <kspp/internal/hash/partition_hash.h>
 #include <kspp/avro/avro_schema_registry.h>
 #include <kspp/avro/avro_utils.h>
+#include <kspp/avro/avro_input_stream.h>
+#include <kspp/avro/avro_output_stream.h>
+#include <kspp/utils/output_buffer.h>
+#include <kspp/utils/spinlock.h>
+#include <kspp/krecord.h>
 #pragma once
 
 namespace kspp {
@@ -30,12 +42,41 @@ namespace kspp {
 
     static std::string name() { return "kspp::avro"; }
 
+    /**
+    * registers the schema of T under name, waits for an ongoing registration
+    * a failed earlier registration is retried right away
+    * @return schema id or -1 on failure
+    */
     template<class T>
     int32_t register_schema(std::string name, const T& dummy){
-      int32_t schema_id=0;
-      std::shared_ptr<const avro::ValidSchema> not_used;
-      std::tie(schema_id, not_used) = _put_schema(name,  avro_utils::avro_utils<T>::schema_as_string(dummy));
-      return schema_id;
+      return _schema_id(name, avro_utils::avro_utils<T>::valid_schema(dummy), true);
+    }
+
+    /**
+    * starts registration of the schema of T under name and under the subject encode(const T&) uses in the background
+    * noop for types without a static schema (an empty generic_avro)
+    */
+    template<class T>
+    void register_schema_async(std::string name, const T& dummy){
+      auto schema = avro_utils::avro_utils<T>::valid_schema(dummy);
+      if (!schema)
+        return;
+      register_schema_async(name, schema);
+      register_schema_async(avro_utils::avro_utils<T>::schema_name(dummy), schema);
+    }
+
+    void register_schema_async(const std::string& subject, std::shared_ptr<const avro::ValidSchema> schema){
+      if (schema)
+        _registration(subject, schema);
+    }
+
+    /**
+    * ids are cached per (subject, schema fingerprint) - only the first call for a subject and schema talks to the registry
+    * a failed registration someone waited for is retried at most every REGISTRATION_RETRY_INTERVAL_MS, -1 is returned in between
+    * @return schema id or -1 on failure
+    */
+    int32_t get_schema_id(const std::string& subject, std::shared_ptr<const avro::ValidSchema> schema){
+      return _schema_id(subject, schema, false);
     }
 
     /*
@@ -47,14 +88,20 @@ namespace kspp {
     */
     template<class T>
     size_t encode(const T& src, std::ostream& dst) {
-      static int32_t schema_id = -1;
-      if (schema_id < 0) {
-        int32_t res = _registry->put_schema(src.avro_schema_name(), src.valid_schema());
-        if (res >= 0)
-          schema_id = res;
-        else
-          return 0;
-      }
+      int32_t schema_id = get_schema_id(avro_utils::avro_utils<T>::schema_name(src), avro_utils::avro_utils<T>::valid_schema(src));
+      if (schema_id < 0)
+        return 0;
+      return encode(schema_id, src, dst);
+    }
+
+    /*
+    * confluent avro encoded data appended to dst - buffer based codec concept, see buffer_codec.h
+    */
+    template<class T>
+    size_t encode(const T& src, output_buffer& dst) {
+      int32_t schema_id = get_schema_id(avro_utils::avro_utils<T>::schema_name(src), avro_utils::avro_utils<T>::valid_schema(src));
+      if (schema_id < 0)
+        return 0;
       return encode(schema_id, src, dst);
     }
 
@@ -67,14 +114,9 @@ namespace kspp {
     */
     template<class T>
     size_t encode(const std::string& name, const T& src, std::ostream& dst) {
-      static int32_t schema_id = -1;
-      if (schema_id < 0) {
-        int32_t res = _registry->put_schema(name, src.valid_schema());
-        if (res >= 0)
-          schema_id = res;
-        else
-          return 0;
-      }
+      int32_t schema_id = get_schema_id(name, avro_utils::avro_utils<T>::valid_schema(src));
+      if (schema_id < 0)
+        return 0;
       return encode(schema_id, src, dst);
     }
 
@@ -87,26 +129,38 @@ namespace kspp {
     */
     template<class T>
     size_t encode(int32_t schema_id, const T& src, std::ostream& dst) {
+      // encode in place if the stream is backed by an output_buffer
+      auto buf = dynamic_cast<output_buffer*>(dst.rdbuf());
+      if (buf)
+        return encode(schema_id, src, *buf);
+
+      static thread_local output_buffer tmp;
+      tmp.clear();
+      size_t sz = encode(schema_id, src, tmp);
+      dst.write(tmp.data(), sz);
+      return sz;
+    }
+
+    /*
+    * confluent avro encoded data appended to dst
+    * the encoder and stream are reused per thread so this does not allocate unless dst has to grow
+    */
+    template<class T>
+    size_t encode(int32_t schema_id, const T& src, output_buffer& dst) {
       /* write framing */
-      char zero = 0x00;
-      dst.write(&zero, 1);
+      char* framing = dst.prepare(5);
+      framing[0] = 0x00;
       int32_t encoded_schema_id = htonl(schema_id);
-      dst.write((const char*) &encoded_schema_id, 4);
+      memcpy(&framing[1], &encoded_schema_id, 4);
+      dst.commit(5);
 
-      auto bin_os = avro::memoryOutputStream();
-      avro::EncoderPtr bin_encoder = avro::binaryEncoder();
-      bin_encoder->init(*bin_os.get());
+      static thread_local avro::EncoderPtr bin_encoder = avro::binaryEncoder();
+      static thread_local avro_output_stream bin_os;
+      bin_os.reset(&dst);
+      bin_encoder->init(bin_os);
       avro::encode(*bin_encoder, src);
-      bin_encoder->flush(); /* push back unused characters to the output stream again, otherwise content_length will be a multiple of 4096 */
-
-      //get the data from the internals of avro stream
-      auto v = avro::snapshot(*bin_os.get());
-      size_t avro_size = v->size();
-      if (avro_size) {
-        dst.write((const char*) v->data(), avro_size);
-        return avro_size + 5;
-      }
-      return 5; // this is probably wrong - is there a 0 size avro message???
+      bin_encoder->flush(); /* push back unused bytes to the buffer */
+      return bin_os.byteCount() + 5;
     }
 
 
@@ -118,15 +172,11 @@ namespace kspp {
     */
     template<class T>
     size_t decode(const char* payload, size_t size, T& dst) {
-      static int32_t schema_id = -1;
-      if (schema_id < 0) {
-        int32_t res = _registry->put_schema(dst.avro_schema_name(), dst.valid_schema());
-        if (res >= 0)
-          schema_id = res;
-        else
-          return 0;
-      }
-      return decode(schema_id, dst.valid_schema(), payload, size, dst);
+      auto valid_schema = avro_utils::avro_utils<T>::valid_schema(dst);
+      int32_t schema_id = get_schema_id(avro_utils::avro_utils<T>::schema_name(dst), valid_schema);
+      if (schema_id < 0)
+        return 0;
+      return decode(schema_id, valid_schema, payload, size, dst);
     }
 
     template<class T>
@@ -146,11 +196,12 @@ namespace kspp {
       }
 
       try {
-        auto bin_is = avro::memoryInputStream((const uint8_t *) payload + 5, size - 5);
-        avro::DecoderPtr bin_decoder = avro::binaryDecoder();
-        bin_decoder->init(*bin_is);
+        static thread_local avro::DecoderPtr bin_decoder = avro::binaryDecoder();
+        static thread_local avro_input_stream bin_is;
+        bin_is.reset((const uint8_t *) payload + 5, size - 5);
+        bin_decoder->init(bin_is);
         avro::decode(*bin_decoder, dst);
-        return bin_is->byteCount() + 5;
+        return bin_is.byteCount() + 5;
       }
       catch (const avro::Exception &e) {
         LOG(ERROR) << "Avro deserialization failed: " << e.what();
@@ -160,233 +211,178 @@ namespace kspp {
     }
 
   private:
-    std::tuple<int32_t, std::shared_ptr<const avro::ValidSchema>> _put_schema(std::string schema_name, std::string schema_as_string) {
-      auto valid_schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString(schema_as_string));
-      auto schema_id = _registry->put_schema(schema_name, valid_schema);
-      return std::make_tuple(schema_id, valid_schema);
+    enum { REGISTRATION_RETRY_INTERVAL_MS = 10000 };
+
+    struct registration {
+      std::atomic<int32_t> schema_id{-1}; // set from the registry thread
+      std::shared_future<int32_t> result;
+      int64_t retry_after = 0;
+      bool waited = false; // a background registration that failed unobserved is retried on first use
+    };
+
+    int32_t _schema_id(const std::string& subject, std::shared_ptr<const avro::ValidSchema> schema, bool retry_now){
+      if (!schema)
+        return -1;
+      std::shared_future<int32_t> result;
+      {
+        kspp::spinlock::scoped_lock xxx(_spinlock);
+        auto r = _registration_locked(subject, schema, retry_now);
+        int32_t schema_id = r->schema_id.load(std::memory_order_acquire);
+        if (schema_id >= 0)
+          return schema_id;
+        r->waited = true;
+        result = r->result;
+      }
+      return result.get();
     }
 
-    std::shared_ptr<avro_schema_registry> _registry;
-    bool _relaxed_parsing=false;
-  };
+    void _registration(const std::string& subject, std::shared_ptr<const avro::ValidSchema> schema) {
+      kspp::spinlock::scoped_lock xxx(_spinlock);
+      _registration_locked(subject, schema, false);
+    }
 
-  template<> inline size_t avro_serdes::encode(const std::string& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    std::tie(schema_id, not_used) = _put_schema("string", "{\"type\":\"string\"}");
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    else
-      return 0;
-  }
+    std::shared_ptr<registration> _registration_locked(const std::string& subject, std::shared_ptr<const avro::ValidSchema> schema, bool retry_now) {
+      auto& r = _registrations[std::make_pair(subject, _fingerprint_locked(schema))];
+      if (!r) {
+        r = std::make_shared<registration>();
+        _start_registration_locked(r, subject, schema);
+      } else if (r->schema_id.load(std::memory_order_acquire) < 0
+                 && r->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+                 && (retry_now || !r->waited || kspp::milliseconds_since_epoch() >= r->retry_after)) {
+        _start_registration_locked(r, subject, schema);
+      }
+      return r;
+    }
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, std::string& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    if (schema_id>0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    std::tie(schema_id, valid_schema) = _put_schema("string", "{\"type\":\"string\"}");
-    if (schema_id > 0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    else
-      return 0;
-  }
+    void _start_registration_locked(std::shared_ptr<registration> r, const std::string& subject, std::shared_ptr<const avro::ValidSchema> schema) {
+      auto promise = std::make_shared<std::promise<int32_t>>();
+      r->result = promise->get_future().share();
+      r->waited = false;
+      r->retry_after = kspp::milliseconds_since_epoch() + REGISTRATION_RETRY_INTERVAL_MS;
+      _registry->put_schema(subject, schema, [r, promise](int32_t schema_id) {
+        if (schema_id >= 0)
+          r->schema_id.store(schema_id, std::memory_order_release);
+        promise->set_value(schema_id);
+      });
+    }
 
-  template<> inline size_t avro_serdes::encode(const int64_t& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    std::tie(schema_id, not_used) = _put_schema("long", "{\"type\":\"long\"}");
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    else
-      return 0;
-  }
+    // compiled once per schema id, bounded like the registry's schema cache
+    std::shared_ptr<const compact_avro_layout> _compact_layout(int32_t schema_id, std::shared_ptr<const avro::ValidSchema> schema) {
+      {
+        kspp::spinlock::scoped_lock xxx(_spinlock);
+        auto item = _layouts.find(schema_id);
+        if (item != _layouts.end())
+          return item->second;
+      }
+      auto layout = std::make_shared<const compact_avro_layout>(schema);
+      kspp::spinlock::scoped_lock xxx(_spinlock);
+      return _layouts.emplace(schema_id, layout).first->second;
+    }
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, int64_t& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    if (schema_id>0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    std::tie(schema_id, valid_schema) = _put_schema("long", "{\"type\":\"long\"}");
-    if (schema_id > 0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    else
-      return 0;
-  }
+    // the schema is kept so the address is not reused by another schema
+    uint64_t _fingerprint_locked(std::shared_ptr<const avro::ValidSchema> schema) {
+      auto item = _fingerprints.find(schema.get());
+      if (item != _fingerprints.end())
+        return item->second.second;
+      uint64_t fingerprint = 14695981039346656037ULL; // FNV-1a
+      for (char c : avro_utils::normalize(*schema)) {
+        fingerprint ^= (uint8_t) c;
+        fingerprint *= 1099511628211ULL;
+      }
+      _fingerprints[schema.get()] = std::make_pair(schema, fingerprint);
+      return fingerprint;
+    }
 
-  template<> inline size_t avro_serdes::encode(const int32_t& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    std::tie(schema_id, not_used) = _put_schema("int", "{\"type\":\"int\"}");
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    else
-      return 0;
-  }
+    std::shared_ptr<avro_schema_registry> _registry;
+    bool _relaxed_parsing=false;
+    kspp::spinlock _spinlock;
+    std::map<std::pair<std::string, uint64_t>, std::shared_ptr<registration>> _registrations; // (subject, fingerprint)
+    std::map<const avro::ValidSchema*, std::pair<std::shared_ptr<const avro::ValidSchema>, uint64_t>> _fingerprints;
+    std::map<int32_t, std::shared_ptr<const compact_avro_layout>> _layouts;
+  };
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, int32_t& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    if (schema_id>0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    std::tie(schema_id, valid_schema) = _put_schema("int", "{\"type\":\"int\"}");
-    if (schema_id > 0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    else
+  // uuids are registered as strings under the subject "uuid"
+  template<> inline size_t avro_serdes::encode(const boost::uuids::uuid& src, std::ostream& dst) {
+    int32_t schema_id = get_schema_id("uuid", avro_utils::avro_utils<boost::uuids::uuid>::valid_schema(src));
+    if (schema_id < 0)
       return 0;
+    return encode(schema_id, boost::uuids::to_string(src), dst);
   }
 
-  template<> inline size_t avro_serdes::encode(const bool& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    std::tie(schema_id, not_used) = _put_schema("boolean", "{\"type\":\"boolean\"}");
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    else
+  template<> inline size_t avro_serdes::encode(const boost::uuids::uuid& src, output_buffer& dst) {
+    int32_t schema_id = get_schema_id("uuid", avro_utils::avro_utils<boost::uuids::uuid>::valid_schema(src));
+    if (schema_id < 0)
       return 0;
+    return encode(schema_id, boost::uuids::to_string(src), dst);
   }
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, bool& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    if (schema_id>0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    std::tie(schema_id, valid_schema) = _put_schema("boolean", "{\"type\":\"boolean\"}");
-    if (schema_id > 0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    else
+  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, boost::uuids::uuid& dst) {
+    auto valid_schema = avro_utils::avro_utils<boost::uuids::uuid>::valid_schema(dst);
+    int32_t schema_id = get_schema_id("uuid", valid_schema);
+    if (schema_id < 0)
       return 0;
-  }
-
-  template<> inline size_t avro_serdes::encode(const float& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    std::tie(schema_id, not_used) = _put_schema("float", "{\"type\":\"float\"}");
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    else
+    std::string s;
+    size_t sz = decode(schema_id, valid_schema, payload, size, s);
+    try {
+      boost::uuids::string_generator gen;
+      dst = gen(s);
+      return sz;
+    }
+    catch (...) {
+      //log something
       return 0;
+    }
   }
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, float& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    if (schema_id>0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    std::tie(schema_id, valid_schema) = _put_schema("float", "{\"type\":\"float\"}");
-    if (schema_id > 0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    else
+  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, kspp::generic_avro& dst) {
+    if (size < 5 || payload[0])
       return 0;
-  }
 
-  template<> inline size_t avro_serdes::encode(const double& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    std::tie(schema_id, not_used) = _put_schema("double", "{\"type\":\"double\"}");
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    else
-      return 0;
-  }
+    /* read framing */
+    int32_t encoded_schema_id = -1;
+    memcpy(&encoded_schema_id, &payload[1], 4);
+    int32_t schema_id = ntohl(encoded_schema_id);
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, double& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    if (schema_id>0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    std::tie(schema_id, valid_schema) = _put_schema("double", "{\"type\":\"double\"}");
-    if (schema_id > 0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    else
+    // this should net be in the stream - not possible to decode
+    if (schema_id<0) {
+      LOG(ERROR) << "schema id invalid: " <<  schema_id;
       return 0;
-  }
+    }
 
-  template<> inline size_t avro_serdes::encode(const std::vector<uint8_t>& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    std::tie(schema_id, not_used) = _put_schema("bytes", "{\"type\":\"bytes\"}");
-    if (schema_id > 0)
-      return encode(schema_id, src, dst);
-    else
-      return 0;
-  }
+    // lock free after the first lookup of a schema id
+    auto validSchema  = _registry->get_schema(schema_id);
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, std::vector<uint8_t>& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    if (schema_id>0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    std::tie(schema_id, valid_schema) = _put_schema("bytes", "{\"type\":\"bytes\"}");
-    if (schema_id > 0)
-      return decode(schema_id, valid_schema, payload, size, dst);
-    else
+    if (validSchema == nullptr)
       return 0;
-  }
 
-  template<> inline size_t avro_serdes::encode(const boost::uuids::uuid& src, std::ostream& dst) {
-    static int32_t schema_id = -1;
-    std::shared_ptr<const avro::ValidSchema> not_used;
-    if (schema_id > 0)
-      return encode(schema_id, boost::uuids::to_string(src), dst);
-    std::tie(schema_id, not_used) = _put_schema("uuid", "{\"type\":\"string\"}");
-    if (schema_id > 0)
-      return encode(schema_id, boost::uuids::to_string(src), dst);
-    else
+    // the datum is built from the writer schema so the payload is decoded without a validating grammar
+    try {
+      static thread_local avro::DecoderPtr bin_decoder = avro::binaryDecoder();
+      static thread_local avro_input_stream bin_is;
+      bin_is.reset((const uint8_t *) payload + 5, size - 5);
+      dst.create(validSchema, schema_id);
+      bin_decoder->init(bin_is);
+      avro::decode(*bin_decoder, *dst.generic_datum());
+      return bin_is.byteCount() + 5;
+    }
+    catch (const avro::Exception &e) {
+      LOG(ERROR) << "avro deserialization failed: " << e.what();
       return 0;
-  }
-
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, boost::uuids::uuid& dst) {
-    static int32_t schema_id = -1;
-    static std::shared_ptr<const avro::ValidSchema> valid_schema; // this means we never free memory from used schemas???
-    static boost::uuids::string_generator gen;
-
-    if (schema_id > 0) {
-      std::string s;
-      size_t sz = decode(schema_id, valid_schema, payload, size, s);
-      try {
-        dst = gen(s);
-        return sz;
-      }
-      catch (...) {
-        //log something
-        return 0;
-      }
     }
+    return 0; // should never get here
+  }
 
-    std::tie(schema_id, valid_schema) = _put_schema("uuid", "{\"type\":\"string\"}");
+  template<> inline size_t avro_serdes::encode(const kspp::generic_avro& src, std::ostream& dst) {
+    assert(src.schema_id()>=0);
+    return encode(src.schema_id(), *src.generic_datum(), dst);
+  }
 
-    if (schema_id > 0) {
-      std::string s;
-      size_t sz = decode(schema_id, valid_schema, payload, size, s);
-      try {
-        dst = gen(s);
-        return sz;
-      }
-      catch (...) {
-        //log something
-        return 0;
-      }
-    } else {
-      return 0;
-    }
+  template<> inline size_t avro_serdes::encode(const kspp::generic_avro& src, output_buffer& dst) {
+    assert(src.schema_id()>=0);
+    return encode(src.schema_id(), *src.generic_datum(), dst);
   }
 
-  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, kspp::generic_avro& dst) {
+  template<> inline size_t avro_serdes::decode(const char* payload, size_t size, kspp::compact_avro& dst) {
     if (size < 5 || payload[0])
       return 0;
 
@@ -394,36 +390,126 @@ namespace kspp {
     int32_t encoded_schema_id = -1;
     memcpy(&encoded_schema_id, &payload[1], 4);
     int32_t schema_id = ntohl(encoded_schema_id);
-
-    // this should net be in the stream - not possible to decode
     if (schema_id<0) {
       LOG(ERROR) << "schema id invalid: " <<  schema_id;
       return 0;
     }
 
     auto validSchema  = _registry->get_schema(schema_id);
-
-
     if (validSchema == nullptr)
       return 0;
 
     try {
-      auto bin_is = avro::memoryInputStream((const uint8_t *) payload + 5, size - 5);
-      avro::DecoderPtr bin_decoder = avro::validatingDecoder(*validSchema, avro::binaryDecoder());
-      dst.create(validSchema, schema_id);
-      bin_decoder->init(*bin_is);
-      avro::decode(*bin_decoder, *dst.generic_datum());
-      return bin_is->byteCount() + 5;
+      dst.create(_compact_layout(schema_id, validSchema), schema_id);
+      return dst.decode((const uint8_t *) payload + 5, size - 5) + 5;
     }
     catch (const avro::Exception &e) {
       LOG(ERROR) << "avro deserialization failed: " << e.what();
       return 0;
     }
-    return 0; // should never get here
+    catch (const std::invalid_argument &e) {
+      LOG(ERROR) << "schema id: " << schema_id << ", " << e.what();
+      return 0;
+    }
   }
 
-  template<> inline size_t avro_serdes::encode(const kspp::generic_avro& src, std::ostream& dst) {
+  template<> inline size_t avro_serdes::encode(int32_t schema_id, const kspp::compact_avro& src, output_buffer& dst) {
+    /* write framing */
+    char* framing = dst.prepare(5);
+    framing[0] = 0x00;
+    int32_t encoded_schema_id = htonl(schema_id);
+    memcpy(&framing[1], &encoded_schema_id, 4);
+    dst.commit(5);
+
+    avro_fast::writer w(dst);
+    src.encode(w);
+    return w.written() + 5;
+  }
+
+  template<> inline size_t avro_serdes::encode(const kspp::compact_avro& src, std::ostream& dst) {
     assert(src.schema_id()>=0);
-    return encode(src.schema_id(), *src.generic_datum(), dst);
+    return encode(src.schema_id(), src, dst);
+  }
+
+  template<> inline size_t avro_serdes::encode(const kspp::compact_avro& src, output_buffer& dst) {
+    assert(src.schema_id()>=0);
+    return encode(src.schema_id(), src, dst);
   }
+
+  // partition hashes straight from the key - same bytes as avro_serdes::encode
+  namespace avro_partition_hash {
+    // a key whose schema cannot be registered is encoded to nothing
+    inline uint32_t hash(int32_t schema_id, const uint8_t* value, size_t value_size, const char* data = nullptr, size_t size = 0) {
+      if (schema_id < 0)
+        return MurmurHash2(nullptr, 0, PARTITION_HASH_SEED);
+      uint8_t framing[5];
+      framing[0] = 0x00;
+      int32_t encoded_schema_id = htonl(schema_id);
+      memcpy(&framing[1], &encoded_schema_id, 4);
+      murmur2_stream h(5 + value_size + size);
+      h.add(framing, 5);
+      h.add(value, value_size);
+      h.add(data, size);
+      return h.finish();
+    }
+
+    inline size_t write_long(uint8_t* p, int64_t v) {
+      uint64_t n = ((uint64_t) v << 1) ^ (uint64_t) (v >> 63); // zigzag
+      uint8_t* start = p;
+      while (n & ~0x7fULL) {
+        *p++ = (uint8_t) ((n & 0x7f) | 0x80);
+        n >>= 7;
+      }
+      *p++ = (uint8_t) n;
+      return p - start;
+    }
+  }
+
+  template<>
+  struct partition_hash_traits<avro_serdes, int64_t> {
+    static inline uint32_t hash(const int64_t& key, avro_serdes& codec) {
+      int32_t schema_id = codec.get_schema_id("long", avro_utils::avro_utils<int64_t>::valid_schema(key));
+      uint8_t buf[10];
+      return avro_partition_hash::hash(schema_id, buf, avro_partition_hash::write_long(buf, key));
+    }
+  };
+
+  template<>
+  struct partition_hash_traits<avro_serdes, int32_t> {
+    static inline uint32_t hash(const int32_t& key, avro_serdes& codec) {
+      int32_t schema_id = codec.get_schema_id("int", avro_utils::avro_utils<int32_t>::valid_schema(key));
+      uint8_t buf[10];
+      return avro_partition_hash::hash(schema_id, buf, avro_partition_hash::write_long(buf, key));
+    }
+  };
+
+  template<>
+  struct partition_hash_traits<avro_serdes, std::string> {
+    static inline uint32_t hash(const std::string& key, avro_serdes& codec) {
+      int32_t schema_id = codec.get_schema_id("string", avro_utils::avro_utils<std::string>::valid_schema(key));
+      uint8_t buf[10];
+      return avro_partition_hash::hash(schema_id, buf, avro_partition_hash::write_long(buf, (int64_t) key.size()), key.data(), key.size());
+    }
+  };
+
+  template<>
+  struct partition_hash_traits<avro_serdes, boost::uuids::uuid> {
+    static inline uint32_t hash(const boost::uuids::uuid& key, avro_serdes& codec) {
+      int32_t schema_id = codec.get_schema_id("uuid", avro_utils::avro_utils<boost::uuids::uuid>::valid_schema(key));
+      std::string s = boost::uuids::to_string(key);
+      uint8_t buf[10];
+      return avro_partition_hash::hash(schema_id, buf, avro_partition_hash::write_long(buf, (int64_t) s.size()), s.data(), s.size());
+    }
+  };
+
+  // the payload is the avro encoding of the whole datum - encoded into a reused buffer without a schema lookup
+  template<>
+  struct partition_hash_traits<avro_serdes, kspp::generic_avro> {
+    static inline uint32_t hash(const kspp::generic_avro& key, avro_serdes& codec) {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec.encode(key.schema_id(), *key.generic_datum(), key_buf);
+      return MurmurHash2(key_buf.data(), (int) ksize, PARTITION_HASH_SEED);
+    }
+  };
 }
@@ -0,0 +1,81 @@
+#include <istream>
+#include <string>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <kspp/utils/output_buffer.h>
+#include <kspp/utils/input_buffer.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * buffer based codec concept
+   *   size_t encode(const T& src, kspp::output_buffer& dst)  - appends src, returns bytes written (0 on failure)
+   *   size_t decode(kspp::input_buffer& src, T& dst)         - reads dst, returns bytes read (0 on failure)
+   * codecs that only implement the stream interface (encode(const T&, std::ostream&), decode(std::istream&, T&))
+   * are adapted by codec_encode / codec_decode
+   */
+  /*
+   * restricts a codec's buffer overload to exactly the listed types
+   * a plain overload also takes enums, short, char... through conversion and the trait below would pick it
+   */
+  template<class T, class... TYPES>
+  using enable_if_one_of = typename std::enable_if<(std::is_same<T, TYPES>::value || ...), int>::type;
+
+  template<class CODEC, class T, class = void>
+  struct has_buffer_encode : std::false_type {};
+
+  template<class CODEC, class T>
+  struct has_buffer_encode<CODEC, T, std::void_t<decltype(std::declval<CODEC &>().encode(std::declval<const T &>(), std::declval<output_buffer &>()))>> : std::true_type {};
+
+  template<class CODEC, class T, class = void>
+  struct has_buffer_decode : std::false_type {};
+
+  template<class CODEC, class T>
+  struct has_buffer_decode<CODEC, T, std::void_t<decltype(std::declval<CODEC &>().decode(std::declval<input_buffer &>(), std::declval<T &>()))>> : std::true_type {};
+
+  template<class CODEC, class T, class = void>
+  struct has_register_schema_async : std::false_type {};
+
+  template<class CODEC, class T>
+  struct has_register_schema_async<CODEC, T, std::void_t<decltype(std::declval<CODEC &>().register_schema_async(std::declval<std::string>(), std::declval<const T &>()))>> : std::true_type {};
+
+  /**
+   * starts schema registration for T under subject if the codec supports it - optional part of the codec concept
+   * types that cannot be default constructed are registered on first use instead
+   */
+  template<class T, class CODEC>
+  inline void codec_register_schema_async(CODEC &codec, const std::string &subject) {
+    if constexpr (has_register_schema_async<CODEC, T>::value && std::is_default_constructible<T>::value)
+      codec.register_schema_async(subject, T());
+  }
+
+  /**
+   * appends src to dst
+   * @return bytes written
+   */
+  template<class CODEC, class T>
+  inline size_t codec_encode(CODEC &codec, const T &src, output_buffer &dst) {
+    if constexpr (has_buffer_encode<CODEC, T>::value) {
+      return codec.encode(src, dst);
+    } else {
+      std::ostream os(&dst);
+      return codec.encode(src, os);
+    }
+  }
+
+  /**
+   * reads dst from a sub range of a larger buffer
+   * @return bytes read
+   */
+  template<class CODEC, class T>
+  inline size_t codec_decode(CODEC &codec, input_buffer &src, T &dst) {
+    if constexpr (has_buffer_decode<CODEC, T>::value) {
+      return codec.decode(src, dst);
+    } else {
+      size_t sz = codec.decode(src.data(), src.remaining(), dst);
+      src.consume(sz);
+      return sz;
+    }
+  }
+}
@@ -1,11 +1,13 @@
 #include <string>
+#include <charconv>
 #include <ostream>
 #include <istream>
-#include <strstream>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/uuid/string_generator.hpp>
 #include <typeinfo>
+#include <kspp/serdes/buffer_codec.h>
+#include <kspp/internal/hash/partition_hash.h>
 #pragma once
 
 namespace kspp {
@@ -23,6 +25,10 @@ namespace kspp {
       return 0;
     }
 
+    template<class T>
+    void register_schema_async(std::string name, const T& dummy){
+    }
+
     template<class T>
     size_t encode(const T& src, std::ostream& dst) {
       static_assert(fake_dependency<T>::value, "you must use specialization to provide a encode for T");
@@ -31,8 +37,13 @@ namespace kspp {
 
     template<class T>
     inline size_t decode(const char* payload, size_t size, T& dst) {
-      std::istrstream src(payload, size);
-      return decode(src, dst);
+      input_buffer src(payload, size);
+      if constexpr (has_buffer_decode<text_serdes, T>::value) {
+        return decode(src, dst);
+      } else {
+        std::istream is(&src);
+        return decode(is, dst);
+      }
     }
 
     template<class T>
@@ -40,8 +51,105 @@ namespace kspp {
       static_assert(fake_dependency<T>::value, "you must use specialization to provide a decode for T");
       return 0; // dummy return to quiet gcc
     }
+
+    /*
+     * buffer based versions of the built in types - same format as the stream versions below
+     * exact types only so an enum or short does not convert to one of them
+     */
+    template<class T, enable_if_one_of<T, std::string> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      return write_raw(src.data(), src.size(), dst);
+    }
+
+    template<class T, enable_if_one_of<T, bool> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      return src ? write_raw("true", 4, dst) : write_raw("false", 5, dst);
+    }
+
+    template<class T, enable_if_one_of<T, int, long, long long, unsigned int, unsigned long, unsigned long long> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      return encode_number(src, dst);
+    }
+
+    template<class T, enable_if_one_of<T, boost::uuids::uuid> = 0>
+    inline size_t encode(const T& src, output_buffer& dst) {
+      std::string s = boost::uuids::to_string(src);
+      return write_raw(s.data(), s.size(), dst);
+    }
+
+    inline size_t decode(input_buffer& src, std::string& dst) {
+      read_line(src, dst);
+      return dst.size();
+    }
+
+    template<class T, enable_if_one_of<T, bool, int, long, long long, unsigned int, unsigned long, unsigned long long, boost::uuids::uuid> = 0>
+    inline size_t decode(input_buffer& src, T& dst) {
+      std::string s;
+      read_line(src, s);
+      dst = from_text<T>(s);
+      return s.size();
+    }
+
+  private:
+    // one line of text to T - shared by the stream and buffer decoders
+    template<class T>
+    static T from_text(const std::string& s);
+
+    template<class T>
+    static inline size_t encode_number(const T& src, output_buffer& dst) {
+      auto s = std::to_string(src);
+      return write_raw(s.data(), s.size(), dst);
+    }
+
+    static inline size_t write_raw(const void* src, size_t size, output_buffer& dst) {
+      memcpy(dst.prepare(size), src, size);
+      dst.commit(size);
+      return size;
+    }
+
+    // same as std::getline - up to but not including the next newline which is consumed
+    static inline void read_line(input_buffer& src, std::string& dst) {
+      const char* begin = src.data();
+      const char* end = (const char*) memchr(begin, '\n', src.remaining());
+      size_t sz = end ? end - begin : src.remaining();
+      dst.assign(begin, sz);
+      src.consume(end ? sz + 1 : sz);
+    }
   };
 
+  template<> inline bool text_serdes::from_text(const std::string& s) {
+    return (s == "true") ? true : false;
+  }
+
+  template<> inline int text_serdes::from_text(const std::string& s) {
+    return std::atoi(s.c_str());
+  }
+
+  template<> inline long text_serdes::from_text(const std::string& s) {
+    return std::atol(s.c_str());
+  }
+
+  template<> inline long long text_serdes::from_text(const std::string& s) {
+    return std::atoll(s.c_str());
+  }
+
+  template<> inline unsigned int text_serdes::from_text(const std::string& s) {
+    return (unsigned int) strtoul(s.c_str(), 0, 10);
+  }
+
+  template<> inline unsigned long text_serdes::from_text(const std::string& s) {
+    return strtoul(s.c_str(), 0, 10);
+  }
+
+  template<> inline unsigned long long text_serdes::from_text(const std::string& s) {
+    return strtoull(s.c_str(), 0, 10);
+  }
+
+  template<> inline boost::uuids::uuid text_serdes::from_text(const std::string& s) {
+    static boost::uuids::string_generator gen;
+    return gen(s);
+  }
+
   template<> inline size_t text_serdes::encode(const std::string& src, std::ostream& dst) {
     dst << src;
     return src.size();
@@ -61,7 +169,7 @@ namespace kspp {
   template<> inline size_t text_serdes::decode(std::istream& src, bool& dst) {
     std::string s;
     std::getline(src, s);
-    dst = (s == "true") ? true : false;
+    dst = from_text<bool>(s);
     return s.size();
   }
 
@@ -74,7 +182,7 @@ namespace kspp {
   template<> inline size_t text_serdes::decode(std::istream& src, int& dst) {
     std::string s;
     std::getline(src, s);
-    dst = std::atoi(s.c_str());
+    dst = from_text<int>(s);
     return s.size();
   }
 
@@ -87,7 +195,7 @@ namespace kspp {
   template<> inline size_t text_serdes::decode(std::istream& src, long& dst) {
     std::string s;
     std::getline(src, s);
-    dst = std::atol(s.c_str());
+    dst = from_text<long>(s);
     return s.size();
   }
 
@@ -100,7 +208,7 @@ namespace kspp {
   template<> inline size_t text_serdes::decode(std::istream& src, long long& dst) {
     std::string s;
     std::getline(src, s);
-    dst = std::atoll(s.c_str());
+    dst = from_text<long long>(s);
     return s.size();
   }
 
@@ -113,7 +221,7 @@ namespace kspp {
   template<> inline size_t text_serdes::decode(std::istream& src, unsigned int& dst) {
     std::string s;
     std::getline(src, s);
-    dst = (unsigned int) strtoul(s.c_str(), 0, 10);
+    dst = from_text<unsigned int>(s);
     return s.size();
   }
 
@@ -126,7 +234,7 @@ namespace kspp {
   template<> inline size_t text_serdes::decode(std::istream& src, unsigned long& dst) {
     std::string s;
     std::getline(src, s);
-    dst = strtoul(s.c_str(), 0, 10);
+    dst = from_text<unsigned long>(s);
     return s.size();
   }
 
@@ -139,7 +247,7 @@ namespace kspp {
   template<> inline size_t text_serdes::decode(std::istream& src, unsigned long long& dst) {
     std::string s;
     std::getline(src, s);
-    dst = strtoull(s.c_str(), 0, 10);
+    dst = from_text<unsigned long long>(s);
     return s.size();
   }
 
@@ -150,11 +258,33 @@ namespace kspp {
   }
 
   template<> inline size_t text_serdes::decode(std::istream& src, boost::uuids::uuid& dst) {
-    static boost::uuids::string_generator gen;
     std::string s;
     std::getline(src, s);
-    dst = gen(s);
+    dst = from_text<boost::uuids::uuid>(s);
     return s.size();
   }
+
+  // partition hashes straight from the key - same bytes as the encoders above
+  template<>
+  struct partition_hash_traits<text_serdes, std::string> {
+    static inline uint32_t hash(const std::string& key, text_serdes&) {
+      return MurmurHash2(key.data(), (int) key.size(), PARTITION_HASH_SEED);
+    }
+  };
+
+  template<class PK>
+  struct is_text_serdes_integer
+      : std::integral_constant<bool, std::is_same<PK, int>::value || std::is_same<PK, long>::value || std::is_same<PK, long long>::value
+                                     || std::is_same<PK, unsigned int>::value || std::is_same<PK, unsigned long>::value || std::is_same<PK, unsigned long long>::value> {
+  };
+
+  template<class PK>
+  struct partition_hash_traits<text_serdes, PK, std::enable_if_t<is_text_serdes_integer<PK>::value>> {
+    static inline uint32_t hash(const PK& key, text_serdes&) {
+      char buf[24];
+      auto res = std::to_chars(buf, buf + sizeof(buf), key); // same digits as std::to_string
+      return MurmurHash2(buf, (int) (res.ptr - buf), PARTITION_HASH_SEED);
+    }
+  };
 }
 
@@ -1,10 +1,11 @@
 #include <assert.h>
 #include <memory>
 #include <functional>
-#include <sstream>
+#include <ostream>
 #include <kspp/kspp.h>
 #include <kspp/topology.h>
 #include <kspp/internal/sinks/kafka_producer.h>
+#include <kspp/serdes/buffer_codec.h>
 #pragma once
 
 namespace kspp {
@@ -135,12 +136,16 @@ namespace kspp {
       this->close();
     }
 
+    void register_schemas() override {
+      // register schemas under the topic-key, topic-value name to comply with kafka-connect behavior
+      codec_register_schema_async<K>(*this->_key_codec, this->topic() + "-key");
+      codec_register_schema_async<V>(*this->_val_codec, this->topic() + "-value");
+    }
+
   protected:
     int handle_event(std::shared_ptr<kevent < K, V>> ev) override {
-      void *kp = nullptr;
-      void *vp = nullptr;
-      size_t ksize = 0;
-      size_t vsize = 0;
+      if (ev->record()->decode_failed())
+        return 0; // not a delete - drop it
 
       // first time??
       // register schemas under the topic-key, topic-value name to comply with kafka-connect behavior
@@ -154,19 +159,11 @@ namespace kspp {
         LOG_IF(FATAL, this->_val_schema_id<0) << "Failed to register schema - aborting";
       }
 
-      std::stringstream ks;
-      ksize = this->_key_codec->encode(ev->record()->key(), ks);
-      kp = malloc(ksize);  // must match the free in kafka_producer TBD change to new[] and a memory pool
-      ks.read((char *) kp, ksize);
-
-      if (ev->record()->value()) {
-        std::stringstream vs;
-        vsize = this->_val_codec->encode(*ev->record()->value(), vs);
-        vp = malloc(vsize);   // must match the free in kafka_producer TBD change to new[] and a memory pool
-        vs.read((char *) vp, vsize);
-      }
-      return this->_impl.produce((uint32_t) this->_fixed_partition, kafka_producer::FREE, kp, ksize, vp, vsize,
-                                 ev->event_time(), ev->id());
+      // encoded straight into the buffers handed to librdkafka
+      codec_encode(*this->_key_codec, ev->record()->key(), this->_impl.key_buffer());
+      if (ev->record()->value())
+        codec_encode(*this->_val_codec, *ev->record()->value(), this->_impl.value_buffer());
+      return this->_impl.produce((uint32_t) this->_fixed_partition, ev->event_time(), ev->id());
     }
   };
 
@@ -190,10 +187,14 @@ namespace kspp {
       this->close();
     }
 
+    void register_schemas() override {
+      codec_register_schema_async<V>(*this->_val_codec, this->topic() + "-value");
+    }
+
   protected:
     int handle_event(std::shared_ptr<kevent < void, V>> ev) override {
-      void *vp = nullptr;
-      size_t vsize = 0;
+      if (ev->record()->decode_failed())
+        return 0;
 
       // first time??
       // register schemas under the topic-key, topic-value name to comply with kafka-connect behavior
@@ -203,16 +204,12 @@ namespace kspp {
       }
 
       if (ev->record()->value()) {
-        std::stringstream vs;
-        vsize = this->_val_codec->encode(*ev->record()->value(), vs);
-        vp = malloc(vsize);   // must match the free in kafka_producer TBD change to new[] and a memory pool
-        vs.read((char *) vp, vsize);
+        codec_encode(*this->_val_codec, *ev->record()->value(), this->_impl.value_buffer());
       } else {
         assert(false);
         return 0; // no writing of null key and null values
       }
-      return this->_impl.produce((uint32_t) this->_fixed_partition, kafka_producer::FREE, nullptr, 0, vp, vsize,
-                                 ev->event_time(), ev->id());
+      return this->_impl.produce((uint32_t) this->_fixed_partition, ev->event_time(), ev->id());
     }
   };
 
@@ -235,6 +232,10 @@ namespace kspp {
       this->close();
     }
 
+    void register_schemas() override {
+      codec_register_schema_async<K>(*this->_key_codec, this->topic() + "-key");
+    }
+
   protected:
     int handle_event(std::shared_ptr<kevent < K, void>> ev) override {
 
@@ -245,20 +246,8 @@ namespace kspp {
         LOG_IF(FATAL, this->_key_schema_id<0) << "Failed to register schema - aborting";
       }
 
-      void *kp = nullptr;
-      size_t ksize = 0;
-      std::stringstream ks;
-      ksize = this->_codec->encode(ev->record()->key(), ks);
-      kp = malloc(ksize);  // must match the free in kafka_producer TBD change to new[] and a memory pool
-      ks.read((char *) kp, ksize);
-      return this->_impl.produce((uint32_t) this->_fixed_partition,
-                                 kafka_producer::FREE,
-                                 kp,
-                                 ksize,
-                                 nullptr,
-                                 0,
-                                 ev->event_time(),
-                                 ev->id());
+      codec_encode(*this->_key_codec, ev->record()->key(), this->_impl.key_buffer());
+      return this->_impl.produce((uint32_t) this->_fixed_partition, ev->event_time(), ev->id());
     }
   };
 }
@@ -1,10 +1,13 @@
 #include <assert.h>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <functional>
-#include <sstream>
+#include <ostream>
 #include <kspp/kspp.h>
 #include <kspp/topology.h>
 #include <kspp/internal/sinks/kafka_producer.h>
+#include <kspp/serdes/buffer_codec.h>
 #include <kspp/sinks/sink_defs.h>
 
 #pragma once
@@ -120,6 +123,31 @@ namespace kspp {
 
     virtual int handle_event(std::shared_ptr<kevent<K, V>>) = 0;
 
+    /**
+     * copies the value as received if the source decoded it lazily with our value codec instance
+     * @return false if the value has to be encoded
+     */
+    template<class EV>
+    bool forward_encoded_value(const EV &ev) {
+      auto encoded = ev->record()->encoded_value();
+      if (!encoded || encoded->codec() != _val_codec.get())
+        return false;
+      auto &val_buf = _impl.value_buffer();
+      memcpy(val_buf.prepare(encoded->size()), encoded->data(), encoded->size());
+      val_buf.commit(encoded->size());
+      return true;
+    }
+
+    /**
+     * a lazy value that failed to decode is dropped instead of written as a null value
+     * values forwarded as is are not decoded and not checked
+     */
+    template<class EV>
+    bool undecodable_value(const EV &ev) const {
+      auto encoded = ev->record()->encoded_value();
+      return encoded && encoded->codec() != _val_codec.get() && ev->record()->decode_failed();
+    }
+
     std::shared_ptr<KEY_CODEC> _key_codec;
     std::shared_ptr<VAL_CODEC> _val_codec;
     int32_t _key_schema_id;
@@ -161,9 +189,15 @@ namespace kspp {
       this->close();
     }
 
+    void register_schemas() override {
+      // register schemas under the topic-key, topic-value name to comply with kafka-connect behavior
+      codec_register_schema_async<K>(*this->_key_codec, this->topic() + "-key");
+      codec_register_schema_async<V>(*this->_val_codec, this->topic() + "-value");
+    }
+
   protected:
     int handle_event(std::shared_ptr<kevent<K, V>> ev) override {
-      if (ev==nullptr)
+      if (ev==nullptr || this->undecodable_value(ev))
         return 0;
 
       // first time??
@@ -186,24 +220,15 @@ namespace kspp {
         partition_hash = (this->_partitioner) ? this->_partitioner(ev->record()->key()) : kspp::get_partition_hash(
             ev->record()->key(), this->_key_codec);
 
-      void *kp = nullptr;
-      void *vp = nullptr;
-      size_t ksize = 0;
-      size_t vsize = 0;
-
-      std::stringstream ks;
-      ksize = this->_key_codec->encode(ev->record()->key(), ks);
-      kp = malloc(ksize);  // must match the free in kafka_producer TBD change to new[] and a memory pool
-      ks.read((char *) kp, ksize);
-
-      if (ev->record()->value()) {
-        std::stringstream vs;
-        vsize = this->_val_codec->encode(*ev->record()->value(), vs);
-        vp = malloc(vsize);   // must match the free in kafka_producer TBD change to new[] and a memory pool
-        vs.read((char *) vp, vsize);
+      // encoded straight into the buffers handed to librdkafka
+      codec_encode(*this->_key_codec, ev->record()->key(), this->_impl.key_buffer());
+
+      if (this->forward_encoded_value(ev)) {
+        // still encoded with our codec - no decode / encode round trip
+      } else if (ev->record()->value()) {
+        codec_encode(*this->_val_codec, *ev->record()->value(), this->_impl.value_buffer());
       }
-      return this->_impl.produce(partition_hash, kafka_producer::FREE, kp, ksize, vp, vsize, ev->event_time(),
-                                 ev->id());
+      return this->_impl.produce(partition_hash, ev->event_time(), ev->id());
     }
   };
 
@@ -221,9 +246,13 @@ namespace kspp {
       this->close();
     }
 
+    void register_schemas() override {
+      codec_register_schema_async<V>(*this->_val_codec, this->topic() + "-value");
+    }
+
   protected:
     int handle_event(std::shared_ptr<kevent<void, V>> ev) override {
-      if (ev==nullptr)
+      if (ev==nullptr || this->undecodable_value(ev))
         return 0;
 
       // first time??
@@ -235,20 +264,15 @@ namespace kspp {
 
       static uint32_t s_partition = 0;
       uint32_t partition_hash = ev->has_partition_hash() ? ev->partition_hash() : ++s_partition;
-      void *vp = nullptr;
-      size_t vsize = 0;
-
-      if (ev->record()->value()) {
-        std::stringstream vs;
-        vsize = this->_val_codec->encode(*ev->record()->value(), vs);
-        vp = malloc(vsize);   // must match the free in kafka_producer TBD change to new[] and a memory pool
-        vs.read((char *) vp, vsize);
+      if (this->forward_encoded_value(ev)) {
+        // still encoded with our codec - no decode / encode round trip
+      } else if (ev->record()->value()) {
+        codec_encode(*this->_val_codec, *ev->record()->value(), this->_impl.value_buffer());
       } else {
         assert(false);
         return 0; // no writing of null key and null values
       }
-      return this->_impl.produce(partition_hash, kafka_producer::FREE, nullptr, 0, vp, vsize, ev->event_time(),
-                                 ev->id());
+      return this->_impl.produce(partition_hash, ev->event_time(), ev->id());
     }
   };
 
@@ -274,6 +298,10 @@ namespace kspp {
       this->close();
     }
 
+    void register_schemas() override {
+      codec_register_schema_async<K>(*this->_key_codec, this->topic() + "-key");
+    }
+
   protected:
     int handle_event(std::shared_ptr<kevent<K, void>> ev) override {
       if (ev==nullptr)
@@ -293,16 +321,8 @@ namespace kspp {
         partition_hash = (this->_partitioner) ? this->_partitioner(ev->record()->key()) : kspp::get_partition_hash(
             ev->record()->key(), this->_key_codec);
 
-      void *kp = nullptr;
-      size_t ksize = 0;
-
-      std::stringstream ks;
-      ksize = this->_key_codec->encode(ev->record()->key(), ks);
-      kp = malloc(ksize);  // must match the free in kafka_producer TBD change to new[] and a memory pool
-      ks.read((char *) kp, ksize);
-
-      return this->_impl.produce(partition_hash, kafka_producer::FREE, kp, ksize, nullptr, 0, ev->event_time(),
-                                 ev->id());
+      codec_encode(*this->_key_codec, ev->record()->key(), this->_impl.key_buffer());
+      return this->_impl.produce(partition_hash, ev->event_time(), ev->id());
     }
   };
 }
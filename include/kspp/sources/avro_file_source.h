@@ -1,6 +1,7 @@
 #include <memory>
 #include <kspp/avro/generic_avro.h>
 #include <kspp/kspp.h>
+#include <kspp/utils/memory_budget.h>
 #pragma once
 
 namespace kspp {
@@ -34,7 +35,6 @@ class generic_avro_file_source : public partition_source<void, kspp::generic_avr
   protected:
     void thread_f();
 
-    size_t max_incomming_queue_size_ = 1000;
     bool started_ = false;
     bool exit_ = false;
     bool eof_ = false;
@@ -42,5 +42,10 @@ class generic_avro_file_source : public partition_source<void, kspp::generic_avr
     std::string filename_;
     int64_t messages_in_file_ = 0;
     event_queue<void, kspp::generic_avro> incomming_msg_;
+    std::shared_ptr<memory_budget> memory_budget_;
+    read_ahead_buffer read_ahead_;
+    metric_gauge buffered_bytes_;
+    metric_gauge read_ahead_limit_;
+    metric_gauge memory_budget_used_;
   };
 }
\ No newline at end of file
@@ -1,15 +1,67 @@
 #include <kspp/kspp.h>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <strstream>
 #include <thread>
 #include <glog/logging.h>
 #include <kspp/topology.h>
 #include <kspp/internal/sources/kafka_consumer.h>
 #include <kspp/internal/commit_chain.h>
+#include <kspp/utils/worker_pool.h>
+#include <kspp/utils/memory_budget.h>
 
 #pragma once
 
 namespace kspp {
+  /*
+   * value payload of a consumed message, decoded on first access
+   * holds a copy of the payload - holding the message would pin its whole librdkafka fetch buffer for as long as a store keeps the record
+   */
+  template<class V, class VAL_CODEC>
+  class kafka_lazy_value : public lazy_value<V> {
+  public:
+    kafka_lazy_value(const RdKafka::Message &msg, std::shared_ptr<VAL_CODEC> codec)
+        : _payload((const char *) msg.payload(), msg.len())
+        , _partition(msg.partition())
+        , _offset(msg.offset())
+        , _codec(codec) {
+    }
+
+    std::shared_ptr<const V> decode() const override {
+      size_t sz = _payload.size();
+      auto value = std::make_shared<V>();
+      size_t consumed = _codec->decode(_payload.data(), sz, *value);
+      if (consumed == 0) {
+        LOG(ERROR) << "kafka_lazy_value partition:" << _partition << ", offset:" << _offset << ", decode value failed, size:" << sz;
+        return nullptr;
+      } else if (sz - consumed > 1) { // patch for 0 terminated string or not... if text encoding
+        LOG_FIRST_N(ERROR, 100) << "kafka_lazy_value partition:" << _partition << ", offset:" << _offset << ", decode value failed, consumed: " << consumed << ", actual: " << sz;
+        return nullptr;
+      }
+      return value;
+    }
+
+    const void *data() const override {
+      return _payload.data();
+    }
+
+    size_t size() const override {
+      return _payload.size();
+    }
+
+    const void *codec() const override {
+      return _codec.get();
+    }
+
+  private:
+    const std::string _payload;
+    const int32_t _partition;
+    const int64_t _offset;
+    std::shared_ptr<VAL_CODEC> _codec;
+  };
+
   template<class K, class V, class KEY_CODEC, class VAL_CODEC>
   class kafka_source_base : public partition_source<K, V> {
     static constexpr const char* PROCESSOR_NAME = "kafka_source";
@@ -23,7 +75,12 @@ namespace kspp {
     }
 
     void start(int64_t offset) override {
-      _impl.start(offset);
+      if (_start_point_ms > 0) {
+        // seek to the start point, skip older messages only if the broker cannot
+        _spool_to_start_point = !_impl.start(offset, _start_point_ms);
+      } else {
+        _impl.start(offset);
+      }
       _started = true;
     }
 
@@ -57,19 +114,25 @@ namespace kspp {
     }
 
     size_t process(int64_t tick) override {
-      if (_incomming_msg.size() == 0)
-        return 0;
       size_t processed=0;
       while(!_incomming_msg.empty()) {
         auto p = _incomming_msg.front();
         if (p==nullptr || p->event_time() > tick)
-          return processed;
+          break;
         _incomming_msg.pop_front();
         this->send_to_sinks(p);
         ++(this->_processed_count);
         ++processed;
         this->_lag.add_event_time(tick, p->event_time());
       }
+      _read_ahead.remove(processed);
+      if (_throttled && _read_ahead.drained()) {
+        std::lock_guard<std::mutex> guard(_throttle_mutex);
+        _throttle_cv.notify_one();
+      }
+      _buffered_bytes.set(_read_ahead.bytes());
+      _read_ahead_limit.set(_read_ahead.limit());
+      _memory_budget_used.set(_memory_budget->used());
       return processed;
     }
 
@@ -81,6 +144,15 @@ namespace kspp {
       return _impl.topic();
     }
 
+    /**
+     * keep values encoded until they are accessed - call before start()
+     * sinks using the same value codec instance forward the bytes without decoding them
+     * a value that fails to decode is reported by krecord::decode_failed() - stores and kafka sinks drop such records
+     */
+    void set_lazy_value_decoding(bool state) {
+      _lazy_values = state;
+    }
+
   protected:
     kafka_source_base(std::shared_ptr<cluster_config> config,
                       std::string topic,
@@ -96,19 +168,79 @@ namespace kspp {
         , _impl(config, topic, partition, consumer_group)
         , _key_codec(key_codec)
         , _val_codec(val_codec)
+        , _decode_pool(config->get_decode_pool())
+        , _memory_budget(config->get_memory_budget())
+        , _read_ahead(_memory_budget, config->get_read_ahead_time())
+        , _throttled(false)
         , _commit_chain(topic, partition)
         , _start_point_ms(std::chrono::time_point_cast<std::chrono::milliseconds>(start_point).time_since_epoch().count())
         , _parse_errors("parse_errors", "msg")
         , _commit_chain_size("commit_chain_size", "msg")
+        , _buffered_bytes("buffered_bytes", "bytes")
+        , _read_ahead_limit("read_ahead_limit", "bytes")
+        , _memory_budget_used("memory_budget_used", "bytes")
     {
       this->add_metric(&_commit_chain_size);
+      this->add_metric(&_buffered_bytes);
+      this->add_metric(&_read_ahead_limit);
+      this->add_metric(&_memory_budget_used);
       this->add_metric(&_parse_errors);
       this->add_metrics_label(KSPP_PROCESSOR_TYPE_TAG, PROCESSOR_NAME);
       this->add_metrics_label(KSPP_TOPIC_TAG, topic);
       this->add_metrics_label(KSPP_PARTITION_TAG, std::to_string(partition));
     }
 
-    virtual std::shared_ptr<kevent<K, V>> parse(const std::unique_ptr<RdKafka::Message> &ref) = 0;
+    // may run on a decode pool thread - must not touch the commit chain, may take over ref
+    virtual std::shared_ptr<krecord<K, V>> parse(std::unique_ptr<RdKafka::Message> &ref) = 0;
+
+    // parses a consumed batch and hands it to the event queue in one go, offset order is kept
+    void parse_batch(std::vector<std::unique_ptr<RdKafka::Message>> &batch, int64_t min_timestamp) {
+      // parse may take over the message so note the offsets and payload sizes first, -1 for skipped messages
+      _offsets.resize(batch.size());
+      size_t bytes = 0;
+      for (size_t i = 0; i != batch.size(); ++i) {
+        _offsets[i] = (batch[i]->timestamp().timestamp >= min_timestamp) ? batch[i]->offset() : -1;
+        if (_offsets[i] >= 0)
+          bytes += batch[i]->key_len() + batch[i]->len();
+      }
+
+      _records.assign(batch.size(), nullptr);
+      auto parse_range = [this, &batch](size_t begin, size_t end) {
+        for (size_t i = begin; i != end; ++i) {
+          if (_offsets[i] >= 0)
+            _records[i] = parse(batch[i]);
+        }
+      };
+
+      if (_decode_pool && batch.size() >= 2 * _min_decode_chunk) {
+        size_t chunks = std::min(_decode_pool->size() + 1, batch.size() / _min_decode_chunk);
+        size_t chunk_size = (batch.size() + chunks - 1) / chunks;
+        _decode_tasks.clear();
+        for (size_t begin = 0; begin < batch.size(); begin += chunk_size) {
+          size_t end = std::min(begin + chunk_size, batch.size());
+          _decode_tasks.push_back([&parse_range, begin, end]() { parse_range(begin, end); });
+        }
+        _decode_pool->run(_decode_tasks);
+      } else {
+        parse_range(0, batch.size());
+      }
+
+      // commit chain entries must be created in offset order
+      for (size_t i = 0; i != batch.size(); ++i) {
+        if (_offsets[i] < 0)
+          continue;
+        if (_records[i]) {
+          _decoded.push_back(std::make_shared<kevent<K, V>>(_records[i], _commit_chain.create(_offsets[i])));
+        } else {
+          ++_parse_errors;
+        }
+      }
+      _records.clear();
+      batch.clear();
+      // accounted before the events are visible to process()
+      _read_ahead.add(_decoded.size(), _decoded.size() ? bytes : 0);
+      _incomming_msg.push_back(_decoded);
+    }
 
     void thread_f()
     {
@@ -116,68 +248,86 @@ namespace kspp {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
       DLOG(INFO) << "starting thread";
 
-      if (_start_point_ms>0) {
+      std::vector<std::unique_ptr<RdKafka::Message>> batch;
+      batch.reserve(_max_batch_size);
+
+      if (_spool_to_start_point) {
         DLOG(INFO) << "spooling phase";
         bool done_skipping =false;
         while (!_exit && !done_skipping) {
-          while (auto p = _impl.consume()) {
-            if (p->timestamp().timestamp < _start_point_ms) {
-            } else {
+          // blocks until there is something to read
+          _impl.consume(batch, _max_batch_size, _consume_timeout_ms);
+          for (auto &p : batch) {
+            if (p->timestamp().timestamp >= _start_point_ms)
               done_skipping = true;
-              // we need to sent the first message to the queue
-              auto decoded_msg = parse(p);
-              if (decoded_msg) {
-                _incomming_msg.push_back(decoded_msg);
-              } else {
-                ++_parse_errors;
-              }
-            }
           }
+          parse_batch(batch, _start_point_ms);
           _commit_chain_size.set(_commit_chain.size());
-          std::this_thread::sleep_for(std::chrono::milliseconds(10)); // wait for more messages
         }
       }
 
       DLOG(INFO) << "consumption phase";
 
       while(!_exit) {
-        auto tick = kspp::milliseconds_since_epoch();
-        while (auto p = _impl.consume()) {
-          auto decoded_msg = parse(p);
-          if (decoded_msg) {
-            _incomming_msg.push_back(decoded_msg);
-          } else {
-            ++_parse_errors;
-          }
+        _impl.consume(batch, _max_batch_size, _consume_timeout_ms);
+        parse_batch(batch, INT64_MIN);
+        _commit_chain_size.set(_commit_chain.size());
 
-          // to much work in queue - back off and let the consumers work
-         while(_incomming_msg.size()>_max_incomming_queue_size && !_exit) {
-           std::this_thread::sleep_for(std::chrono::milliseconds(10));
-           _commit_chain_size.set(_commit_chain.size());
-         }
+        // read ahead limit or memory budget reached - stop fetching and wait for process() to drain the queue
+        if (_read_ahead.full())
+          throttle();
 
-          // to much uncomitted - back off and let the consumers work
-          //while(_commit_chain.size()>10000 && !_exit)
-          //  std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
-        _commit_chain_size.set(_commit_chain.size());
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // to much uncomitted - back off and let the consumers work
+        //while(_commit_chain.size()>10000 && !_exit)
+        //  std::this_thread::sleep_for(std::chrono::milliseconds(10));
       }
       DLOG(INFO) << "exiting thread";
     }
 
-    size_t _max_incomming_queue_size=1000;
+    // keeps librdkafka from prefetching while we wait, memory freed by other sources is not signalled so wait in slices
+    void throttle() {
+      _impl.pause();
+      {
+        std::unique_lock<std::mutex> lock(_throttle_mutex);
+        _throttled = true;
+        while (!_exit && !_read_ahead.drained()) {
+          _throttle_cv.wait_for(lock, std::chrono::milliseconds(100));
+          _commit_chain_size.set(_commit_chain.size());
+        }
+        _throttled = false;
+      }
+      _impl.resume();
+    }
+
+    size_t _max_batch_size=100;
+    int _consume_timeout_ms=100; // bounds the latency of close()
+    size_t _min_decode_chunk=16;
+    bool _lazy_values=false;
     bool _started;
     bool _exit;
     std::thread _thread;
     event_queue<K, V> _incomming_msg;
+    std::vector<int64_t> _offsets;
+    std::vector<std::shared_ptr<krecord<K, V>>> _records;
+    std::vector<std::shared_ptr<kevent<K, V>>> _decoded;
+    std::vector<std::function<void()>> _decode_tasks;
     kafka_consumer _impl;
     std::shared_ptr<KEY_CODEC> _key_codec;
     std::shared_ptr<VAL_CODEC> _val_codec;
+    std::shared_ptr<worker_pool> _decode_pool;
+    std::shared_ptr<memory_budget> _memory_budget;
+    read_ahead_buffer _read_ahead;
+    std::atomic<bool> _throttled;
+    std::mutex _throttle_mutex;
+    std::condition_variable _throttle_cv;
     commit_chain _commit_chain;
     int64_t _start_point_ms;
+    bool _spool_to_start_point=false;
     metric_counter _parse_errors;
     metric_gauge _commit_chain_size;
+    metric_gauge _buffered_bytes;
+    metric_gauge _read_ahead_limit;
+    metric_gauge _memory_budget_used;
     //metric_evaluator _commit_chain_size;
   };
 
@@ -214,7 +364,7 @@ namespace kspp {
     }
 
   protected:
-    std::shared_ptr<kevent<K, V>> parse(const std::unique_ptr<RdKafka::Message> &ref) override {
+    std::shared_ptr<krecord<K, V>> parse(std::unique_ptr<RdKafka::Message> &ref) override {
       if (!ref)
         return nullptr;
 
@@ -246,6 +396,11 @@ namespace kspp {
       std::shared_ptr<V> tmp_value = nullptr;
 
       size_t sz = ref->len();
+      if (sz && this->_lazy_values) {
+        auto lazy = std::make_shared<kafka_lazy_value<V, VAL_CODEC>>(*ref, this->_val_codec);
+        return std::make_shared<krecord<K, V>>(tmp_key, lazy, timestamp);
+      }
+
       if (sz) {
         tmp_value = std::make_shared<V>();
         size_t consumed = this->_val_codec->decode((const char *) ref->payload(), sz, *tmp_value);
@@ -258,8 +413,7 @@ namespace kspp {
           return nullptr;
         }
       }
-      auto record = std::make_shared<krecord<K, V>>(tmp_key, tmp_value, timestamp);
-      return std::make_shared<kevent<K, V>>(record, this->_commit_chain.create(ref->offset()));
+      return std::make_shared<krecord<K, V>>(tmp_key, tmp_value, timestamp);
     }
   };
 
@@ -296,12 +450,16 @@ namespace kspp {
     }
 
   protected:
-    std::shared_ptr<kevent<void, V>> parse(const std::unique_ptr<RdKafka::Message> &ref) override {
+    std::shared_ptr<krecord<void, V>> parse(std::unique_ptr<RdKafka::Message> &ref) override {
       if (!ref)
         return nullptr;
       size_t sz = ref->len();
       if (sz) {
         int64_t timestamp = (ref->timestamp().timestamp >= 0) ? ref->timestamp().timestamp : milliseconds_since_epoch();
+        if (this->_lazy_values) {
+          auto lazy = std::make_shared<kafka_lazy_value<V, VAL_CODEC>>(*ref, this->_val_codec);
+          return std::make_shared<krecord<void, V>>(lazy, timestamp);
+        }
         std::shared_ptr<V> tmp_value = std::make_shared<V>();
         size_t consumed = this->_val_codec->decode((const char *) ref->payload(), sz, *tmp_value);
 
@@ -315,8 +473,7 @@ namespace kspp {
           return nullptr;
         }
 
-        auto record = std::make_shared<krecord<void, V>>(tmp_value, timestamp);
-        return std::make_shared<kevent<void, V>>(record, this->_commit_chain.create(ref->offset()));
+        return std::make_shared<krecord<void, V>>(tmp_value, timestamp);
       }
       return nullptr; // just parsed an empty message???
     }
@@ -354,7 +511,7 @@ namespace kspp {
     }
 
   protected:
-    std::shared_ptr<kevent<K, void>> parse(const std::unique_ptr<RdKafka::Message> &ref) override {
+    std::shared_ptr<krecord<K, void>> parse(std::unique_ptr<RdKafka::Message> &ref) override {
       if (!ref || ref->key_len() == 0)
         return nullptr;
 
@@ -368,8 +525,7 @@ namespace kspp {
         LOG(ERROR) << this->log_name() << ", decode key failed, consumed: " << consumed << ", actual: " << ref->key_len();
         return nullptr;
       }
-      auto record = std::make_shared<krecord<K, void>>(tmp_key, timestamp);
-      return std::make_shared<kevent<K, void>>(record, this->_commit_chain.create(ref->offset()));
+      return std::make_shared<krecord<K, void>>(tmp_key, timestamp);
     }
   };
 }
@@ -0,0 +1,165 @@
+#include <memory>
+#include <sstream>
+#include <experimental/filesystem>
+#include <kspp/kspp.h>
+#include <kspp/utils/mmap_file.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * read only materialized source over an immutable sorted file (see mmap_file / avro2mmap)
+   * the file is mapped once per process and shared between all partitions and processes on the host
+   * keys and values are decoded directly from the mapped memory
+   */
+  template<class K, class V, class CODEC>
+  class mmap_store : public materialized_source<K, V> {
+    static constexpr const char* PROCESSOR_NAME = "mmap_store";
+  public:
+    enum { MAX_KEY_SIZE = 10000 };
+
+    class iterator_impl : public kmaterialized_source_iterator_impl<K, V> {
+    public:
+      enum seek_pos_e { BEGIN, END };
+
+      iterator_impl(std::shared_ptr<const mmap_file> file, std::shared_ptr<CODEC> codec, seek_pos_e pos)
+          : _file(file)
+          , _codec(codec)
+          , _index(pos == BEGIN ? 0 : file->size()) {
+      }
+
+      bool valid() const override {
+        return _index < _file->size();
+      }
+
+      void next() override {
+        if (_index < _file->size())
+          ++_index;
+      }
+
+      std::shared_ptr<const krecord<K, V>> item() const override {
+        if (!valid())
+          return nullptr;
+        K key;
+        if (_codec->decode(_file->key_data(_index), _file->key_size(_index), key) != _file->key_size(_index))
+          return nullptr;
+        auto value = std::make_shared<V>();
+        if (_codec->decode(_file->value_data(_index), _file->value_size(_index), *value) != _file->value_size(_index))
+          return nullptr;
+        return std::make_shared<krecord<K, V>>(key, value, -1);
+      }
+
+      bool operator==(const kmaterialized_source_iterator_impl<K, V> &other) const override {
+        if (valid() && !other.valid())
+          return false;
+        if (!valid() && !other.valid())
+          return true;
+        if (valid() && other.valid())
+          return _index == ((const iterator_impl &) other)._index;
+        return false;
+      }
+
+    private:
+      std::shared_ptr<const mmap_file> _file;
+      std::shared_ptr<CODEC> _codec;
+      size_t _index;
+    };
+
+    /**
+     * a relative filename is resolved against the storage root of config
+     */
+    mmap_store(std::shared_ptr<cluster_config> config, int32_t partition, std::experimental::filesystem::path filename, std::shared_ptr<CODEC> codec = std::make_shared<CODEC>())
+        : materialized_source<K, V>(nullptr, partition)
+        , _file(mmap_file::open(std::experimental::filesystem::path(config->get_storage_root()) / filename))
+        , _codec(codec) {
+      this->add_metrics_label(KSPP_PROCESSOR_TYPE_TAG, PROCESSOR_NAME);
+      this->add_metrics_label(KSPP_PARTITION_TAG, std::to_string(partition));
+    }
+
+    ~mmap_store() override {
+      close();
+    }
+
+    std::string log_name() const override {
+      return PROCESSOR_NAME;
+    }
+
+    std::string topic() const override {
+      return _file->path();
+    }
+
+    void start(int64_t offset) override {
+      // immutable - nothing to do
+    }
+
+    void commit(bool flush) override {
+      // immutable - nothing to do
+    }
+
+    void close() override {
+    }
+
+    bool eof() const override {
+      return true;
+    }
+
+    size_t process(int64_t tick) override {
+      return 0;
+    }
+
+    size_t queue_size() const override {
+      return 0;
+    }
+
+    int64_t next_event_time() const override {
+      return INT64_MAX;
+    }
+
+    std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, key, key_buf);
+      size_t index = _file->find(key_buf.data(), ksize);
+      if (index == _file->size())
+        return nullptr;
+      auto value = std::make_shared<V>();
+      if (_codec->decode(_file->value_data(index), _file->value_size(index), *value) != _file->value_size(index)) {
+        LOG(ERROR) << PROCESSOR_NAME << ", failed to decode value in " << _file->path();
+        return nullptr;
+      }
+      return std::make_shared<krecord<K, V>>(key, value, -1);
+    }
+
+    typename kspp::materialized_source<K, V>::iterator begin(void) const override {
+      return typename kspp::materialized_source<K, V>::iterator(
+          std::make_shared<iterator_impl>(_file, _codec, iterator_impl::BEGIN));
+    }
+
+    typename kspp::materialized_source<K, V>::iterator end() const override {
+      return typename kspp::materialized_source<K, V>::iterator(
+          std::make_shared<iterator_impl>(_file, _codec, iterator_impl::END));
+    }
+
+    /**
+     * writes all records of a materialized source (or any range of records) to a mmap file
+     */
+    template<class IT>
+    static bool write(std::experimental::filesystem::path filename, IT first, IT last, std::shared_ptr<CODEC> codec = std::make_shared<CODEC>()) {
+      mmap_file_writer writer(filename);
+      for (; first != last; ++first) {
+        std::shared_ptr<const krecord<K, V>> record = *first;
+        if (!record || !record->value())
+          continue;
+        std::stringstream ks;
+        std::stringstream vs;
+        codec->encode(record->key(), ks);
+        codec->encode(*record->value(), vs);
+        writer.add(ks.str(), vs.str());
+      }
+      return writer.close();
+    }
+
+  private:
+    std::shared_ptr<const mmap_file> _file;
+    std::shared_ptr<CODEC> _codec;
+  };
+}
@@ -45,7 +45,8 @@ namespace kspp {
       typename std::map<K, std::shared_ptr<const krecord<K, V>>>::const_iterator _it;
     };
 
-    mem_counter_store(std::experimental::filesystem::path storage_path) {
+    mem_counter_store(std::experimental::filesystem::path storage_path)
+            : _current_offset(-1) {
     }
 
     static std::string type_name() {
@@ -63,8 +64,10 @@ namespace kspp {
 
       // non existing - create - TBD should we keep a tombstone???
       if (item == _store.end()) {
-        if (record->value())
+        if (record->value()) {
           _store[record->key()] = record;
+          _snapshots.changed(record->key(), record);
+        }
         return;
       }
 
@@ -74,6 +77,7 @@ namespace kspp {
         V new_value = *(item->second->value()) + *(record->value());
         int64_t timestamp = std::max<int64_t>(item->second->event_time(), record->event_time());
         item->second = std::make_shared<krecord<K, V>>(item->first, new_value, timestamp);
+        _snapshots.changed(item->first, item->second);
         return;
       }
 
@@ -82,6 +86,7 @@ namespace kspp {
         return;
 
       _store.erase(record->key());
+      _snapshots.changed(record->key(), nullptr);
     }
 
     /**
@@ -105,13 +110,14 @@ namespace kspp {
     /**
     * Returns a key-value pair with the given key
     */
-    std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
+    std::shared_ptr<const krecord<K, V>> _get(const K &key) const override {
       auto it = _store.find(key);
       return (it == _store.end()) ? nullptr : it->second;
     }
 
     void clear() override {
       _store.clear();
+      _snapshots.cleared();
       _current_offset = -1;
     }
 
@@ -124,6 +130,18 @@ namespace kspp {
     }
 
 
+    void enable_snapshots(std::chrono::milliseconds interval) override {
+      _snapshots.enable(interval);
+    }
+
+    void publish_snapshot(int64_t tick) override {
+      _snapshots.publish(tick, _store, _current_offset);
+    }
+
+    std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const override {
+      return _snapshots.snapshot();
+    }
+
     typename kspp::materialized_source<K, V>::iterator begin(void) const override {
       return typename kspp::materialized_source<K, V>::iterator(
               std::make_shared<iterator_impl>(_store, iterator_impl::BEGIN));
@@ -137,5 +155,6 @@ namespace kspp {
   private:
     std::map<K, std::shared_ptr<const krecord<K, V>>> _store;
     int64_t _current_offset;
+    mem_snapshot_publisher<K, V> _snapshots;
   };
 }
@@ -45,7 +45,8 @@ namespace kspp {
       typename std::map<K, std::shared_ptr<const krecord<K, V>>>::const_iterator _it;
     };
 
-    mem_store(std::experimental::filesystem::path storage_path) {
+    mem_store(std::experimental::filesystem::path storage_path)
+            : _current_offset(-1) {
     }
 
     static std::string type_name() {
@@ -64,8 +65,10 @@ namespace kspp {
 
       // non existing - TBD should we keep a tombstone???
       if (item == _store.end()) {
-        if (record->value())
+        if (record->value()) {
           _store[record->key()] = record;
+          _snapshots.changed(record->key(), record);
+        }
         return;
       }
 
@@ -73,10 +76,13 @@ namespace kspp {
       if (item->second->event_time() > record->event_time())
         return;
 
-      if (record->value())
+      if (record->value()) {
         item->second = record;
-      else
+        _snapshots.changed(record->key(), record);
+      } else {
         _store.erase(record->key());
+        _snapshots.changed(record->key(), nullptr);
+      }
     }
 
     /**
@@ -100,13 +106,14 @@ namespace kspp {
     /**
     * Returns a key-value pair with the given key
     */
-    std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
+    std::shared_ptr<const krecord<K, V>> _get(const K &key) const override {
       auto it = _store.find(key);
       return (it == _store.end()) ? nullptr : it->second;
     }
 
     void clear() override {
       _store.clear();
+      _snapshots.cleared();
       _current_offset = -1;
     }
 
@@ -136,10 +143,23 @@ namespace kspp {
         return;
       }
       _store.erase(oldest_key);
+      _snapshots.changed(oldest_key, nullptr);
       if (this->_sink)
         this->_sink(std::make_shared<kevent<K, V>>(std::make_shared<krecord<K, V>>(oldest_key, nullptr, tick)));
     }
 
+    void enable_snapshots(std::chrono::milliseconds interval) override {
+      _snapshots.enable(interval);
+    }
+
+    void publish_snapshot(int64_t tick) override {
+      _snapshots.publish(tick, _store, _current_offset);
+    }
+
+    std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const override {
+      return _snapshots.snapshot();
+    }
+
     typename kspp::materialized_source<K, V>::iterator begin(void) const override {
       return typename kspp::materialized_source<K, V>::iterator(
               std::make_shared<iterator_impl>(_store, iterator_impl::BEGIN));
@@ -153,5 +173,6 @@ namespace kspp {
   private:
     std::map<K, std::shared_ptr<const krecord<K, V>>> _store;
     int64_t _current_offset;
+    mem_snapshot_publisher<K, V> _snapshots;
   };
 }
@@ -1,67 +1,43 @@
-#include <map>
+#include <unordered_map>
+#include <vector>
 #include <chrono>
 #include <cstdint>
+#include <boost/functional/hash.hpp>
 #include <kspp/kspp.h>
+#include <kspp/internal/token_bucket.h>
 #include "state_store.h"
 #pragma once
 
 namespace kspp {
-  template<class K, class V>
+  /*
+   * buckets are stored inline in a hash map
+   * a bucket that has refilled to capacity is identical to a missing bucket so it is evicted lazily
+   * by an expiry wheel that is advanced by the timestamps passed to consume / insert / garbage_collect
+   */
+  template<class K, class V, class CODEC=void>
   class mem_token_bucket_store : public state_store<K, V> {
   protected:
-    struct config {
-      config(int64_t filltime_, V capacity_)
-              : filltime(filltime_), capacity(capacity_), min_tick(std::max<int64_t>(1, filltime_ / capacity_)),
-                fillrate_per_ms(((double) capacity) / filltime) {}
-
-      int64_t filltime;
-      V capacity;
-      int64_t min_tick;
-      double fillrate_per_ms;
-    };
+    enum { NR_OF_SLOTS = 64 };
+
+    typedef token_bucket_config<V> config;
 
-    class bucket {
+    class bucket : public token_bucket<V> {
     public:
       bucket(V capacity)
-              : _tokens(capacity), _tstamp(0) {}
-
-      inline bool consume_one(const config *conf, int64_t ts) {
-        __age(conf, ts);
-        if (_tokens == 0)
-          return false;
-        _tokens -= 1;
-        return true;
-      }
-
-      inline V token() const {
-        return _tokens;
-      }
+          : token_bucket<V>(capacity) {}
 
-      inline int64_t timestamp() const {
-        return _tstamp;
-      }
-
-    protected:
-      void __age(const config *conf, int64_t ts) {
-        auto delta_ts = ts - _tstamp;
-        int64_t delta_count = (int64_t) (delta_ts * conf->fillrate_per_ms);
-        if (delta_count > 0) { // no ageing on negative deltas
-          _tstamp = ts;
-          _tokens = (V) std::min<int64_t>(conf->capacity, _tokens + delta_count);
-        }
-      }
+      int32_t _wheel_slot = -1; // slot in expiry wheel or -1 if not scheduled
+    };
 
-      V _tokens;
-      int64_t _tstamp;
-    }; // class bucket
+    typedef std::unordered_map<K, bucket, boost::hash<K>> container;
 
     class iterator_impl
             : public kmaterialized_source_iterator_impl<K, V> {
     public:
       enum seek_pos_e { BEGIN, END };
 
-      iterator_impl(const std::map<K, std::shared_ptr<bucket>> &container, seek_pos_e pos)
-              : _container(container), _it(pos == BEGIN ? _container.begin() : _container.end()) {}
+      iterator_impl(const container &c, seek_pos_e pos)
+              : _container(c), _it(pos == BEGIN ? _container.begin() : _container.end()) {}
 
       bool valid() const override {
         return _it != _container.end();
@@ -76,7 +52,7 @@ namespace kspp {
       std::shared_ptr<const krecord<K, V>> item() const override {
         if (_it == _container.end())
           return nullptr;
-        return std::make_shared<kspp::krecord<K, V>>(_it->first, _it->second->token(), _it->second->timestamp());
+        return std::make_shared<kspp::krecord<K, V>>(_it->first, _it->second.token(), _it->second.timestamp());
       }
 
       bool operator==(const kmaterialized_source_iterator_impl<K, V> &other) const override {
@@ -85,18 +61,26 @@ namespace kspp {
         if (!valid() && !other.valid())
           return true;
         if (valid() && other.valid())
-          return _it->first == ((const iterator_impl &) other)._it->first;
+          return _it == ((const iterator_impl &) other)._it;
         return false;
       }
 
     private:
-      const std::map<K, std::shared_ptr<bucket>> &_container;
-      typename std::map<K, std::shared_ptr<bucket>>::const_iterator _it;
+      const container &_container;
+      typename container::const_iterator _it;
     };
 
   public:
     mem_token_bucket_store(std::chrono::milliseconds agetime, V capacity)
-            : state_store<K, V>(), _config(agetime.count(), capacity), _current_offset(-1) {
+            : state_store<K, V>()
+            , _config(agetime.count(), capacity)
+            , _slot_width(std::max<int64_t>(1, (2 * agetime.count()) / NR_OF_SLOTS))
+            , _wheel(NR_OF_SLOTS)
+            , _current_offset(-1) {
+    }
+
+    mem_token_bucket_store(std::experimental::filesystem::path storage_path, std::chrono::milliseconds agetime, V capacity)
+            : mem_token_bucket_store(agetime, capacity) {
     }
 
     static std::string type_name() {
@@ -124,19 +108,24 @@ namespace kspp {
       _current_offset = offset;
     }
 
+    void garbage_collect(int64_t tick) override {
+      expire(tick);
+    }
+
     /**
     * Adds count to bucket
     * returns true if bucket has capacity
+    * offset is the event's offset and is what commit() stores
     */
-    bool consume(const K &key, int64_t timestamp)  {
-      typename std::map<K, std::shared_ptr<bucket>>::iterator item = _buckets.find(key);
-      if (item == _buckets.end()) {
-        auto b = std::make_shared<bucket>(_config.capacity);
-        bool res = b->consume_one(&_config, timestamp);
-        _buckets[key] = b;
-        return res;
-      }
-      return item->second->consume_one(&_config, timestamp);
+    bool consume(const K &key, int64_t timestamp, int64_t offset)  {
+      _current_offset = std::max<int64_t>(_current_offset, offset);
+      expire(timestamp);
+      auto item = _buckets.find(key);
+      if (item == _buckets.end())
+        item = _buckets.emplace(key, bucket(_config.capacity)).first;
+      bool res = item->second.consume_one(&_config, timestamp);
+      schedule(item->first, item->second);
+      return res;
     }
 
     //this can and will override bucket capacity but bucket will stay in correct state
@@ -145,16 +134,13 @@ namespace kspp {
       if (record->value() == nullptr) {
         _buckets.erase(record->key());
       } else {
-        typename std::map<K, std::shared_ptr<bucket>>::iterator item = _buckets.find(record->key());
-        if (item == _buckets.end()) {
-          auto b = std::make_shared<bucket>(_config.capacity);
-          for (size_t i = 0; i != *record->value(); ++i)
-            b->consume_one(&_config, record->event_time());
-          _buckets[record->key()] = b;
-          return;
-        }
+        expire(record->event_time());
+        auto item = _buckets.find(record->key());
+        if (item == _buckets.end())
+          item = _buckets.emplace(record->key(), bucket(_config.capacity)).first;
         for (V i = 0; i != *record->value(); ++i) // bug only works por posituve...
-          item->second->consume_one(&_config, record->event_time());
+          item->second.consume_one(&_config, record->event_time());
+        schedule(item->first, item->second);
       }
     }
 
@@ -170,18 +156,21 @@ namespace kspp {
     */
     void clear() override {
       _buckets.clear();
+      for (auto &i : _wheel)
+        i.clear();
+      _wheel_pos = -1;
       _current_offset = -1;
     }
 
     /**
     * Returns the counter for the given key
     */
-    std::shared_ptr<const kspp::krecord<K, V>> get(const K &key) const override {
-      typename std::map<K, std::shared_ptr<bucket>>::const_iterator item = _buckets.find(key);
+    std::shared_ptr<const kspp::krecord<K, V>> _get(const K &key) const override {
+      auto item = _buckets.find(key);
       if (item == _buckets.end()) {
         return std::make_shared<kspp::krecord<K, V>>(key, _config.capacity, -1);
       }
-      return std::make_shared<kspp::krecord<K, V>>(key, item->second->token(), item->second->timestamp());
+      return std::make_shared<kspp::krecord<K, V>>(key, item->second.token(), item->second.timestamp());
     }
 
     size_t aprox_size() const override {
@@ -203,8 +192,50 @@ namespace kspp {
     }
 
   protected:
+    // every bucket is in the wheel at most once
+    void schedule(const K &key, bucket &b) {
+      if (b._wheel_slot >= 0)
+        return;
+      int64_t slot = std::max<int64_t>(b.full_at(&_config) / _slot_width, _wheel_pos);
+      // never schedule into the slot that is currently being expired
+      slot = std::min<int64_t>(slot, _wheel_pos + NR_OF_SLOTS - 2);
+      b._wheel_slot = (int32_t) (slot % NR_OF_SLOTS);
+      _wheel[b._wheel_slot].push_back(key);
+    }
+
+    void expire(int64_t ts) {
+      int64_t target = ts / _slot_width;
+      if (_wheel_pos < 0) {
+        _wheel_pos = target;
+        return;
+      }
+
+      // after a full turn every scheduled bucket has been visited once
+      for (size_t steps = 0; _wheel_pos < target && steps != NR_OF_SLOTS; ++steps) {
+        int32_t index = (int32_t) (_wheel_pos % NR_OF_SLOTS);
+        std::vector<K> keys;
+        keys.swap(_wheel[index]);
+        ++_wheel_pos;
+        for (const auto &key : keys) {
+          auto item = _buckets.find(key);
+          if (item == _buckets.end() || item->second._wheel_slot != index)
+            continue; // deleted or stale
+          if (item->second.full_at(&_config) <= ts) {
+            _buckets.erase(item);
+          } else {
+            item->second._wheel_slot = -1;
+            schedule(item->first, item->second);
+          }
+        }
+      }
+      _wheel_pos = std::max<int64_t>(_wheel_pos, target);
+    }
+
     const config _config;
-    std::map<K, std::shared_ptr<bucket>> _buckets;
+    const int64_t _slot_width;
+    container _buckets;
+    std::vector<std::vector<K>> _wheel;
+    int64_t _wheel_pos = -1;
     int64_t _current_offset;
   };
 }
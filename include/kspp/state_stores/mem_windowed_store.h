@@ -134,7 +134,7 @@ namespace kspp {
       if (new_slot < _oldest_kept_slot)
         return;
 
-      auto old_record = get(record->key());
+      auto old_record = _get(record->key());
       if (old_record == nullptr) {
         if (record->value()) {
           auto bucket_it = _buckets.find(new_slot);
@@ -213,7 +213,7 @@ namespace kspp {
     /**
     * Returns a key-value pair with the given key
     */
-    std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
+    std::shared_ptr<const krecord<K, V>> _get(const K &key) const override {
       for (auto &&i : _buckets) {
         auto item = i.second->find(key);
         if (item != i.second->end()) {
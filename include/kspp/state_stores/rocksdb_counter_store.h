@@ -1,12 +1,16 @@
 #include <memory>
-#include <strstream>
+#include <atomic>
+#include <unordered_map>
 #include <fstream>
 #include <experimental/filesystem>
 #include <glog/logging.h>
 #include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
 #include <kspp/kspp.h>
 #include "state_store.h"
+#include <kspp/internal/rocksdb/rocksdb_metrics.h>
 #include <kspp/internal/rocksdb/rocksdb_operators.h>
+#include <kspp/internal/rocksdb/rocksdb_snapshot.h>
 #pragma once
 
 namespace kspp {
@@ -14,13 +18,15 @@ namespace kspp {
   class rocksdb_counter_store : public state_store<K, V> {
   public:
     enum { MAX_KEY_SIZE = 10000 };
+    enum { DEFAULT_MAX_BUFFERED_KEYS = 10000 };
 
     class iterator_impl : public kmaterialized_source_iterator_impl<K, V> {
     public:
       enum seek_pos_e { BEGIN, END };
 
-      iterator_impl(rocksdb::DB *db, std::shared_ptr<CODEC> codec, seek_pos_e pos)
-              : _it(db->NewIterator(rocksdb::ReadOptions()))
+      iterator_impl(rocksdb::DB *db, std::shared_ptr<CODEC> codec, seek_pos_e pos, std::shared_ptr<const rocksdb_snapshot_handle> snapshot = nullptr)
+              : _snapshot(snapshot)
+              , _it(db->NewIterator(snapshot ? snapshot->read_options() : rocksdb::ReadOptions()))
               , _codec(codec) {
         if (pos == BEGIN) {
           _it->SeekToFirst();
@@ -31,6 +37,13 @@ namespace kspp {
         }
       }
 
+      iterator_impl(std::shared_ptr<const rocksdb_snapshot_handle> snapshot, std::shared_ptr<CODEC> codec, const rocksdb::Slice &key)
+              : _snapshot(snapshot)
+              , _it(snapshot->db()->NewIterator(snapshot->read_options()))
+              , _codec(codec) {
+        _it->Seek(key);
+      }
+
       bool valid() const override {
         return _it->Valid();
       }
@@ -71,22 +84,83 @@ namespace kspp {
       }
 
     private:
+      std::shared_ptr<const rocksdb_snapshot_handle> _snapshot; // must outlive _it
       std::unique_ptr<rocksdb::Iterator> _it;
       std::shared_ptr<CODEC> _codec;
     };
 
-    rocksdb_counter_store(std::experimental::filesystem::path storage_path, std::shared_ptr<CODEC> codec = std::make_shared<CODEC>())
+    /*
+     * buffered increments are not visible in snapshots until they are flushed (at the latest on commit)
+     */
+    class snapshot_impl : public state_store_snapshot<K, V> {
+    public:
+      snapshot_impl(std::shared_ptr<rocksdb::DB> db, std::shared_ptr<CODEC> codec, int64_t offset)
+              : _handle(std::make_shared<rocksdb_snapshot_handle>(db))
+              , _codec(codec)
+              , _offset(offset) {
+      }
+
+      std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
+        static thread_local output_buffer key_buf;
+        key_buf.clear();
+        size_t ksize = codec_encode(*_codec, key, key_buf);
+        std::string str;
+        auto status = _handle->db()->Get(_handle->read_options(), rocksdb::Slice(key_buf.data(), ksize), &str);
+        if (!status.ok())
+          return nullptr;
+        return std::make_shared<krecord<K, V>>(key, std::make_shared<V>((V) Int64AddOperator::Deserialize(str)), -1);
+      }
+
+      typename kspp::materialized_source<K, V>::iterator begin() const override {
+        return typename kspp::materialized_source<K, V>::iterator(
+                std::make_shared<iterator_impl>(_handle->db(), _codec, iterator_impl::BEGIN, _handle));
+      }
+
+      typename kspp::materialized_source<K, V>::iterator end() const override {
+        return typename kspp::materialized_source<K, V>::iterator(
+                std::make_shared<iterator_impl>(_handle->db(), _codec, iterator_impl::END, _handle));
+      }
+
+      typename kspp::materialized_source<K, V>::iterator seek(const K &key) const override {
+        static thread_local output_buffer key_buf;
+        key_buf.clear();
+        size_t ksize = codec_encode(*_codec, key, key_buf);
+        return typename kspp::materialized_source<K, V>::iterator(
+                std::make_shared<iterator_impl>(_handle, _codec, rocksdb::Slice(key_buf.data(), ksize)));
+      }
+
+      int64_t offset() const override {
+        return _offset;
+      }
+
+    private:
+      std::shared_ptr<const rocksdb_snapshot_handle> _handle;
+      std::shared_ptr<CODEC> _codec;
+      const int64_t _offset;
+    };
+
+    /**
+     * increments are pre-aggregated per key in memory and written as one batch of merges
+     * on commit, when iterating or when max_buffered_keys distinct keys are buffered.
+     * max_buffered_keys <= 1 writes every increment directly
+     */
+    rocksdb_counter_store(std::experimental::filesystem::path storage_path,
+                          std::shared_ptr<CODEC> codec = std::make_shared<CODEC>(),
+                          size_t max_buffered_keys = DEFAULT_MAX_BUFFERED_KEYS)
             : _offset_storage_path(storage_path)
             , _codec(codec)
+            , _max_buffered_keys(max_buffered_keys)
             , _current_offset(kspp::OFFSET_BEGINNING)
             , _last_comitted_offset(kspp::OFFSET_BEGINNING)
-            , _last_flushed_offset(kspp::OFFSET_BEGINNING) {
+            , _last_flushed_offset(kspp::OFFSET_BEGINNING)
+            , _snapshot_offset(kspp::OFFSET_BEGINNING) {
       LOG_IF(FATAL, storage_path.generic_string().size()==0);
       std::experimental::filesystem::create_directories(storage_path);
       _offset_storage_path /= "kspp_offset.bin";
       rocksdb::Options options;
       options.IncreaseParallelism(); // should be #cores
       options.OptimizeLevelStyleCompaction();
+      options.statistics = _rocksdb_metrics.statistics;
       //options.merge_operator.reset(new Int64AddOperator);
       options.merge_operator = rocksdb::CreateInt64AddOperator();
       options.create_if_missing = true;
@@ -106,6 +180,7 @@ namespace kspp {
           _current_offset = tmp;
           _last_comitted_offset = tmp;
           _last_flushed_offset = tmp;
+          _snapshot_offset = tmp;
         }
       }
     }
@@ -114,8 +189,16 @@ namespace kspp {
       close();
     }
 
+    void add_metrics(processor *p) override {
+      state_store<K, V>::add_metrics(p);
+      _rocksdb_metrics.add_metrics(p);
+    }
+
     void close() override {
-      _db = nullptr;
+      if (_db)
+        flush_write_buffer();
+      // snapshots may still hold the database open
+      std::atomic_store(&_db, std::shared_ptr<rocksdb::DB>());
       //BOOST_LOG_TRIVIAL(info) << BOOST_CURRENT_FUNCTION << ", " << _name << " close()";
     }
 
@@ -132,31 +215,55 @@ namespace kspp {
     */
     void _insert(std::shared_ptr<const krecord <K, V>> record, int64_t offset) override {
       _current_offset = std::max<int64_t>(_current_offset, offset);
-      char key_buf[MAX_KEY_SIZE];
-      size_t ksize = 0;
-      std::strstream s(key_buf, MAX_KEY_SIZE);
-      ksize = _codec->encode(record->key(), s);
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, record->key(), key_buf);
       if (record->value()) {
-        std::string serialized = Int64AddOperator::Serialize((int64_t) *record->value());
-        auto status = _db->Merge(rocksdb::WriteOptions(), rocksdb::Slice(key_buf, ksize), serialized);
+        if (_max_buffered_keys <= 1) {
+          std::string serialized = Int64AddOperator::Serialize((int64_t) *record->value());
+          auto status = _db->Merge(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize), serialized);
+          _snapshot_offset.store(_current_offset, std::memory_order_release);
+          return;
+        }
+        _write_buffer[std::string(key_buf.data(), ksize)] += (int64_t) *record->value();
+        if (_write_buffer.size() >= _max_buffered_keys)
+          flush_write_buffer();
       } else {
-        auto status = _db->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf, ksize));
+        // a delete wipes all earlier increments so pending ones can be dropped
+        _write_buffer.erase(std::string(key_buf.data(), ksize));
+        auto status = _db->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize));
+        if (_write_buffer.empty())
+          _snapshot_offset.store(_current_offset, std::memory_order_release);
       }
     }
 
-    std::shared_ptr<const krecord <K, V>> get(const K &key) const override {
-      char key_buf[MAX_KEY_SIZE];
-      size_t ksize = 0;
-      std::ostrstream os(key_buf, MAX_KEY_SIZE);
-      ksize = _codec->encode(key, os);
+    std::shared_ptr<const krecord<K, V>> _get(const K &key) const override {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, key, key_buf);
       std::string str;
-      auto status = _db->Get(rocksdb::ReadOptions(), rocksdb::Slice(key_buf, ksize), &str);
-      if (!status.ok())
+      auto status = _db->Get(rocksdb::ReadOptions(), rocksdb::Slice(key_buf.data(), ksize), &str);
+      auto buffered = _write_buffer.find(std::string(key_buf.data(), ksize));
+      if (!status.ok() && buffered == _write_buffer.end())
         return nullptr;
-      auto res = std::make_shared<krecord<K, V>>(key, std::make_shared<V>((V) Int64AddOperator::Deserialize(str)), -1);
+      int64_t value = status.ok() ? Int64AddOperator::Deserialize(str) : 0;
+      if (buffered != _write_buffer.end())
+        value += buffered->second;
+      auto res = std::make_shared<krecord<K, V>>(key, std::make_shared<V>((V) value), -1);
       return res;
     }
 
+    /**
+     * thread safe - the snapshot reflects at least all increments up to its offset
+     */
+    std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const override {
+      int64_t offset = _snapshot_offset.load(std::memory_order_acquire);
+      auto db = std::atomic_load(&_db);
+      if (!db)
+        return nullptr;
+      return std::make_shared<snapshot_impl>(db, _codec, offset);
+    }
+
     /**
     * returns last offset
     */
@@ -174,6 +281,7 @@ namespace kspp {
     * commits the offset
     */
     void commit(bool flush) override {
+      flush_write_buffer();
       _last_comitted_offset = _current_offset;
       if (flush || ((_last_comitted_offset - _last_flushed_offset) > 10000)) {
         if (_last_flushed_offset != _last_comitted_offset) {
@@ -199,15 +307,18 @@ namespace kspp {
     }
 
     void clear() override {
+      _write_buffer.clear();
       for (auto it = iterator_impl(_db.get(), _codec, iterator_impl::BEGIN), end_ = iterator_impl(_db.get(), _codec, iterator_impl::END);
           it != end_;
           it.next()) {
         auto s = _db->Delete(rocksdb::WriteOptions(), it._key_slice());
       }
       _current_offset = kspp::OFFSET_BEGINNING;
+      _snapshot_offset.store(_current_offset, std::memory_order_release);
     }
 
     typename kspp::materialized_source<K, V>::iterator begin(void) const override {
+      flush_write_buffer();
       return typename kspp::materialized_source<K, V>::iterator(
               std::make_shared<iterator_impl>(_db.get(), _codec, iterator_impl::BEGIN));
     }
@@ -217,12 +328,34 @@ namespace kspp {
               std::make_shared<iterator_impl>(_db.get(), _codec, iterator_impl::END));
     }
 
+  protected:
+    void update_metrics() override {
+      if (_db)
+        _rocksdb_metrics.update({_db.get()});
+    }
+
   private:
+    void flush_write_buffer() const {
+      if (_write_buffer.empty())
+        return;
+      rocksdb::WriteBatch batch;
+      for (const auto &i : _write_buffer)
+        batch.Merge(i.first, Int64AddOperator::Serialize(i.second));
+      auto status = _db->Write(rocksdb::WriteOptions(), &batch);
+      LOG_IF(ERROR, !status.ok()) << "rocksdb_counter_store, failed to write batch: " << status.ToString();
+      _write_buffer.clear();
+      _snapshot_offset.store(_current_offset, std::memory_order_release);
+    }
+
     std::experimental::filesystem::path _offset_storage_path;
-    std::unique_ptr<rocksdb::DB> _db;    // maybe this should be a shared ptr since we're letting iterators out...
+    std::shared_ptr<rocksdb::DB> _db; // shared with snapshots
     std::shared_ptr<CODEC> _codec;
+    rocksdb_metrics _rocksdb_metrics;
+    const size_t _max_buffered_keys;
+    mutable std::unordered_map<std::string, int64_t> _write_buffer; // encoded key -> pending increment
     int64_t _current_offset;
     int64_t _last_comitted_offset;
     int64_t _last_flushed_offset;
+    mutable std::atomic<int64_t> _snapshot_offset; // offset of the last flushed increment
   };
 }
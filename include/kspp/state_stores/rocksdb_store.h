@@ -1,10 +1,12 @@
 #include <memory>
-#include <strstream>
+#include <atomic>
 #include <fstream>
 #include <experimental/filesystem>
 #include <glog/logging.h>
 #include <kspp/kspp.h>
 #include "state_store.h"
+#include <kspp/internal/rocksdb/rocksdb_metrics.h>
+#include <kspp/internal/rocksdb/rocksdb_snapshot.h>
 
 #ifdef WIN32
 //you dont want to know why this is needed...
@@ -25,8 +27,8 @@ namespace kspp {
     public:
       enum seek_pos_e { BEGIN, END };
 
-      iterator_impl(rocksdb::DB *db, std::shared_ptr<CODEC> codec, seek_pos_e pos)
-              : _it(db->NewIterator(rocksdb::ReadOptions())), _codec(codec) {
+      iterator_impl(rocksdb::DB *db, std::shared_ptr<CODEC> codec, seek_pos_e pos, std::shared_ptr<const rocksdb_snapshot_handle> snapshot = nullptr)
+              : _snapshot(snapshot), _it(db->NewIterator(snapshot ? snapshot->read_options() : rocksdb::ReadOptions())), _codec(codec) {
         if (pos == BEGIN) {
           _it->SeekToFirst();
         } else {
@@ -36,6 +38,11 @@ namespace kspp {
         }
       }
 
+      iterator_impl(std::shared_ptr<const rocksdb_snapshot_handle> snapshot, std::shared_ptr<CODEC> codec, const rocksdb::Slice &key)
+              : _snapshot(snapshot), _it(snapshot->db()->NewIterator(snapshot->read_options())), _codec(codec) {
+        _it->Seek(key);
+      }
+
       bool valid() const override {
         return _it->Valid();
       }
@@ -90,17 +97,57 @@ namespace kspp {
       }
 
     private:
+      std::shared_ptr<const rocksdb_snapshot_handle> _snapshot; // must outlive _it
       std::unique_ptr<rocksdb::Iterator> _it;
       std::shared_ptr<CODEC> _codec;
 
     };
 
+    class snapshot_impl : public state_store_snapshot<K, V> {
+    public:
+      snapshot_impl(std::shared_ptr<rocksdb::DB> db, std::shared_ptr<CODEC> codec, int64_t offset)
+              : _handle(std::make_shared<rocksdb_snapshot_handle>(db)), _codec(codec), _offset(offset) {
+      }
+
+      std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
+        return read_record(_handle->db(), _handle->read_options(), *_codec, key);
+      }
+
+      typename kspp::materialized_source<K, V>::iterator begin() const override {
+        return typename kspp::materialized_source<K, V>::iterator(
+                std::make_shared<iterator_impl>(_handle->db(), _codec, iterator_impl::BEGIN, _handle));
+      }
+
+      typename kspp::materialized_source<K, V>::iterator end() const override {
+        return typename kspp::materialized_source<K, V>::iterator(
+                std::make_shared<iterator_impl>(_handle->db(), _codec, iterator_impl::END, _handle));
+      }
+
+      typename kspp::materialized_source<K, V>::iterator seek(const K &key) const override {
+        static thread_local output_buffer key_buf;
+        key_buf.clear();
+        size_t ksize = codec_encode(*_codec, key, key_buf);
+        return typename kspp::materialized_source<K, V>::iterator(
+                std::make_shared<iterator_impl>(_handle, _codec, rocksdb::Slice(key_buf.data(), ksize)));
+      }
+
+      int64_t offset() const override {
+        return _offset;
+      }
+
+    private:
+      std::shared_ptr<const rocksdb_snapshot_handle> _handle;
+      std::shared_ptr<CODEC> _codec;
+      const int64_t _offset;
+    };
+
     rocksdb_store(std::experimental::filesystem::path storage_path, std::shared_ptr<CODEC> codec = std::make_shared<CODEC>())
             : _offset_storage_path(storage_path)
             , _codec(codec)
             , _current_offset(kspp::OFFSET_BEGINNING)
             , _last_comitted_offset(kspp::OFFSET_BEGINNING)
-            , _last_flushed_offset(kspp::OFFSET_BEGINNING) {
+            , _last_flushed_offset(kspp::OFFSET_BEGINNING)
+            , _snapshot_offset(kspp::OFFSET_BEGINNING) {
       LOG_IF(FATAL, storage_path.generic_string().size()==0);
       std::experimental::filesystem::create_directories(storage_path);
       _offset_storage_path /= "kspp_offset.bin";
@@ -108,6 +155,7 @@ namespace kspp {
       options.create_if_missing = true;
       options.IncreaseParallelism(); // should be #cores
       options.OptimizeLevelStyleCompaction();
+      options.statistics = _rocksdb_metrics.statistics;
       rocksdb::DB *tmp = nullptr;
       auto s = rocksdb::DB::Open(options, storage_path.generic_string(), &tmp);
       _db.reset(tmp);
@@ -125,6 +173,7 @@ namespace kspp {
           _current_offset = tmp;
           _last_comitted_offset = tmp;
           _last_flushed_offset = tmp;
+          _snapshot_offset = tmp;
         }
       }
     }
@@ -137,73 +186,57 @@ namespace kspp {
       return "rocksdb_store";
     }
 
+    void add_metrics(processor *p) override {
+      state_store<K, V>::add_metrics(p);
+      _rocksdb_metrics.add_metrics(p);
+    }
+
     void close() override {
-      _db = nullptr;
+      // snapshots may still hold the database open
+      std::atomic_store(&_db, std::shared_ptr<rocksdb::DB>());
     }
 
     void _insert(std::shared_ptr<const krecord<K, V>> record, int64_t offset) override {
       _current_offset = std::max<int64_t>(_current_offset, offset);
-      char key_buf[MAX_KEY_SIZE];
-      char val_buf[MAX_VALUE_SIZE];
-
-      size_t ksize = 0;
-      size_t vsize = 0;
+      static thread_local output_buffer key_buf;
+      static thread_local output_buffer val_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, record->key(), key_buf);
       //_current_offset = std::max<int64_t>(_current_offset, record->offset());
       if (record->value()) {
-        {
-          std::strstream s(key_buf, MAX_KEY_SIZE);
-          ksize = _codec->encode(record->key(), s);
-        }
-
         // write timestamp
+        val_buf.clear();
         int64_t tmp = record->event_time();
-        memcpy(val_buf, &tmp, sizeof(int64_t));
-        {
-          std::strstream s(val_buf + sizeof(int64_t), MAX_VALUE_SIZE - sizeof(int64_t));
-          vsize = _codec->encode(*record->value(), s) + +sizeof(int64_t);
-        }
-        rocksdb::Status status = _db->Put(rocksdb::WriteOptions(), rocksdb::Slice((char *) key_buf, ksize),
-                                          rocksdb::Slice(val_buf, vsize));
+        memcpy(val_buf.prepare(sizeof(int64_t)), &tmp, sizeof(int64_t));
+        val_buf.commit(sizeof(int64_t));
+        size_t vsize = codec_encode(*_codec, *record->value(), val_buf) + sizeof(int64_t);
+        rocksdb::Status status = _db->Put(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize),
+                                          rocksdb::Slice(val_buf.data(), vsize));
       } else {
-        std::strstream s(key_buf, MAX_KEY_SIZE);
-        ksize = _codec->encode(record->key(), s);
-        auto status = _db->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf, ksize));
+        auto status = _db->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize));
       }
+      _snapshot_offset.store(_current_offset, std::memory_order_release);
     }
 
-    std::shared_ptr<const krecord<K, V>> get(const K &key) const override{
-      char key_buf[MAX_KEY_SIZE];
-      size_t ksize = 0;
-      {
-        std::ostrstream s(key_buf, MAX_KEY_SIZE);
-        ksize = _codec->encode(key, s);
-      }
-
-      std::string payload;
-      rocksdb::Status s = _db->Get(rocksdb::ReadOptions(), rocksdb::Slice(key_buf, ksize), &payload);
-      if (!s.ok())
-        return nullptr;
-
-      int64_t timestamp = 0;
-      // sanity - at least timestamp
-      if (payload.size() < sizeof(int64_t))
-        return nullptr;
-      memcpy(&timestamp, payload.data(), sizeof(int64_t));
+    std::shared_ptr<const krecord<K, V>> _get(const K &key) const override {
+      return read_record(_db.get(), rocksdb::ReadOptions(), *_codec, key);
+    }
 
-      // read value
-      size_t actual_sz = payload.size() - sizeof(int64_t);
-      auto tmp_value = std::make_shared<V>();
-      size_t consumed = _codec->decode(payload.data() + sizeof(int64_t), actual_sz, *tmp_value);
-      if (consumed != actual_sz) {
-        LOG(ERROR) << "rockdb_store, decode payload failed, consumed:" << consumed << ", actual sz:" << actual_sz;
+    /**
+     * thread safe - the snapshot reflects at least all records up to its offset
+     */
+    std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const override {
+      int64_t offset = _snapshot_offset.load(std::memory_order_acquire);
+      auto db = std::atomic_load(&_db);
+      if (!db)
         return nullptr;
-      }
-      return std::make_shared<krecord<K, V>>(key, tmp_value, timestamp);
+      return std::make_shared<snapshot_impl>(db, _codec, offset);
     }
 
     //should we allow writing -2 in store??
     void start(int64_t offset) override {
       _current_offset = offset;
+      _snapshot_offset.store(_current_offset, std::memory_order_release);
       commit(true);
     }
 
@@ -250,6 +283,7 @@ namespace kspp {
         auto s = _db->Delete(rocksdb::WriteOptions(), it._key_slice());
       }
       _current_offset = kspp::OFFSET_BEGINNING;
+      _snapshot_offset.store(_current_offset, std::memory_order_release);
     }
 
 
@@ -263,13 +297,48 @@ namespace kspp {
               std::make_shared<iterator_impl>(_db.get(), _codec, iterator_impl::END));
     }
 
+  protected:
+    void update_metrics() override {
+      if (_db)
+        _rocksdb_metrics.update({_db.get()});
+    }
+
   private:
+    static std::shared_ptr<const krecord<K, V>> read_record(rocksdb::DB *db, const rocksdb::ReadOptions &options, CODEC &codec, const K &key) {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(codec, key, key_buf);
+
+      std::string payload;
+      rocksdb::Status s = db->Get(options, rocksdb::Slice(key_buf.data(), ksize), &payload);
+      if (!s.ok())
+        return nullptr;
+
+      int64_t timestamp = 0;
+      // sanity - at least timestamp
+      if (payload.size() < sizeof(int64_t))
+        return nullptr;
+      memcpy(&timestamp, payload.data(), sizeof(int64_t));
+
+      // read value
+      size_t actual_sz = payload.size() - sizeof(int64_t);
+      auto tmp_value = std::make_shared<V>();
+      size_t consumed = codec.decode(payload.data() + sizeof(int64_t), actual_sz, *tmp_value);
+      if (consumed != actual_sz) {
+        LOG(ERROR) << "rockdb_store, decode payload failed, consumed:" << consumed << ", actual sz:" << actual_sz;
+        return nullptr;
+      }
+      return std::make_shared<krecord<K, V>>(key, tmp_value, timestamp);
+    }
+
     std::experimental::filesystem::path _offset_storage_path;
-    std::unique_ptr<rocksdb::DB> _db;        // maybe this should be a shared ptr since we're letting iterators out...
+    std::shared_ptr<rocksdb::DB> _db; // shared with snapshots
     std::shared_ptr<CODEC> _codec;
+    rocksdb_metrics _rocksdb_metrics;
     int64_t _current_offset;
     int64_t _last_comitted_offset;
     int64_t _last_flushed_offset;
+    std::atomic<int64_t> _snapshot_offset;
   };
 }
 
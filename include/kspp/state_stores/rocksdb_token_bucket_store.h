@@ -0,0 +1,339 @@
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <experimental/filesystem>
+#include <glog/logging.h>
+#include <rocksdb/db.h>
+#include <rocksdb/compaction_filter.h>
+#include <kspp/kspp.h>
+#include <kspp/internal/token_bucket.h>
+#include "state_store.h"
+#include <kspp/internal/rocksdb/rocksdb_metrics.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * token buckets persisted in rocksdb so rate limits survive restarts - for very large key spaces
+   * values are stored as raw [tokens, timestamp], V must be trivially copyable
+   * buckets that are refilled to capacity at the highest timestamp passed to consume / insert / garbage_collect
+   * are dropped on compaction - event time like the buckets themselves, a wall clock ttl would drop buckets
+   * that are still draining when event time lags behind
+   */
+  template<class K, class V, class CODEC>
+  class rocksdb_token_bucket_store : public state_store<K, V> {
+  public:
+    enum { MAX_KEY_SIZE = 10000 };
+
+    typedef token_bucket_config<V> config;
+    typedef token_bucket<V> bucket;
+
+    class iterator_impl : public kmaterialized_source_iterator_impl<K, V> {
+    public:
+      enum seek_pos_e { BEGIN, END };
+
+      iterator_impl(rocksdb::DB *db, std::shared_ptr<CODEC> codec, seek_pos_e pos)
+          : _it(db->NewIterator(rocksdb::ReadOptions()))
+          , _codec(codec) {
+        if (pos == BEGIN) {
+          _it->SeekToFirst();
+        } else {
+          _it->SeekToLast(); // is there a better way to init to non valid??
+          if (_it->Valid()) // if not valid the Next() calls fails...
+            _it->Next(); // now it's invalid
+        }
+      }
+
+      bool valid() const override {
+        return _it->Valid();
+      }
+
+      void next() override {
+        if (!_it->Valid())
+          return;
+        _it->Next();
+      }
+
+      std::shared_ptr<const krecord<K, V>> item() const override {
+        if (!_it->Valid())
+          return nullptr;
+        rocksdb::Slice key_slice = _it->key();
+        K key;
+        if (_codec->decode(key_slice.data(), key_slice.size(), key) != key_slice.size())
+          return nullptr;
+        bucket b(0);
+        if (!deserialize(_it->value(), b))
+          return nullptr;
+        return std::make_shared<krecord<K, V>>(key, b.token(), b.timestamp());
+      }
+
+      bool operator==(const kmaterialized_source_iterator_impl<K, V> &other) const override {
+        if (valid() && !other.valid())
+          return false;
+        if (!valid() && !other.valid())
+          return true;
+        if (valid() && other.valid())
+          return _it->key() == ((const iterator_impl &) other)._it->key();
+        return false;
+      }
+
+      inline rocksdb::Slice _key_slice() const {
+        return _it->key();
+      }
+
+    private:
+      std::unique_ptr<rocksdb::Iterator> _it;
+      std::shared_ptr<CODEC> _codec;
+    };
+
+    rocksdb_token_bucket_store(std::experimental::filesystem::path storage_path, std::chrono::milliseconds agetime, V capacity, std::shared_ptr<CODEC> codec = std::make_shared<CODEC>())
+        : _config(agetime.count(), capacity)
+        , _offset_storage_path(storage_path)
+        , _expiry_filter(&_config)
+        , _codec(codec)
+        , _current_offset(kspp::OFFSET_BEGINNING)
+        , _last_comitted_offset(kspp::OFFSET_BEGINNING)
+        , _last_flushed_offset(kspp::OFFSET_BEGINNING) {
+      LOG_IF(FATAL, storage_path.generic_string().size()==0);
+      std::experimental::filesystem::create_directories(storage_path);
+      _offset_storage_path /= "kspp_offset.bin";
+      rocksdb::Options options;
+      options.IncreaseParallelism(); // should be #cores
+      options.OptimizeLevelStyleCompaction();
+      options.statistics = _rocksdb_metrics.statistics;
+      options.compaction_filter = &_expiry_filter;
+      options.create_if_missing = true;
+      rocksdb::DB *tmp = nullptr;
+      auto s = rocksdb::DB::Open(options, storage_path.generic_string(), &tmp);
+      _db.reset(tmp);
+      if (!s.ok()) {
+        LOG(FATAL) << "rocksdb_token_bucket_store, failed to open rocks db, path:" << storage_path.generic_string();
+        throw std::runtime_error(std::string("rocksdb_token_bucket_store, failed to open rocks db, path:") + storage_path.generic_string());
+      }
+
+      if (std::experimental::filesystem::exists(_offset_storage_path)) {
+        std::ifstream is(_offset_storage_path.generic_string(), std::ios::binary);
+        int64_t tmp;
+        is.read((char *) &tmp, sizeof(int64_t));
+        if (is.good()) {
+          _current_offset = tmp;
+          _last_comitted_offset = tmp;
+          _last_flushed_offset = tmp;
+        }
+      }
+    }
+
+    ~rocksdb_token_bucket_store() override {
+      close();
+    }
+
+    static std::string type_name() {
+      return "rocksdb_token_bucket_store";
+    }
+
+    void add_metrics(processor *p) override {
+      state_store<K, V>::add_metrics(p);
+      _rocksdb_metrics.add_metrics(p);
+    }
+
+    void close() override {
+      _db = nullptr;
+    }
+
+    void garbage_collect(int64_t tick) override {
+      _expiry_filter.advance(tick);
+    }
+
+    /**
+    * commits the offset
+    */
+    void commit(bool flush) override {
+      _last_comitted_offset = _current_offset;
+      if (flush || ((_last_comitted_offset - _last_flushed_offset) > 10000)) {
+        if (_last_flushed_offset != _last_comitted_offset) {
+          std::ofstream os(_offset_storage_path.generic_string(), std::ios::binary);
+          os.write((char *) &_last_comitted_offset, sizeof(int64_t));
+          _last_flushed_offset = _last_comitted_offset;
+          os.flush();
+        }
+      }
+    }
+
+    int64_t offset() const override {
+      return _current_offset;
+    }
+
+    void start(int64_t offset) override {
+      _current_offset = offset;
+      commit(true);
+    }
+
+    /**
+    * Adds count to bucket
+    * returns true if bucket has capacity
+    * offset is the event's offset and is what commit() stores
+    */
+    bool consume(const K &key, int64_t timestamp, int64_t offset) {
+      _current_offset = std::max<int64_t>(_current_offset, offset);
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, key, key_buf);
+      rocksdb::Slice key_slice(key_buf.data(), ksize);
+      _expiry_filter.advance(timestamp);
+      bucket b = load(key_slice);
+      bool res = b.consume_one(&_config, timestamp);
+      store(key_slice, b);
+      return res;
+    }
+
+    //this can and will override bucket capacity but bucket will stay in correct state
+    void _insert(std::shared_ptr<const krecord<K, V>> record, int64_t offset) override {
+      _current_offset = std::max<int64_t>(_current_offset, offset);
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, record->key(), key_buf);
+      rocksdb::Slice key_slice(key_buf.data(), ksize);
+      if (record->value() == nullptr) {
+        auto status = _db->Delete(rocksdb::WriteOptions(), key_slice);
+        return;
+      }
+      _expiry_filter.advance(record->event_time());
+      bucket b = load(key_slice);
+      for (V i = 0; i != *record->value(); ++i) // bug only works por posituve...
+        b.consume_one(&_config, record->event_time());
+      store(key_slice, b);
+    }
+
+    /**
+    * Deletes a counter
+    */
+    void del(const K &key) {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, key, key_buf);
+      auto status = _db->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize));
+    }
+
+    void clear() override {
+      for (auto it = iterator_impl(_db.get(), _codec, iterator_impl::BEGIN), end_ = iterator_impl(_db.get(), _codec, iterator_impl::END);
+           it != end_; it.next()) {
+        auto s = _db->Delete(rocksdb::WriteOptions(), it._key_slice());
+      }
+      _current_offset = kspp::OFFSET_BEGINNING;
+    }
+
+    /**
+    * Returns the counter for the given key
+    */
+    std::shared_ptr<const krecord<K, V>> _get(const K &key) const override {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, key, key_buf);
+      std::string payload;
+      bucket b(0);
+      auto status = _db->Get(rocksdb::ReadOptions(), rocksdb::Slice(key_buf.data(), ksize), &payload);
+      if (!status.ok() || !deserialize(payload, b))
+        return std::make_shared<krecord<K, V>>(key, _config.capacity, -1);
+      return std::make_shared<krecord<K, V>>(key, b.token(), b.timestamp());
+    }
+
+    size_t aprox_size() const override {
+      std::string num;
+      _db->GetProperty("rocksdb.estimate-num-keys", &num);
+      return std::stoll(num);
+    }
+
+    size_t exact_size() const override {
+      size_t sz = 0;
+      for (const auto &i : *this)
+        ++sz;
+      return sz;
+    }
+
+    typename kspp::materialized_source<K, V>::iterator begin(void) const override {
+      return typename kspp::materialized_source<K, V>::iterator(
+          std::make_shared<iterator_impl>(_db.get(), _codec, iterator_impl::BEGIN));
+    }
+
+    typename kspp::materialized_source<K, V>::iterator end() const override {
+      return typename kspp::materialized_source<K, V>::iterator(
+          std::make_shared<iterator_impl>(_db.get(), _codec, iterator_impl::END));
+    }
+
+  protected:
+    void update_metrics() override {
+      if (_db)
+        _rocksdb_metrics.update({_db.get()});
+    }
+
+  private:
+    // drops buckets that are full at the watermark, they are identical to missing ones - runs on rocksdb's compaction threads
+    class expiry_filter : public rocksdb::CompactionFilter {
+    public:
+      explicit expiry_filter(const config *conf)
+          : _config(conf)
+          , _watermark(INT64_MIN) {
+      }
+
+      bool Filter(int level, const rocksdb::Slice &key, const rocksdb::Slice &existing_value, std::string *new_value, bool *value_changed) const override {
+        bucket b(0);
+        return deserialize(existing_value, b) && b.full_at(_config) <= _watermark.load(std::memory_order_relaxed);
+      }
+
+      const char *Name() const override {
+        return "kspp_token_bucket_expiry";
+      }
+
+      inline void advance(int64_t ts) {
+        if (ts > _watermark.load(std::memory_order_relaxed))
+          _watermark.store(ts, std::memory_order_relaxed);
+      }
+
+    private:
+      const config *_config;
+      std::atomic<int64_t> _watermark;
+    };
+
+    static bool deserialize(const rocksdb::Slice &slice, bucket &b) {
+      if (slice.size() != sizeof(V) + sizeof(int64_t)) {
+        LOG(ERROR) << "rocksdb_token_bucket_store, bucket corruption, size: " << slice.size();
+        return false;
+      }
+      V tokens;
+      int64_t tstamp;
+      memcpy(&tokens, slice.data(), sizeof(V));
+      memcpy(&tstamp, slice.data() + sizeof(V), sizeof(int64_t));
+      b = bucket(tokens, tstamp);
+      return true;
+    }
+
+    bucket load(const rocksdb::Slice &key_slice) {
+      std::string payload;
+      bucket b(_config.capacity);
+      auto status = _db->Get(rocksdb::ReadOptions(), key_slice, &payload);
+      if (status.ok())
+        deserialize(payload, b);
+      return b;
+    }
+
+    void store(const rocksdb::Slice &key_slice, const bucket &b) {
+      char val_buf[sizeof(V) + sizeof(int64_t)];
+      V tokens = b.token();
+      int64_t tstamp = b.timestamp();
+      memcpy(val_buf, &tokens, sizeof(V));
+      memcpy(val_buf + sizeof(V), &tstamp, sizeof(int64_t));
+      auto status = _db->Put(rocksdb::WriteOptions(), key_slice, rocksdb::Slice(val_buf, sizeof(val_buf)));
+      LOG_IF(ERROR, !status.ok()) << "rocksdb_token_bucket_store, put failed: " << status.ToString();
+    }
+
+    const config _config;
+    std::experimental::filesystem::path _offset_storage_path;
+    expiry_filter _expiry_filter; // must outlive _db
+    std::unique_ptr<rocksdb::DB> _db;
+    std::shared_ptr<CODEC> _codec;
+    rocksdb_metrics _rocksdb_metrics;
+    int64_t _current_offset;
+    int64_t _last_comitted_offset;
+    int64_t _last_flushed_offset;
+  };
+}
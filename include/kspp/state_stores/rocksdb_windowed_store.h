@@ -1,11 +1,11 @@
 #include <memory>
-#include <strstream>
 #include <fstream>
 #include <experimental/filesystem>
 #include <glog/logging.h>
 
 #include <kspp/kspp.h>
 #include "state_store.h"
+#include <kspp/internal/rocksdb/rocksdb_metrics.h>
 
 #ifdef WIN32
 //you dont want to know why this is needed...
@@ -151,6 +151,11 @@ namespace kspp {
       return "rocksdb_windowed_store";
     }
 
+    void add_metrics(processor *p) override {
+      state_store<K, V>::add_metrics(p);
+      _rocksdb_metrics.add_metrics(p);
+    }
+
     void close() override {
       _buckets.clear();
     }
@@ -189,11 +194,8 @@ namespace kspp {
       if (new_slot < _oldest_kept_slot)
         return;
 
-      char key_buf[MAX_KEY_SIZE];
-      char val_buf[MAX_VALUE_SIZE];
-
       //_current_offset = std::max<int64_t>(_current_offset, record->offset());
-      auto old_record = get(record->key());
+      auto old_record = _get(record->key());
       if (old_record && old_record->event_time() > record->event_time())
         return;
 
@@ -204,6 +206,7 @@ namespace kspp {
           rocksdb::Options options;
           options.IncreaseParallelism(); // should be #cores
           options.OptimizeLevelStyleCompaction();
+          options.statistics = _rocksdb_metrics.statistics;
           options.create_if_missing = true;
           std::experimental::filesystem::path path(_storage_path);
           path /= std::to_string(new_slot);
@@ -224,15 +227,18 @@ namespace kspp {
         }
       }
 
+      static thread_local output_buffer key_buf;
+      static thread_local output_buffer val_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, record->key(), key_buf);
+
       //if we have an old value and it's from another slot - remove it.
       if (old_record) {
         int64_t old_slot = get_slot_index(old_record->event_time());
         if (old_slot != new_slot) {
-          std::strstream s(key_buf, MAX_KEY_SIZE);
-          size_t ksize = _codec->encode(record->key(), s);
           auto bucket_it = _buckets.find(old_slot);
           if (bucket_it != _buckets.end()) {
-            auto status = bucket_it->second->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf, ksize));
+            auto status = bucket_it->second->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize));
             if (!status.ok()) {
               LOG(ERROR) << "rocksdb_windowed_store, delete failed, path:"
                                        << _storage_path.generic_string() << ", slot:" << bucket_it->first;
@@ -243,35 +249,28 @@ namespace kspp {
 
       // write current data
       if (record->value()) {
-        std::strstream ks(key_buf, MAX_KEY_SIZE);
-        size_t ksize = _codec->encode(record->key(), ks);
-
         // write timestamp
+        val_buf.clear();
         int64_t tmp = record->event_time();
-        memcpy(val_buf, &tmp, sizeof(int64_t));
-        std::strstream vs(val_buf + sizeof(int64_t), MAX_VALUE_SIZE - sizeof(int64_t));
-        size_t vsize = _codec->encode(*record->value(), vs) + +sizeof(int64_t);
+        memcpy(val_buf.prepare(sizeof(int64_t)), &tmp, sizeof(int64_t));
+        val_buf.commit(sizeof(int64_t));
+        size_t vsize = codec_encode(*_codec, *record->value(), val_buf) + sizeof(int64_t);
 
-        rocksdb::Status status = bucket->Put(rocksdb::WriteOptions(), rocksdb::Slice((char *) key_buf, ksize),
-                                             rocksdb::Slice(val_buf, vsize));
+        rocksdb::Status status = bucket->Put(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize),
+                                             rocksdb::Slice(val_buf.data(), vsize));
       } else {
-        std::strstream s(key_buf, MAX_KEY_SIZE);
-        size_t ksize = _codec->encode(record->key(), s);
-        auto status = bucket->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf, ksize));
+        auto status = bucket->Delete(rocksdb::WriteOptions(), rocksdb::Slice(key_buf.data(), ksize));
       }
     }
 
-    std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
-      char key_buf[MAX_KEY_SIZE];
-      size_t ksize = 0;
-      {
-        std::ostrstream s(key_buf, MAX_KEY_SIZE);
-        ksize = _codec->encode(key, s);
-      }
+    std::shared_ptr<const krecord<K, V>> _get(const K &key) const override {
+      static thread_local output_buffer key_buf;
+      key_buf.clear();
+      size_t ksize = codec_encode(*_codec, key, key_buf);
 
       for (auto &&i : _buckets) {
         std::string payload;
-        rocksdb::Status s = i.second->Get(rocksdb::ReadOptions(), rocksdb::Slice(key_buf, ksize), &payload);
+        rocksdb::Status s = i.second->Get(rocksdb::ReadOptions(), rocksdb::Slice(key_buf.data(), ksize), &payload);
         if (s.ok()) {
           int64_t timestamp = 0;
           // sanity - at least timestamp
@@ -355,6 +354,14 @@ namespace kspp {
               std::make_shared<iterator_impl>(_buckets, _codec, iterator_impl::END));
     }
 
+  protected:
+    void update_metrics() override {
+      std::vector<rocksdb::DB *> dbs;
+      for (const auto &i : _buckets)
+        dbs.push_back(i.second.get());
+      _rocksdb_metrics.update(dbs);
+    }
+
   private:
     inline int64_t get_slot_index(int64_t timestamp) {
       return timestamp / _slot_width;
@@ -366,6 +373,7 @@ namespace kspp {
     int64_t _slot_width;
     size_t _nr_of_slots;
     std::shared_ptr<CODEC> _codec;
+    rocksdb_metrics _rocksdb_metrics;
     int64_t _current_offset;
     int64_t _last_comitted_offset;
     int64_t _last_flushed_offset;
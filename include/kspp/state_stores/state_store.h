@@ -4,17 +4,77 @@
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <chrono>
+#include "state_store_snapshot.h"
 #pragma once
 
 // this should inherit from a state-store base class...
 namespace kspp {
+  struct state_store_metrics {
+    state_store_metrics()
+        : get_latency("state_store_get_latency", "us", latency_buckets())
+        , insert_latency("state_store_insert_latency", "us", latency_buckets())
+        , delete_latency("state_store_delete_latency", "us", latency_buckets())
+        , get_hits("state_store_get_hits", "msg")
+        , get_misses("state_store_get_misses", "msg")
+        , size("state_store_size", "msg") {
+    }
+
+    void add_metrics(processor *p) {
+      p->add_metric(&get_latency);
+      p->add_metric(&insert_latency);
+      p->add_metric(&delete_latency);
+      p->add_metric(&get_hits);
+      p->add_metric(&get_misses);
+      p->add_metric(&size);
+    }
+
+    static std::vector<double> latency_buckets() {
+      return {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 100000};
+    }
+
+    metric_histogram get_latency;
+    metric_histogram insert_latency;
+    metric_histogram delete_latency;
+    metric_counter get_hits;
+    metric_counter get_misses;
+    metric_gauge size;
+  };
+
   template<class K, class V>
   class state_store {
   public:
     using sink_function = typename std::function<void(std::shared_ptr<kevent < K, V>>)>;
 
+    enum { METRICS_SAMPLE_MASK = 0x3F }; // latency is measured on every 64th operation
+    enum { METRICS_REFRESH_INTERVAL_MS = 10000 };
+
     virtual ~state_store() {}
 
+    /**
+     * registers the store metrics in the owning processor - must be called before the topology is started
+     */
+    virtual void add_metrics(processor *p) {
+      _metrics = std::make_unique<state_store_metrics>();
+      _metrics->add_metrics(p);
+    }
+
+    /**
+     * pushes accumulated metrics and refreshes the store size - cheap unless the refresh interval has passed
+     * @param tick now
+     */
+    void refresh_metrics(int64_t tick) {
+      if (!_metrics || tick < _next_metrics_refresh)
+        return;
+      _next_metrics_refresh = tick + METRICS_REFRESH_INTERVAL_MS;
+      _metrics->get_hits += _get_hits;
+      _metrics->get_misses += _get_misses;
+      _get_hits = 0;
+      _get_misses = 0;
+      _metrics->size.set(aprox_size());
+      update_metrics();
+    }
+
     /**
      * garbage collects elements if they should be deleted
      * @param tick now
@@ -34,6 +94,19 @@ namespace kspp {
     * Put or delete a record
     */
     inline void insert(std::shared_ptr<const krecord <K, V>> record, int64_t offset) {
+      // a null value from a failed lazy decode is not a delete - already logged by the decoder
+      if (record->decode_failed())
+        return;
+      if (_metrics && ((++_op_count & METRICS_SAMPLE_MASK) == 0)) {
+        auto t0 = std::chrono::steady_clock::now();
+        _insert(record, offset);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+        if (record->value())
+          _metrics->insert_latency.observe(us);
+        else
+          _metrics->delete_latency.observe(us);
+        return;
+      }
       _insert(record, offset);
     }
 
@@ -63,15 +136,64 @@ namespace kspp {
     /**
     * Returns a key-value pair with the given key
     */
-    virtual std::shared_ptr<const krecord <K, V>> get(const K &key) const = 0;
+    inline std::shared_ptr<const krecord <K, V>> get(const K &key) const {
+      if (!_metrics)
+        return _get(key);
+      std::shared_ptr<const krecord <K, V>> res;
+      if ((++_op_count & METRICS_SAMPLE_MASK) == 0) {
+        auto t0 = std::chrono::steady_clock::now();
+        res = _get(key);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+        _metrics->get_latency.observe(us);
+      } else {
+        res = _get(key);
+      }
+      if (res)
+        ++_get_hits;
+      else
+        ++_get_misses;
+      return res;
+    }
 
     virtual typename kspp::materialized_source<K, V>::iterator begin() const = 0;
 
     virtual typename kspp::materialized_source<K, V>::iterator end() const = 0;
 
+    /**
+     * makes snapshots available - must be called before the topology is started
+     * memory stores publishes a copy at most once per interval, rocksdb stores always have snapshots and ignores this
+     */
+    virtual void enable_snapshots(std::chrono::milliseconds interval) {}
+
+    /**
+     * called from the processing thread to publish changes to snapshots
+     * @param tick now
+     */
+    virtual void publish_snapshot(int64_t tick) {}
+
+    /**
+     * thread safe
+     * @return a read only view of the store or nullptr if the store does not support snapshots or they are not enabled
+     */
+    virtual std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const {
+      return nullptr;
+    }
+
   protected:
     virtual void _insert(std::shared_ptr<const krecord <K, V>> record, int64_t offset) = 0;
 
+    virtual std::shared_ptr<const krecord <K, V>> _get(const K &key) const = 0;
+
+    /**
+     * hook for store specific metrics, called from refresh_metrics
+     */
+    virtual void update_metrics() {}
+
     sink_function _sink;
+    std::unique_ptr<state_store_metrics> _metrics;
+    mutable uint64_t _op_count = 0;
+    mutable uint64_t _get_hits = 0;
+    mutable uint64_t _get_misses = 0;
+    int64_t _next_metrics_refresh = 0;
   };
 }
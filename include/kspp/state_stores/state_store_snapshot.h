@@ -0,0 +1,278 @@
+#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <vector>
+#include <kspp/krecord.h>
+#include <kspp/kspp.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * consistent read only view of a state store that can be used from any thread
+   * iteration order is the store order (key order for memory stores, encoded key order for rocksdb stores)
+   */
+  template<class K, class V>
+  class state_store_snapshot {
+  public:
+    virtual ~state_store_snapshot() {}
+
+    virtual std::shared_ptr<const krecord<K, V>> get(const K &key) const = 0;
+
+    virtual typename kspp::materialized_source<K, V>::iterator begin() const = 0;
+
+    virtual typename kspp::materialized_source<K, V>::iterator end() const = 0;
+
+    /**
+     * @return iterator to the first record with a key not before key in store order
+     */
+    virtual typename kspp::materialized_source<K, V>::iterator seek(const K &key) const = 0;
+
+    /**
+     * @return the store offset at the time the snapshot was taken
+     */
+    virtual int64_t offset() const = 0;
+  };
+
+  /*
+   * immutable view of a memory store - a base copy with layers of later changes on top
+   * a layer maps changed keys to their new record, nullptr for removed keys
+   */
+  template<class K, class V>
+  class mem_store_snapshot : public state_store_snapshot<K, V> {
+  public:
+    typedef std::map<K, std::shared_ptr<const krecord<K, V>>> container;
+    typedef std::vector<std::shared_ptr<const container>> layers;
+
+    // merges the layers (oldest first) in key order, the newest layer wins
+    class iterator_impl : public kmaterialized_source_iterator_impl<K, V> {
+    public:
+      enum seek_pos_t { BEGIN, END };
+
+      iterator_impl(const layers &l, seek_pos_t pos)
+          : _layers(l) {
+        for (auto &i : _layers)
+          _cursors.push_back(pos == BEGIN ? i->begin() : i->end());
+        settle();
+      }
+
+      iterator_impl(const layers &l, const K &key)
+          : _layers(l) {
+        for (auto &i : _layers)
+          _cursors.push_back(i->lower_bound(key));
+        settle();
+      }
+
+      bool valid() const override {
+        return _current >= 0;
+      }
+
+      void next() override {
+        if (_current < 0)
+          return;
+        advance(_cursors[_current]->first);
+        settle();
+      }
+
+      std::shared_ptr<const krecord<K, V>> item() const override {
+        return (_current < 0) ? nullptr : _cursors[_current]->second;
+      }
+
+      bool operator==(const kmaterialized_source_iterator_impl<K, V> &other) const override {
+        auto &o = (const iterator_impl &) other;
+        if (!valid() || !o.valid())
+          return valid() == o.valid();
+        return equal(_cursors[_current]->first, o._cursors[o._current]->first);
+      }
+
+    private:
+      inline bool equal(const K &a, const K &b) const {
+        return !_comp(a, b) && !_comp(b, a);
+      }
+
+      void advance(const K &key) {
+        K k = key; // the cursor holding key moves too
+        for (size_t i = 0; i != _cursors.size(); ++i) {
+          if (_cursors[i] != _layers[i]->end() && equal(_cursors[i]->first, k))
+            ++_cursors[i];
+        }
+      }
+
+      // moves to the next key that is not removed
+      void settle() {
+        while (true) {
+          _current = -1;
+          for (size_t i = 0; i != _cursors.size(); ++i) {
+            if (_cursors[i] == _layers[i]->end())
+              continue;
+            if (_current < 0 || !_comp(_cursors[_current]->first, _cursors[i]->first))
+              _current = (int) i; // equal keys - the later layer is newer
+          }
+          if (_current < 0 || _cursors[_current]->second)
+            return;
+          advance(_cursors[_current]->first);
+        }
+      }
+
+      const layers _layers;
+      std::vector<typename container::const_iterator> _cursors;
+      typename container::key_compare _comp;
+      int _current = -1;
+    };
+
+    mem_store_snapshot(layers l, int64_t offset)
+        : _layers(l), _offset(offset) {
+    }
+
+    std::shared_ptr<const krecord<K, V>> get(const K &key) const override {
+      for (auto i = _layers.rbegin(); i != _layers.rend(); ++i) {
+        auto it = (*i)->find(key);
+        if (it != (*i)->end())
+          return it->second;
+      }
+      return nullptr;
+    }
+
+    typename kspp::materialized_source<K, V>::iterator begin() const override {
+      return typename kspp::materialized_source<K, V>::iterator(
+          std::make_shared<iterator_impl>(_layers, iterator_impl::BEGIN));
+    }
+
+    typename kspp::materialized_source<K, V>::iterator end() const override {
+      return typename kspp::materialized_source<K, V>::iterator(
+          std::make_shared<iterator_impl>(_layers, iterator_impl::END));
+    }
+
+    typename kspp::materialized_source<K, V>::iterator seek(const K &key) const override {
+      return typename kspp::materialized_source<K, V>::iterator(
+          std::make_shared<iterator_impl>(_layers, key));
+    }
+
+    int64_t offset() const override {
+      return _offset;
+    }
+
+  private:
+    const layers _layers;
+    const int64_t _offset;
+  };
+
+  /*
+   * read-copy-update publishing of memory store snapshots
+   * the store is copied once when the first snapshot is published, after that the processing thread only
+   * publishes the keys changed since the last snapshot as a new layer - at most once per interval
+   * a background task merges the layers into a new base so lookups stay cheap
+   * readers atomically pick up the latest snapshot and old layers are reclaimed when the last reader drops them
+   */
+  template<class K, class V>
+  class mem_snapshot_publisher {
+  public:
+    typedef typename mem_store_snapshot<K, V>::container container;
+    typedef typename mem_store_snapshot<K, V>::layers layers;
+
+    enum { MAX_LAYERS = 8 };
+
+    void enable(std::chrono::milliseconds interval) {
+      _interval = interval.count();
+      _enabled = true;
+    }
+
+    /**
+     * key now holds record, nullptr if it was removed
+     */
+    inline void changed(const K &key, std::shared_ptr<const krecord<K, V>> record) {
+      if (!_enabled)
+        return;
+      _dirty = true;
+      if (!_layers.empty())
+        _changes[key] = record;
+    }
+
+    inline void cleared() {
+      if (!_enabled)
+        return;
+      _dirty = true;
+      _changes.clear();
+      if (!_layers.empty())
+        _layers = layers{std::make_shared<const container>()};
+      ++_generation; // a running merge is for the old content
+    }
+
+    inline void publish(int64_t tick, const container &c, int64_t offset) {
+      if (!_enabled || tick < _next_publish)
+        return;
+      _next_publish = tick + _interval;
+
+      if (_layers.empty()) {
+        _layers.push_back(std::make_shared<const container>(c));
+      } else {
+        bool merged = pick_up_merge();
+        if (!_dirty && !merged && offset == _published_offset)
+          return;
+        if (!_changes.empty()) {
+          _layers.push_back(std::make_shared<const container>(std::move(_changes)));
+          _changes.clear();
+        }
+        if (_layers.size() >= MAX_LAYERS && !_merge.valid())
+          start_merge();
+      }
+
+      std::shared_ptr<const state_store_snapshot<K, V>> s = std::make_shared<mem_store_snapshot<K, V>>(_layers, offset);
+      std::atomic_store(&_published, s);
+      _published_offset = offset;
+      _dirty = false;
+    }
+
+    // callable from any thread
+    std::shared_ptr<const state_store_snapshot<K, V>> snapshot() const {
+      return std::atomic_load(&_published);
+    }
+
+  private:
+    static std::shared_ptr<const container> merge(layers l) {
+      auto result = std::make_shared<container>(*l[0]);
+      for (size_t i = 1; i != l.size(); ++i) {
+        for (auto &j : *l[i]) {
+          if (j.second)
+            (*result)[j.first] = j.second;
+          else
+            result->erase(j.first);
+        }
+      }
+      return result;
+    }
+
+    void start_merge() {
+      _merged_layers = _layers.size();
+      _merge_generation = _generation;
+      _merge = std::async(std::launch::async, &mem_snapshot_publisher::merge, _layers);
+    }
+
+    // replaces the merged layers with the result if the merge is done
+    bool pick_up_merge() {
+      if (!_merge.valid() || _merge.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+      auto base = _merge.get();
+      if (_merge_generation != _generation)
+        return false;
+      layers l{base};
+      l.insert(l.end(), _layers.begin() + _merged_layers, _layers.end());
+      _layers = l;
+      return true;
+    }
+
+    bool _enabled = false;
+    bool _dirty = false;
+    int64_t _interval = 0;
+    int64_t _next_publish = 0;
+    int64_t _published_offset = 0;
+    container _changes;
+    layers _layers;
+    uint64_t _generation = 0;
+    uint64_t _merge_generation = 0;
+    size_t _merged_layers = 0;
+    std::future<std::shared_ptr<const container>> _merge;
+    std::shared_ptr<const state_store_snapshot<K, V>> _published;
+  };
+}
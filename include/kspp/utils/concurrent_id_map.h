@@ -0,0 +1,80 @@
+#include <atomic>
+#include <map>
+#include <cstdint>
+#include <kspp/utils/spinlock.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * insert only map from small integer ids (ie schema ids) to values
+   * lookups are lock free, inserts are serialized by a spinlock
+   * values are never moved or deleted so returned pointers are valid for the lifetime of the map
+   */
+  template<class T>
+  class concurrent_id_map {
+  public:
+    enum { CAPACITY = 1024 }; // must be a power of two
+    enum { MAX_PROBES = 16 };
+
+    concurrent_id_map() {
+      for (auto &i : _slots)
+        i.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~concurrent_id_map() {
+      for (auto &i : _slots)
+        delete i.load(std::memory_order_relaxed);
+    }
+
+    concurrent_id_map(const concurrent_id_map &) = delete;
+
+    concurrent_id_map &operator=(const concurrent_id_map &) = delete;
+
+    /**
+     * @return pointer to value or nullptr if not found
+     */
+    const T *find(int32_t id) const {
+      for (size_t i = 0; i != MAX_PROBES; ++i) {
+        const entry *e = _slots[(id + i) & (CAPACITY - 1)].load(std::memory_order_acquire);
+        if (e == nullptr)
+          return nullptr;
+        if (e->id == id)
+          return &e->value;
+      }
+      // all probed slots taken - might be in overflow
+      kspp::spinlock::scoped_lock xxx(_spinlock);
+      auto item = _overflow.find(id);
+      return (item == _overflow.end()) ? nullptr : &item->second;
+    }
+
+    /**
+     * inserts value unless the id already exists
+     * @return pointer to the stored value
+     */
+    const T *insert(int32_t id, T value) {
+      kspp::spinlock::scoped_lock xxx(_spinlock);
+      for (size_t i = 0; i != MAX_PROBES; ++i) {
+        auto &slot = _slots[(id + i) & (CAPACITY - 1)];
+        const entry *e = slot.load(std::memory_order_relaxed);
+        if (e == nullptr) {
+          e = new entry{id, std::move(value)};
+          slot.store(e, std::memory_order_release);
+          return &e->value;
+        }
+        if (e->id == id)
+          return &e->value;
+      }
+      return &_overflow.emplace(id, std::move(value)).first->second;
+    }
+
+  private:
+    struct entry {
+      const int32_t id;
+      const T value;
+    };
+
+    std::atomic<const entry *> _slots[CAPACITY];
+    mutable kspp::spinlock _spinlock;
+    std::map<int32_t, T> _overflow;
+  };
+}
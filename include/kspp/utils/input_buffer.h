@@ -0,0 +1,75 @@
+#include <cstring>
+#include <algorithm>
+#include <streambuf>
+#pragma once
+
+namespace kspp {
+  /*
+   * bounds checked reader over a borrowed byte range - the counterpart of output_buffer
+   * can be wrapped in a std::istream for codecs that only implement the stream interface
+   */
+  class input_buffer : public std::streambuf {
+  public:
+    input_buffer(const char *data, size_t size) {
+      char *p = const_cast<char *>(data);
+      setg(p, p, p + size);
+    }
+
+    input_buffer(const input_buffer &) = delete;
+
+    input_buffer &operator=(const input_buffer &) = delete;
+
+    /**
+     * current read position
+     */
+    inline const char *data() const {
+      return gptr();
+    }
+
+    inline size_t remaining() const {
+      return egptr() - gptr();
+    }
+
+    inline size_t consumed() const {
+      return gptr() - eback();
+    }
+
+    /**
+     * false after a read past the end
+     */
+    inline bool good() const {
+      return _good;
+    }
+
+    /**
+     * @return the next n bytes or nullptr if there are fewer left
+     */
+    inline const char *consume(size_t n) {
+      if (remaining() < n) {
+        _good = false;
+        return nullptr;
+      }
+      const char *p = gptr();
+      gbump((int) n);
+      return p;
+    }
+
+    inline bool read(void *dst, size_t n) {
+      const char *p = consume(n);
+      if (p)
+        memcpy(dst, p, n);
+      return p != nullptr;
+    }
+
+  protected:
+    std::streamsize xsgetn(char *s, std::streamsize n) override {
+      std::streamsize sz = std::min<std::streamsize>(n, remaining());
+      memcpy(s, gptr(), sz);
+      gbump((int) sz);
+      return sz;
+    }
+
+  private:
+    bool _good = true;
+  };
+}
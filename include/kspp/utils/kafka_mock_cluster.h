@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <string>
+#pragma once
+
+struct rd_kafka_s;
+struct rd_kafka_mock_cluster_s;
+
+namespace kspp {
+  /*
+   * in process kafka brokers from librdkafka's mock cluster, for tests and benchmarks
+   * use it through cluster_config::set_mock_cluster() so sources, sinks and kafka_utils run unmodified
+   * requires a librdkafka that ships rdkafka_mock.h (>= 1.4) - see available()
+   */
+  class kafka_mock_cluster {
+  public:
+    static bool available();
+
+    explicit kafka_mock_cluster(size_t nr_of_brokers);
+
+    ~kafka_mock_cluster();
+
+    kafka_mock_cluster(const kafka_mock_cluster &) = delete;
+
+    kafka_mock_cluster &operator=(const kafka_mock_cluster &) = delete;
+
+    /**
+     * broker list for cluster_config, ie plaintext://127.0.0.1:port,...
+     */
+    inline std::string brokers() const {
+      return _brokers;
+    }
+
+    inline size_t nr_of_brokers() const {
+      return _nr_of_brokers;
+    }
+
+    /**
+     * topics are otherwise created with the mock cluster defaults on first use
+     */
+    void create_topic(std::string topic, int32_t nr_of_partitions, int32_t replication_factor = 1);
+
+  private:
+    const size_t _nr_of_brokers;
+    std::string _brokers;
+    struct rd_kafka_s *_rk; // owns the mock brokers
+    struct rd_kafka_mock_cluster_s *_cluster;
+  };
+}
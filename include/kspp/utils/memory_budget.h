@@ -0,0 +1,111 @@
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <kspp/utils/spinlock.h>
+#pragma once
+
+namespace kspp {
+  /*
+   * process wide limit on payload bytes read ahead by sources but not yet processed
+   */
+  class memory_budget {
+  public:
+    explicit memory_budget(size_t max_bytes)
+        : _max_bytes(max_bytes)
+        , _used(0) {
+    }
+
+    inline void acquire(size_t bytes) {
+      _used += bytes;
+    }
+
+    inline void release(size_t bytes) {
+      _used -= bytes;
+    }
+
+    inline bool exhausted() const {
+      return _used >= _max_bytes;
+    }
+
+    inline size_t used() const {
+      return _used;
+    }
+
+    inline size_t max_bytes() const {
+      return _max_bytes;
+    }
+
+  private:
+    const size_t _max_bytes;
+    std::atomic<size_t> _used;
+  };
+
+  /*
+   * payload bytes one source has read ahead, released in fifo order as its events are processed
+   * the limit follows the processing rate so a source buffers about read_ahead_time of work
+   * add() is called by the fetching thread and remove() by the processing thread
+   */
+  class read_ahead_buffer {
+  public:
+    enum { MIN_READ_AHEAD_BYTES = 1024 * 1024 };
+
+    read_ahead_buffer(std::shared_ptr<memory_budget> budget,
+                      std::chrono::milliseconds read_ahead_time,
+                      size_t min_bytes = MIN_READ_AHEAD_BYTES);
+
+    ~read_ahead_buffer();
+
+    read_ahead_buffer(const read_ahead_buffer &) = delete;
+
+    read_ahead_buffer &operator=(const read_ahead_buffer &) = delete;
+
+    /**
+     * events=0 adds bytes that are released when all events added before them are removed
+     */
+    void add(size_t events, size_t bytes);
+
+    void remove(size_t events);
+
+    /**
+     * a source with nothing buffered may always read - otherwise a full budget could stall the topology
+     */
+    inline bool full() const {
+      return _bytes >= _limit || (_bytes > 0 && _budget && _budget->exhausted());
+    }
+
+    /**
+     * low watermark for a source that stopped reading - half its read ahead processed and room in the budget
+     */
+    inline bool drained() const {
+      return _bytes <= _limit / 2 && (_bytes == 0 || !_budget || !_budget->exhausted());
+    }
+
+    inline size_t bytes() const {
+      return _bytes;
+    }
+
+    inline size_t limit() const {
+      return _limit;
+    }
+
+  private:
+    struct entry {
+      size_t events;
+      size_t bytes;
+    };
+
+    void update_limit(size_t released);
+
+    std::shared_ptr<memory_budget> _budget;
+    const std::chrono::milliseconds _read_ahead_time;
+    const size_t _min_bytes;
+    spinlock _spinlock;
+    std::deque<entry> _entries;
+    std::atomic<size_t> _bytes;
+    std::atomic<size_t> _limit;
+    std::chrono::steady_clock::time_point _window_start;
+    size_t _window_bytes = 0;
+    double _bytes_per_second = 0;
+  };
+}
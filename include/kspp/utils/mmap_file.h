@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <experimental/filesystem>
+#pragma once
+
+namespace kspp {
+  /*
+   * immutable sorted key/value file that is mapped read-only into memory
+   * the same file is only mapped once per process and the pages are shared between processes on the host
+   * a file renamed in place under the same path is a different file and gets its own mapping
+   * all offsets, sizes and the key order are checked when the file is mapped
+   *
+   * layout (host byte order)
+   * magic "KSPPMMAP" (8 bytes)
+   * uint64 count
+   * uint64 offsets[count]  - offset from start of file to each entry, entries sorted by key bytes
+   * entries                - uint32 key_size, key bytes, uint32 value_size, value bytes
+   */
+  class mmap_file {
+  public:
+    ~mmap_file();
+
+    /**
+     * maps the file or returns the already mapped instance
+     * throws std::runtime_error if the file cannot be mapped or is not a valid mmap_file
+     */
+    static std::shared_ptr<const mmap_file> open(std::experimental::filesystem::path path);
+
+    inline size_t size() const {
+      return count_;
+    }
+
+    inline const char *key_data(size_t index) const {
+      return entry(index) + sizeof(uint32_t);
+    }
+
+    inline size_t key_size(size_t index) const {
+      return read_u32(entry(index));
+    }
+
+    inline const char *value_data(size_t index) const {
+      return key_data(index) + key_size(index) + sizeof(uint32_t);
+    }
+
+    inline size_t value_size(size_t index) const {
+      return read_u32(key_data(index) + key_size(index));
+    }
+
+    /**
+     * binary search on encoded key
+     * @return index of the key or size() if not found
+     */
+    size_t find(const char *key, size_t key_size) const;
+
+    const std::string &path() const {
+      return path_;
+    }
+
+  private:
+    mmap_file(std::string path);
+
+    inline const char *entry(size_t index) const {
+      uint64_t offset;
+      memcpy(&offset, data_ + HEADER_SIZE + index * sizeof(uint64_t), sizeof(uint64_t));
+      return data_ + offset;
+    }
+
+    static inline uint32_t read_u32(const char *p) {
+      uint32_t v;
+      memcpy(&v, p, sizeof(uint32_t));
+      return v;
+    }
+
+    // (dev, inode, mtime ns, size)
+    typedef std::tuple<uint64_t, uint64_t, int64_t, uint64_t> file_id;
+
+    // throws if any entry does not fit in the file or the keys are not sorted
+    void validate() const;
+
+    enum { HEADER_SIZE = 16 };
+    const std::string path_;
+    file_id id_;
+    int fd_ = -1;
+    const char *data_ = nullptr;
+    size_t file_size_ = 0;
+    size_t count_ = 0;
+
+    friend class mmap_file_writer;
+  };
+
+  /*
+   * builds a mmap_file - entries can be added in any order and are sorted on close
+   * the file is written to a temporary name and renamed in place so running readers keep their old mapping
+   */
+  class mmap_file_writer {
+  public:
+    mmap_file_writer(std::experimental::filesystem::path path);
+
+    ~mmap_file_writer();
+
+    void add(std::string key, std::string value);
+
+    inline size_t size() const {
+      return entries_.size();
+    }
+
+    /**
+     * sorts, deduplicates (last added wins) and writes the file
+     * @return true on success
+     */
+    bool close();
+
+  private:
+    std::experimental::filesystem::path path_;
+    std::vector<std::pair<std::string, std::string>> entries_;
+    bool closed_ = false;
+  };
+}
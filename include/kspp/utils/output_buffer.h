@@ -0,0 +1,119 @@
+#include <cstdlib>
+#include <cstring>
+#include <streambuf>
+#include <algorithm>
+#include <new>
+#pragma once
+
+namespace kspp {
+  /*
+   * growable contiguous malloc'ed buffer that can be written through a std::ostream
+   * the content can be handed over to kafka_producer (FREE mode) without copying
+   */
+  class output_buffer : public std::streambuf {
+  public:
+    enum { MIN_CAPACITY = 64 };
+
+    explicit output_buffer(size_t capacity_hint = 1024)
+        : _capacity_hint(std::max<size_t>(MIN_CAPACITY, capacity_hint)) {
+    }
+
+    ~output_buffer() override {
+      free(_data);
+    }
+
+    output_buffer(const output_buffer &) = delete;
+
+    output_buffer &operator=(const output_buffer &) = delete;
+
+    inline const char *data() const {
+      return _data;
+    }
+
+    inline size_t size() const {
+      return pptr() - pbase();
+    }
+
+    inline void clear() {
+      setp(_data, _data + _capacity);
+    }
+
+    /**
+     * makes room for at least n more bytes
+     * @return the current write position
+     */
+    inline char *prepare(size_t n) {
+      if ((size_t) (epptr() - pptr()) < n)
+        grow(n);
+      return pptr();
+    }
+
+    inline size_t capacity() const {
+      return _capacity;
+    }
+
+    inline size_t spare() const {
+      return epptr() - pptr();
+    }
+
+    /**
+     * marks n bytes written after prepare
+     */
+    inline void commit(size_t n) {
+      pbump((int) n);
+    }
+
+    /**
+     * gives back n committed bytes
+     */
+    inline void backup(size_t n) {
+      pbump(-(int) n);
+    }
+
+    /**
+     * transfers ownership of the content to the caller who must free() it
+     * the next write allocates a new block sized from this one
+     */
+    char *release() {
+      char *p = _data;
+      size_t sz = size();
+      _capacity_hint = std::max<size_t>(MIN_CAPACITY, sz + sz / 4);
+      _data = nullptr;
+      _capacity = 0;
+      setp(nullptr, nullptr);
+      return p;
+    }
+
+  protected:
+    int_type overflow(int_type ch) override {
+      if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+      *prepare(1) = traits_type::to_char_type(ch);
+      pbump(1);
+      return ch;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+      memcpy(prepare(n), s, n);
+      pbump((int) n);
+      return n;
+    }
+
+  private:
+    void grow(size_t n) {
+      size_t sz = size();
+      size_t capacity = std::max<size_t>(std::max<size_t>(_capacity_hint, 2 * _capacity), sz + n);
+      char *p = (char *) realloc(_data, capacity);
+      if (p == nullptr)
+        throw std::bad_alloc();
+      _data = p;
+      _capacity = capacity;
+      setp(_data, _data + _capacity);
+      pbump((int) sz);
+    }
+
+    char *_data = nullptr;
+    size_t _capacity = 0;
+    size_t _capacity_hint;
+  };
+}
@@ -0,0 +1,45 @@
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#pragma once
+
+namespace kspp {
+  /*
+   * fixed size thread pool for cpu bound work that is split into independent tasks
+   * shared between many callers, ie the kafka sources of a topology
+   */
+  class worker_pool {
+  public:
+    explicit worker_pool(size_t nr_of_threads);
+
+    ~worker_pool();
+
+    worker_pool(const worker_pool &) = delete;
+
+    worker_pool &operator=(const worker_pool &) = delete;
+
+    inline size_t size() const {
+      return _threads.size();
+    }
+
+    /**
+     * runs all tasks and returns when they are done
+     * the calling thread runs tasks too while it waits
+     */
+    void run(std::vector<std::function<void()>> &tasks);
+
+  private:
+    bool run_one();
+
+    void thread_f();
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<std::function<void()>> _queue;
+    bool _exit;
+    std::vector<std::thread> _threads;
+  };
+}
@@ -0,0 +1,210 @@
+#include <kspp/avro/avro_column_batch.h>
+#include <arpa/inet.h>
+#include <stdexcept>
+#include <glog/logging.h>
+#include <kspp/avro/avro_projection.h>
+
+namespace kspp {
+  avro_column::avro_column(std::string name, avro::Type type, bool nullable)
+      : _name(name)
+      , _type(type)
+      , _nullable(nullable) {
+    if (is_variable_width())
+      _offsets.push_back(0);
+  }
+
+  size_t avro_column::value_size() const {
+    switch (_type) {
+      case avro::AVRO_INT:
+      case avro::AVRO_FLOAT:
+        return 4;
+      case avro::AVRO_LONG:
+      case avro::AVRO_DOUBLE:
+        return 8;
+      case avro::AVRO_BOOL:
+        return 1;
+      default:
+        return 0;
+    }
+  }
+
+  void avro_column::reserve(size_t rows) {
+    if (_nullable)
+      _validity.reserve((rows + 7) / 8);
+    if (is_variable_width())
+      _offsets.reserve(rows + 1);
+    else
+      _values.reserve(rows * value_size());
+  }
+
+  void avro_column::clear() {
+    truncate(0);
+  }
+
+  void avro_column::truncate(size_t rows) {
+    _size = rows;
+    if (_nullable)
+      _validity.resize((rows + 7) / 8);
+    if (is_variable_width()) {
+      _offsets.resize(rows + 1);
+      _bytes.resize(_offsets[rows]);
+    } else {
+      _values.resize(rows * value_size());
+    }
+  }
+
+  void avro_column::set_valid(bool valid) {
+    if ((_size & 7) == 0)
+      _validity.push_back(0);
+    if (valid)
+      _validity[_size >> 3] |= (1 << (_size & 7));
+    else
+      _validity[_size >> 3] &= ~(1 << (_size & 7));
+  }
+
+  void avro_column::append_null() {
+    set_valid(false);
+    if (is_variable_width())
+      _offsets.push_back(_offsets.back());
+    else
+      _values.resize(_values.size() + value_size(), 0);
+    ++_size;
+  }
+
+  void avro_column::append_value(avro_fast::reader &r) {
+    if (_nullable)
+      set_valid(true);
+    switch (_type) {
+      case avro::AVRO_STRING:
+      case avro::AVRO_BYTES: {
+        size_t sz = r.read_size();
+        const char *p = (const char *) r.position();
+        r.skip(sz);
+        _bytes.insert(_bytes.end(), p, p + sz);
+        _offsets.push_back((uint32_t) _bytes.size());
+      }
+        break;
+      case avro::AVRO_INT: {
+        int32_t v = r.read_int();
+        _values.insert(_values.end(), (const uint8_t *) &v, (const uint8_t *) &v + sizeof(v));
+      }
+        break;
+      case avro::AVRO_LONG: {
+        int64_t v = r.read_long();
+        _values.insert(_values.end(), (const uint8_t *) &v, (const uint8_t *) &v + sizeof(v));
+      }
+        break;
+      case avro::AVRO_FLOAT:
+      case avro::AVRO_DOUBLE: {
+        // same little endian layout as on the wire
+        const uint8_t *p = r.position();
+        r.skip(value_size());
+        _values.insert(_values.end(), p, p + value_size());
+      }
+        break;
+      case avro::AVRO_BOOL:
+        _values.push_back(r.read_bool() ? 1 : 0);
+        break;
+      default:
+        break;
+    }
+    ++_size;
+  }
+
+  const avro_column *avro_column_batch::column(const std::string &name) const {
+    for (const auto &c : _columns)
+      if (c.name() == name)
+        return &c;
+    return nullptr;
+  }
+
+  void avro_column_batch::reserve(size_t rows) {
+    for (auto &c : _columns)
+      c.reserve(rows);
+  }
+
+  void avro_column_batch::clear() {
+    truncate(0);
+  }
+
+  void avro_column_batch::truncate(size_t rows) {
+    _rows = rows;
+    for (auto &c : _columns)
+      if (c.size() > rows)
+        c.truncate(rows);
+  }
+
+  avro_column_decoder::avro_column_decoder(std::shared_ptr<const avro::ValidSchema> writer_schema, int32_t schema_id)
+      : _writer_schema(writer_schema)
+      , _schema_id(schema_id) {
+    avro::NodePtr root = avro_projection::resolve(writer_schema->root());
+    if (root->type() != avro::AVRO_RECORD)
+      throw std::invalid_argument("avro_column_decoder: writer schema is not a record");
+
+    for (size_t i = 0; i != root->leaves(); ++i) {
+      step s;
+      s.node = avro_projection::resolve(root->leafAt(i));
+      s.column = -1;
+      s.null_branch = 0;
+      avro::Type type = s.node->type();
+      if (avro_projection::is_primitive(type)) {
+        s.column = (int) _prototype.size();
+        _prototype.emplace_back(root->nameAt(i), type, false);
+      } else if (avro_projection::is_nullable_primitive(s.node, s.null_branch)) {
+        s.column = (int) _prototype.size();
+        _prototype.emplace_back(root->nameAt(i), s.node->leafAt(1 - s.null_branch)->type(), true);
+      }
+      _steps.push_back(s);
+    }
+  }
+
+  std::shared_ptr<avro_column_batch> avro_column_decoder::make_batch() const {
+    auto batch = std::make_shared<avro_column_batch>();
+    batch->_schema_id = _schema_id;
+    batch->_columns = _prototype;
+    return batch;
+  }
+
+  bool avro_column_decoder::append(const char *payload, size_t size, avro_column_batch &batch) const {
+    if (size < 5 || payload[0])
+      return false;
+
+    /* read framing */
+    int32_t encoded_schema_id = -1;
+    memcpy(&encoded_schema_id, &payload[1], 4);
+    int32_t schema_id = ntohl(encoded_schema_id);
+    if (schema_id != _schema_id || batch._schema_id != _schema_id) {
+      LOG(ERROR) << "avro_column_decoder: expected schema id: " << _schema_id << ", got: " << schema_id;
+      return false;
+    }
+
+    const size_t rows = batch._rows;
+    try {
+      avro_fast::reader r((const uint8_t *) payload + 5, size - 5);
+      for (const auto &s : _steps) {
+        if (s.column < 0) {
+          avro_projection::skip(r, s.node);
+          continue;
+        }
+        avro_column &c = batch._columns[s.column];
+        if (c.nullable()) {
+          int64_t branch = r.read_long();
+          if (branch < 0 || branch > 1)
+            throw avro::Exception("avro_column_decoder: union index out of range");
+          if ((size_t) branch == s.null_branch) {
+            c.append_null();
+            continue;
+          }
+        }
+        c.append_value(r);
+      }
+    }
+    catch (const avro::Exception &e) {
+      LOG(ERROR) << "avro_column_decoder: deserialization failed: " << e.what();
+      batch.truncate(rows);
+      return false;
+    }
+    batch._rows = rows + 1;
+    return true;
+  }
+}
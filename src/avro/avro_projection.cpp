@@ -0,0 +1,221 @@
+#include <kspp/avro/avro_projection.h>
+#include <sstream>
+#include <stdexcept>
+#include <avro/Compiler.hh>
+#include <avro/Decoder.hh>
+#include <kspp/avro/avro_input_stream.h>
+
+namespace kspp {
+  avro_projection::avro_projection(std::shared_ptr<const avro::ValidSchema> writer_schema, const std::vector<std::string> &fields)
+      : _writer_schema(writer_schema) {
+    avro::NodePtr root = resolve(writer_schema->root());
+    if (root->type() != avro::AVRO_RECORD)
+      throw std::invalid_argument("avro_projection: writer schema is not a record");
+
+    // reader schema - the projected field definitions copied from the writer schema
+    std::vector<int> reader_index(root->leaves(), -1);
+    std::stringstream ss;
+    ss << "{\"type\":\"record\",\"name\":\"" << root->name().fullname() << "\",\"fields\":[";
+    for (size_t i = 0; i != fields.size(); ++i) {
+      size_t index = 0;
+      if (!root->nameIndex(fields[i], index))
+        throw std::invalid_argument("avro_projection: no such member: " + fields[i]);
+      if (reader_index[index] >= 0)
+        throw std::invalid_argument("avro_projection: duplicate member: " + fields[i]);
+      reader_index[index] = (int) i;
+      if (i)
+        ss << ",";
+      ss << "{\"name\":\"" << fields[i] << "\",\"type\":";
+      root->leafAt(index)->printJson(ss, 0);
+      ss << "}";
+    }
+    ss << "]}";
+
+    try {
+      _reader_schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString(ss.str()));
+    } catch (const avro::Exception &e) {
+      // ie a projected field uses a named type that is defined in a skipped field
+      throw std::invalid_argument(std::string("avro_projection: cannot create reader schema: ") + e.what());
+    }
+
+    avro::NodePtr reader_root = _reader_schema->root();
+    for (size_t i = 0; i != root->leaves(); ++i) {
+      step s;
+      s.node = resolve(root->leafAt(i));
+      s.kind = SKIP;
+      s.reader_index = 0;
+      s.type = s.node->type();
+      s.null_branch = 0;
+      if (reader_index[i] >= 0) {
+        s.reader_index = (size_t) reader_index[i];
+        if (is_primitive(s.type) || s.type == avro::AVRO_NULL) {
+          s.kind = DIRECT;
+        } else if (is_nullable_primitive(s.node, s.null_branch)) {
+          s.kind = NULLABLE;
+          s.type = s.node->leafAt(1 - s.null_branch)->type();
+        } else {
+          s.kind = GENERIC;
+          s.schema = std::make_shared<const avro::ValidSchema>(reader_root->leafAt(s.reader_index));
+        }
+      }
+      _steps.push_back(s);
+    }
+  }
+
+  avro::NodePtr avro_projection::resolve(const avro::NodePtr &node) {
+    return (node->type() == avro::AVRO_SYMBOLIC) ? avro::resolveSymbol(node) : node;
+  }
+
+  bool avro_projection::is_primitive(avro::Type type) {
+    switch (type) {
+      case avro::AVRO_STRING:
+      case avro::AVRO_BYTES:
+      case avro::AVRO_INT:
+      case avro::AVRO_LONG:
+      case avro::AVRO_FLOAT:
+      case avro::AVRO_DOUBLE:
+      case avro::AVRO_BOOL:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  bool avro_projection::is_nullable_primitive(const avro::NodePtr &node, size_t &null_branch) {
+    if (node->type() != avro::AVRO_UNION || node->leaves() != 2)
+      return false;
+    avro::Type t0 = node->leafAt(0)->type();
+    avro::Type t1 = node->leafAt(1)->type();
+    if ((t0 == avro::AVRO_NULL && is_primitive(t1)) || (t1 == avro::AVRO_NULL && is_primitive(t0))) {
+      null_branch = (t0 == avro::AVRO_NULL) ? 0 : 1;
+      return true;
+    }
+    return false;
+  }
+
+  void avro_projection::skip(avro_fast::reader &r, const avro::NodePtr &node) {
+    switch (node->type()) {
+      case avro::AVRO_NULL:
+        break;
+      case avro::AVRO_BOOL:
+        r.skip(1);
+        break;
+      case avro::AVRO_INT:
+      case avro::AVRO_LONG:
+      case avro::AVRO_ENUM:
+        r.read_long();
+        break;
+      case avro::AVRO_FLOAT:
+        r.skip(4);
+        break;
+      case avro::AVRO_DOUBLE:
+        r.skip(8);
+        break;
+      case avro::AVRO_STRING:
+      case avro::AVRO_BYTES:
+        r.skip(r.read_size());
+        break;
+      case avro::AVRO_FIXED:
+        r.skip(node->fixedSize());
+        break;
+      case avro::AVRO_RECORD:
+        for (size_t i = 0; i != node->leaves(); ++i)
+          skip(r, resolve(node->leafAt(i)));
+        break;
+      case avro::AVRO_UNION: {
+        int64_t branch = r.read_long();
+        if (branch < 0 || (size_t) branch >= node->leaves())
+          throw avro::Exception("avro_projection: union index out of range");
+        skip(r, resolve(node->leafAt((size_t) branch)));
+      }
+        break;
+      case avro::AVRO_ARRAY:
+      case avro::AVRO_MAP: {
+        avro::NodePtr item = resolve(node->leafAt(node->type() == avro::AVRO_ARRAY ? 0 : 1));
+        for (int64_t n = r.read_long(); n != 0; n = r.read_long()) {
+          if (n < 0) {
+            // block with byte size - skipped without looking at the items
+            r.skip(r.read_size());
+            continue;
+          }
+          for (int64_t i = 0; i != n; ++i) {
+            if (node->type() == avro::AVRO_MAP)
+              r.skip(r.read_size());
+            skip(r, item);
+          }
+        }
+      }
+        break;
+      case avro::AVRO_SYMBOLIC:
+        skip(r, resolve(node));
+        break;
+      default:
+        throw avro::Exception("avro_projection: unsupported type");
+    }
+  }
+
+  void avro_projection::decode_primitive(avro_fast::reader &r, avro::Type type, avro::GenericDatum &dst) {
+    switch (type) {
+      case avro::AVRO_STRING:
+        r.read_string(dst.value<std::string>());
+        break;
+      case avro::AVRO_BYTES:
+        r.read_bytes(dst.value<std::vector<uint8_t>>());
+        break;
+      case avro::AVRO_INT:
+        dst.value<int32_t>() = r.read_int();
+        break;
+      case avro::AVRO_LONG:
+        dst.value<int64_t>() = r.read_long();
+        break;
+      case avro::AVRO_FLOAT:
+        dst.value<float>() = r.read_float();
+        break;
+      case avro::AVRO_DOUBLE:
+        dst.value<double>() = r.read_double();
+        break;
+      case avro::AVRO_BOOL:
+        dst.value<bool>() = r.read_bool();
+        break;
+      default:
+        break;
+    }
+  }
+
+  size_t avro_projection::decode(const uint8_t *data, size_t size, avro::GenericDatum &dst) const {
+    avro_fast::reader r(data, size);
+    avro::GenericRecord &record = dst.value<avro::GenericRecord>();
+    for (const auto &s : _steps) {
+      switch (s.kind) {
+        case SKIP:
+          skip(r, s.node);
+          break;
+        case DIRECT:
+          decode_primitive(r, s.type, record.fieldAt(s.reader_index));
+          break;
+        case NULLABLE: {
+          avro::GenericDatum &field = record.fieldAt(s.reader_index);
+          int64_t branch = r.read_long();
+          if (branch < 0 || branch > 1)
+            throw avro::Exception("avro_projection: union index out of range");
+          field.selectBranch((size_t) branch);
+          if ((size_t) branch != s.null_branch)
+            decode_primitive(r, s.type, field);
+        }
+          break;
+        case GENERIC: {
+          // find the end of the field and let the generic reader decode exactly that slice
+          const uint8_t *begin = r.position();
+          skip(r, s.node);
+          static thread_local avro::DecoderPtr bin_decoder = avro::binaryDecoder();
+          static thread_local avro_input_stream bin_is;
+          bin_is.reset(begin, r.position() - begin);
+          bin_decoder->init(bin_is);
+          avro::GenericReader::read(*bin_decoder, record.fieldAt(s.reader_index), *s.schema);
+        }
+          break;
+      }
+    }
+    return r.consumed();
+  }
+}
@@ -43,20 +43,29 @@ namespace kspp {
       return -1;
     }
     LOG(INFO) << "avro_schema_registry put \"" << name << "\" -> " << rpc_result.schema_id;
+    // the registry returns the id of the identical schema so we can decode our own data without a lookup
+    _cache.insert(rpc_result.schema_id, schema);
     return rpc_result.schema_id;
   }
 
-  std::shared_ptr<const avro::ValidSchema> avro_schema_registry::get_schema(int32_t schema_id) {
-    {
-      kspp::spinlock::scoped_lock xxx(_spinlock);
-      {
-        std::map<int32_t, std::shared_ptr<const avro::ValidSchema>>::iterator item = _cache.find(schema_id);
-        if (item != _cache.end()) {
-          //DLOG_EVERY_N(INFO, 1000) << "avro_schema_registry, cache lookup on " << schema_id;
-          return item->second;
-        }
+  void avro_schema_registry::put_schema(std::string name, std::shared_ptr<const avro::ValidSchema> schema, std::function<void(int32_t)> cb) {
+    _proxy->put_schema(name, schema, [this, name, schema, cb](auto rpc_result) {
+      if (rpc_result.ec) {
+        LOG_IF(FATAL, _fail_fast) << "avro_schema_registry put failed: ec" << rpc_result.ec;
+        LOG(ERROR) << "avro_schema_registry put failed: ec" << rpc_result.ec;
+        cb(-1);
+        return;
       }
-    }
+      LOG(INFO) << "avro_schema_registry put \"" << name << "\" -> " << rpc_result.schema_id;
+      _cache.insert(rpc_result.schema_id, schema);
+      cb(rpc_result.schema_id);
+    });
+  }
+
+  std::shared_ptr<const avro::ValidSchema> avro_schema_registry::get_schema(int32_t schema_id) {
+    auto cached = _cache.find(schema_id);
+    if (cached)
+      return *cached;
 
     auto future = _proxy->get_schema(schema_id);
     future.wait();
@@ -84,10 +93,6 @@ namespace kspp {
     d.Accept(writer);
     LOG(INFO) << "avro_schema_registry get " << schema_id << "-> " << buffer.GetString();
 
-    kspp::spinlock::scoped_lock xxx(_spinlock);
-    {
-      _cache[schema_id] = rpc_result.schema;
-    }
-    return rpc_result.schema;
+    return *_cache.insert(schema_id, rpc_result.schema);
   }
 }
@@ -0,0 +1,275 @@
+#include <kspp/avro/compact_avro.h>
+#include <stdexcept>
+#include <avro/Decoder.hh>
+#include <avro/Encoder.hh>
+#include <kspp/avro/avro_input_stream.h>
+#include <kspp/avro/avro_output_stream.h>
+#include <kspp/avro/avro_projection.h>
+
+namespace kspp {
+  static bool is_variable_width(avro::Type type) {
+    return type == avro::AVRO_STRING || type == avro::AVRO_BYTES;
+  }
+
+  compact_avro_layout::compact_avro_layout(std::shared_ptr<const avro::ValidSchema> schema)
+      : _schema(schema) {
+    avro::NodePtr root = avro_projection::resolve(schema->root());
+    if (root->type() != avro::AVRO_RECORD)
+      throw std::invalid_argument("compact_avro: schema is not a record");
+    _name = root->name().fullname();
+
+    for (size_t i = 0; i != root->leaves(); ++i) {
+      field f;
+      f.name = root->nameAt(i);
+      f.node = avro_projection::resolve(root->leafAt(i));
+      f.type = f.node->type();
+      f.kind = RAW;
+      f.null_branch = 0;
+      if (avro_projection::is_primitive(f.type)) {
+        f.kind = SCALAR;
+      } else if (avro_projection::is_nullable_primitive(f.node, f.null_branch)) {
+        f.kind = NULLABLE;
+        f.type = f.node->leafAt(1 - f.null_branch)->type();
+      }
+      _fields.push_back(f);
+    }
+  }
+
+  bool compact_avro_layout::field_index(const std::string &member, size_t &index) const {
+    for (size_t i = 0; i != _fields.size(); ++i) {
+      if (_fields[i].name == member) {
+        index = i;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void compact_avro::create(std::shared_ptr<const avro::ValidSchema> s, int32_t schema_id) {
+    if (_layout && _layout->valid_schema() == s)
+      create(_layout, schema_id);
+    else
+      create(std::make_shared<const compact_avro_layout>(s), schema_id);
+  }
+
+  void compact_avro::create(std::shared_ptr<const compact_avro_layout> layout, int32_t schema_id) {
+    _layout = layout;
+    _schema_id = schema_id;
+    _arena.assign(_layout->fields().size() * sizeof(slot), 0);
+    slot *slots = reinterpret_cast<slot *>(_arena.data());
+    for (size_t i = 0; i != _layout->fields().size(); ++i) {
+      const auto &f = _layout->fields()[i];
+      slots[i].type = (f.kind == compact_avro_layout::NULLABLE) ? avro::AVRO_NULL : f.type;
+    }
+  }
+
+  void compact_avro::append(slot &s, const uint8_t *data, size_t size) {
+    s.v.ref.offset = (uint32_t) _arena.size();
+    s.v.ref.size = (uint32_t) size;
+    _arena.insert(_arena.end(), data, data + size);
+  }
+
+  size_t compact_avro::decode(const uint8_t *data, size_t size) {
+    const auto &fields = _layout->fields();
+    const size_t slots_size = fields.size() * sizeof(slot);
+    // nothing inlined is larger than the avro encoding - this is the only allocation
+    _arena.reserve(slots_size + size);
+    _arena.resize(slots_size);
+
+    avro_fast::reader r(data, size);
+    for (size_t i = 0; i != fields.size(); ++i) {
+      const auto &f = fields[i];
+      slot s;
+      memset(&s, 0, sizeof(s));
+      s.type = f.type;
+      if (f.kind == compact_avro_layout::NULLABLE) {
+        int64_t branch = r.read_long();
+        if (branch < 0 || branch > 1)
+          throw avro::Exception("compact_avro: union index out of range");
+        if ((size_t) branch == f.null_branch)
+          s.type = avro::AVRO_NULL;
+      }
+
+      if (s.type == avro::AVRO_NULL) {
+        // nothing more to read
+      } else if (f.kind == compact_avro_layout::RAW) {
+        const uint8_t *begin = r.position();
+        avro_projection::skip(r, f.node);
+        append(s, begin, r.position() - begin);
+      } else {
+        switch (f.type) {
+          case avro::AVRO_STRING:
+          case avro::AVRO_BYTES: {
+            size_t sz = r.read_size();
+            const uint8_t *p = r.position();
+            r.skip(sz);
+            append(s, p, sz);
+          }
+            break;
+          case avro::AVRO_INT:
+            s.v.i = r.read_int();
+            break;
+          case avro::AVRO_LONG:
+            s.v.l = r.read_long();
+            break;
+          case avro::AVRO_FLOAT:
+            s.v.f = r.read_float();
+            break;
+          case avro::AVRO_DOUBLE:
+            s.v.d = r.read_double();
+            break;
+          case avro::AVRO_BOOL:
+            s.v.b = r.read_bool();
+            break;
+          default:
+            break;
+        }
+      }
+      memcpy(_arena.data() + i * sizeof(slot), &s, sizeof(s));
+    }
+    return r.consumed();
+  }
+
+  void compact_avro::encode(avro_fast::writer &w) const {
+    const auto &fields = _layout->fields();
+    for (size_t i = 0; i != fields.size(); ++i) {
+      const auto &f = fields[i];
+      const slot &s = slot_at(i);
+      if (f.kind == compact_avro_layout::NULLABLE) {
+        if (s.type == avro::AVRO_NULL) {
+          w.write_long((int64_t) f.null_branch);
+          continue;
+        }
+        w.write_long((int64_t) (1 - f.null_branch));
+      }
+
+      if (f.kind == compact_avro_layout::RAW) {
+        w.write_raw(bytes(s), s.v.ref.size);
+        continue;
+      }
+
+      switch (f.type) {
+        case avro::AVRO_STRING:
+        case avro::AVRO_BYTES:
+          w.write_long(s.v.ref.size);
+          w.write_raw(bytes(s), s.v.ref.size);
+          break;
+        case avro::AVRO_INT:
+          w.write_int(s.v.i);
+          break;
+        case avro::AVRO_LONG:
+          w.write_long(s.v.l);
+          break;
+        case avro::AVRO_FLOAT:
+          w.write_float(s.v.f);
+          break;
+        case avro::AVRO_DOUBLE:
+          w.write_double(s.v.d);
+          break;
+        case avro::AVRO_BOOL:
+          w.write_bool(s.v.b);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  // only valid for binary encoders since raw fields are copied as is
+  void compact_avro::encode(avro::Encoder &e) const {
+    static thread_local output_buffer tmp;
+    tmp.clear();
+    avro_fast::writer w(tmp);
+    encode(w);
+    e.encodeFixed((const uint8_t *) tmp.data(), tmp.size());
+  }
+
+  compact_avro compact_avro::from_generic(const generic_avro &src) {
+    static thread_local output_buffer tmp;
+    static thread_local avro::EncoderPtr bin_encoder = avro::binaryEncoder();
+    static thread_local avro_output_stream bin_os;
+    tmp.clear();
+    bin_os.reset(&tmp);
+    bin_encoder->init(bin_os);
+    avro::encode(*bin_encoder, *src.generic_datum());
+    bin_encoder->flush();
+
+    compact_avro dst(src.valid_schema(), src.schema_id());
+    dst.decode((const uint8_t *) tmp.data(), tmp.size());
+    return dst;
+  }
+
+  generic_avro compact_avro::to_generic() const {
+    static thread_local output_buffer tmp;
+    static thread_local avro::DecoderPtr bin_decoder = avro::binaryDecoder();
+    static thread_local avro_input_stream bin_is;
+    tmp.clear();
+    avro_fast::writer w(tmp);
+    encode(w);
+
+    generic_avro dst(valid_schema(), _schema_id);
+    bin_is.reset((const uint8_t *) tmp.data(), tmp.size());
+    bin_decoder->init(bin_is);
+    avro::decode(*bin_decoder, *dst.generic_datum());
+    return dst;
+  }
+
+  avro::GenericDatum compact_avro::compact_record::get_generic_datum(size_t index) const {
+    const auto &f = record_._layout->fields()[index];
+    const slot &s = record_.slot_at(index);
+    if (f.kind != compact_avro_layout::RAW) {
+      if (s.type == avro::AVRO_NULL)
+        return avro::GenericDatum();
+      switch (s.type) {
+        case avro::AVRO_STRING:
+          return avro::GenericDatum(std::string((const char *) record_.bytes(s), s.v.ref.size));
+        case avro::AVRO_BYTES:
+          return avro::GenericDatum(std::vector<uint8_t>(record_.bytes(s), record_.bytes(s) + s.v.ref.size));
+        case avro::AVRO_INT:
+          return avro::GenericDatum(s.v.i);
+        case avro::AVRO_LONG:
+          return avro::GenericDatum(s.v.l);
+        case avro::AVRO_FLOAT:
+          return avro::GenericDatum(s.v.f);
+        case avro::AVRO_DOUBLE:
+          return avro::GenericDatum(s.v.d);
+        case avro::AVRO_BOOL:
+          return avro::GenericDatum(s.v.b);
+        default:
+          return avro::GenericDatum();
+      }
+    }
+
+    static thread_local avro::DecoderPtr bin_decoder = avro::binaryDecoder();
+    static thread_local avro_input_stream bin_is;
+    avro::GenericDatum datum(f.node);
+    bin_is.reset(record_.bytes(s), s.v.ref.size);
+    bin_decoder->init(bin_is);
+    avro::decode(*bin_decoder, datum);
+    return datum;
+  }
+
+  std::optional<std::string> compact_avro::compact_record::get_optional_as_string(const std::string &member) const {
+    size_t index = field_index(member);
+    const slot &s = record_.slot_at(index);
+    switch (s.type) {
+      case avro::AVRO_NULL:
+        return std::nullopt;
+      case avro::AVRO_STRING :
+        return std::string((const char *) record_.bytes(s), s.v.ref.size);
+      case avro::AVRO_INT:
+        return std::to_string(s.v.i);
+      case avro::AVRO_LONG:
+        return std::to_string(s.v.l);
+      case avro::AVRO_FLOAT:
+        return std::to_string(s.v.f);
+      case avro::AVRO_DOUBLE:
+        return std::to_string(s.v.d);
+      case avro::AVRO_BOOL:
+        return std::to_string(s.v.b);
+      default:
+        break;
+    }
+    throw std::invalid_argument(name() + "." + member + ": , cannot convert to string, actual type: " + avro_utils::to_string(s.type));
+  }
+}
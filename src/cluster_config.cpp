@@ -8,6 +8,10 @@
 #include <kspp/utils/url_parser.h>
 #include <kspp/utils/env.h>
 #include <kspp/cluster_metadata.h>
+#include <kspp/internal/sources/kafka_shared_consumer.h>
+#include <kspp/utils/memory_budget.h>
+#include <kspp/utils/kafka_mock_cluster.h>
+#include <kspp/utils/worker_pool.h>
 
 using namespace std::chrono_literals;
 
@@ -28,15 +32,24 @@ namespace kspp {
         , producer_message_timeout_(std::chrono::milliseconds(0))
         , consumer_buffering_(std::chrono::milliseconds(1000))
         , schema_registry_timeout_(std::chrono::milliseconds(10000))
+        , read_ahead_time_(std::chrono::milliseconds(1000))
         , cluster_state_timeout_(std::chrono::seconds(60))
         , max_pending_sink_messages_(50000)
+        , decode_threads_(0)
+        , max_buffered_bytes_(512 * 1024 * 1024)
         , fail_fast_(true)
+        , shared_consumer_(false)
         , flags_(flags){
   }
 
   void cluster_config::load_config_from_env() {
-    if (has_feature(cluster_config::KAFKA))
-      set_brokers(default_kafka_broker_uri());
+    if (has_feature(cluster_config::KAFKA)) {
+      auto mock_brokers = default_kafka_mock_brokers();
+      if (mock_brokers.size())
+        set_mock_cluster(std::stoul(mock_brokers));
+      else
+        set_brokers(default_kafka_broker_uri());
+    }
     set_storage_root(default_statestore_root());
     //set_consumer_buffering_time()
     //set_producer_buffering_time
@@ -60,6 +73,17 @@ namespace kspp {
     return brokers_;
   }
 
+  void cluster_config::set_mock_cluster(size_t nr_of_brokers) {
+    LOG_IF(FATAL, !kafka_mock_cluster::available()) << "cluster_config, librdkafka is built without mock cluster support";
+    LOG_IF(FATAL, meta_data_ != nullptr) << "cluster_config, mock cluster must be set before kafka is used";
+    mock_cluster_ = std::make_shared<kafka_mock_cluster>(nr_of_brokers);
+    set_brokers(mock_cluster_->brokers());
+  }
+
+  std::shared_ptr<kafka_mock_cluster> cluster_config::get_mock_cluster() const {
+    return mock_cluster_;
+  }
+
   std::string cluster_config::get_consumer_group() const {
     return consumer_group_;
   }
@@ -205,6 +229,63 @@ namespace kspp {
     return fail_fast_;
   }
 
+  void cluster_config::set_shared_consumer(bool state) {
+    shared_consumer_ = state;
+  }
+
+  bool cluster_config::get_shared_consumer() const {
+    return shared_consumer_;
+  }
+
+  // alive as long as some source uses it
+  std::shared_ptr<kafka_shared_consumer> cluster_config::shared_consumer(std::string consumer_group) const {
+    auto consumer = shared_consumers_[consumer_group].lock();
+    if (!consumer) {
+      consumer = std::make_shared<kafka_shared_consumer>(this, consumer_group);
+      shared_consumers_[consumer_group] = consumer;
+    }
+    return consumer;
+  }
+
+  void cluster_config::set_decode_threads(size_t nr_of_threads) {
+    decode_threads_ = nr_of_threads;
+  }
+
+  size_t cluster_config::get_decode_threads() const {
+    return decode_threads_;
+  }
+
+  std::shared_ptr<worker_pool> cluster_config::get_decode_pool() const {
+    if (decode_threads_ == 0)
+      return nullptr;
+    if (decode_pool_ == nullptr)
+      decode_pool_ = std::make_shared<worker_pool>(decode_threads_);
+    return decode_pool_;
+  }
+
+  void cluster_config::set_max_buffered_bytes(size_t bytes) {
+    LOG_IF(FATAL, memory_budget_ != nullptr) << "cluster_config, max_buffered_bytes must be set before any source is created";
+    max_buffered_bytes_ = bytes;
+  }
+
+  size_t cluster_config::get_max_buffered_bytes() const {
+    return max_buffered_bytes_;
+  }
+
+  void cluster_config::set_read_ahead_time(std::chrono::milliseconds ms) {
+    read_ahead_time_ = ms;
+  }
+
+  std::chrono::milliseconds cluster_config::get_read_ahead_time() const {
+    return read_ahead_time_;
+  }
+
+  std::shared_ptr<memory_budget> cluster_config::get_memory_budget() const {
+    if (memory_budget_ == nullptr)
+      memory_budget_ = std::make_shared<memory_budget>(max_buffered_bytes_);
+    return memory_budget_;
+  }
+
   std::shared_ptr<cluster_metadata> cluster_config::get_cluster_metadata() const {
     if (meta_data_==nullptr)
       meta_data_ = std::make_shared<cluster_metadata>(this);
@@ -268,6 +349,7 @@ namespace kspp {
     if (has_feature(SCHEMA_REGISTRY)) {
       LOG(INFO) << "cluster_config, kafka broker(s): " << get_brokers();
     }
+    LOG_IF(INFO, mock_cluster_ != nullptr) << "cluster_config, kafka mock cluster: " << mock_cluster_->nr_of_brokers() << " brokers";
     LOG(INFO) << "cluster_config, consumer_group: " << get_consumer_group();
     LOG_IF(INFO, get_ca_cert_path().size() > 0) << "cluster_config, ca cert: " << get_ca_cert_path();
     LOG_IF(INFO, get_client_cert_path().size() > 0) << "cluster_config, client cert: " << get_client_cert_path();
@@ -290,6 +372,10 @@ namespace kspp {
       LOG_IF(INFO, get_schema_registry_uri().size() > 0)
       << "cluster_config, schema_registry_timeout: " << get_schema_registry_timeout().count() << " ms";
     }
+    LOG(INFO) << "cluster_config, max_buffered_bytes: " << get_max_buffered_bytes();
+    LOG(INFO) << "cluster_config, read_ahead_time: " << get_read_ahead_time().count() << " ms";
+    LOG_IF(INFO, get_decode_threads() > 0) << "cluster_config, kafka decode_threads: " << get_decode_threads();
+    LOG_IF(INFO, has_feature(KAFKA)) << "cluster_config, kafka shared_consumer: " << (get_shared_consumer() ? "true" : "false");
     LOG(INFO) << "kafka cluster_state_timeout: " << get_cluster_state_timeout().count() << " s";
   }
 }
\ No newline at end of file
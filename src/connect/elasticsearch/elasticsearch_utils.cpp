@@ -180,8 +180,16 @@ namespace kspp {
     assert(datum.type() == avro::AVRO_RECORD);
     const avro::GenericRecord &record(datum.value<avro::GenericRecord>());
     std::string result;
-    auto x = record.field(key);
+    const auto& x = record.field(key);
     result += avro_2_json_simple_column_value(x); // is this really correct??? should it now be raw??
     return result;
   }
+
+  std::string avro2elastic_key_values(const avro_field_path &key, const avro::GenericDatum &datum) {
+    assert(datum.type() == avro::AVRO_RECORD);
+    const avro::GenericDatum* x = key.find(datum);
+    if (x == nullptr)
+      return "NULL"; // same as a null column
+    return avro_2_json_simple_column_value(*x);
+  }
 } // namespace
\ No newline at end of file
@@ -557,7 +557,7 @@ namespace kspp {
       size_t sz = keys.size();
       size_t last =sz-1;
       for (size_t i=0; i!=sz; ++i) {
-        auto x = record.field(keys[i]);
+        const auto& x = record.field(keys[i]);
         result += avro_2_sql_simple_column_value(x);
         if (i!=last)
           result += ", ";
@@ -565,6 +565,22 @@ namespace kspp {
       return result;
     }
 
+    std::string avro2sql_key_values(const std::vector<avro_field_path> &keys, const avro::GenericDatum &datum) {
+      assert(datum.type() == avro::AVRO_RECORD);
+      std::string result;
+      size_t sz = keys.size();
+      size_t last =sz-1;
+      for (size_t i=0; i!=sz; ++i) {
+        const avro::GenericDatum* x = keys[i].find(datum);
+        if (x == nullptr)
+          LOG(FATAL) << "null record in key path: " << keys[i].path();
+        result += avro_2_sql_simple_column_value(*x);
+        if (i!=last)
+          result += ", ";
+      }
+      return result;
+    }
+
     std::string avro2sql_delete_key_values(const avro::ValidSchema &schema, const std::vector<std::string> &keys,
                                            const avro::GenericDatum &datum) {
       if (datum.type() == avro::AVRO_RECORD) {
@@ -595,28 +611,26 @@ namespace kspp {
     }
      */
 
-    void load_avro_by_name(kspp::generic_avro* avro, PGresult* pgres, size_t row)
+    std::vector<int> column_indices(const avro::ValidSchema& schema, const PGresult* pgres)
     {
+      std::vector<int> columns;
+      auto root = schema.root();
       // key tupe is null if there is no key
-      if (avro->type() == avro::AVRO_NULL)
-        return;
+      if (root->type() == avro::AVRO_NULL)
+        return columns;
 
-      assert(avro->type() == avro::AVRO_RECORD);
-      avro::GenericRecord& record(avro->generic_datum()->value<avro::GenericRecord>());
-      size_t nFields = record.fieldCount();
+      assert(root->type() == avro::AVRO_RECORD);
+      size_t nFields = root->leaves();
       for (int j = 0; j < nFields; j++)
       {
-        avro::GenericDatum& col = record.fieldAt(j); // expected union
-        if (!record.fieldAt(j).isUnion()) // this should not hold - but we fail to create correct schemas for not null columns
+        if (root->leafAt(j)->type() != avro::AVRO_UNION) // this should not hold - but we fail to create correct schemas for not null columns
         {
-          LOG(INFO) << avro->valid_schema()->toJson();
-          LOG(FATAL) << "unexpected schema - bailing out, type:" << record.fieldAt(j).type();
+          LOG(INFO) << schema.toJson();
+          LOG(FATAL) << "unexpected schema - bailing out, type:" << root->leafAt(j)->type();
           break;
         }
 
-        //avro::GenericUnion& au(record.fieldAt(j).value<avro::GenericUnion>());
-
-        const std::string& column_name = record.schema()->nameAt(j);
+        const std::string& column_name = root->nameAt(j);
 
         //which pg column has this value?
         int column_index = PQfnumber(pgres, column_name.c_str());
@@ -625,6 +639,30 @@ namespace kspp {
           LOG(FATAL) << "unknown column - bailing out: " << column_name;
           break;
         }
+        columns.push_back(column_index);
+      }
+      return columns;
+    }
+
+    void load_avro_by_name(kspp::generic_avro* avro, PGresult* pgres, size_t row)
+    {
+      load_avro_by_name(avro, pgres, row, column_indices(*avro->valid_schema(), pgres));
+    }
+
+    void load_avro_by_name(kspp::generic_avro* avro, PGresult* pgres, size_t row, const std::vector<int>& columns)
+    {
+      // key tupe is null if there is no key
+      if (avro->type() == avro::AVRO_NULL)
+        return;
+
+      assert(avro->type() == avro::AVRO_RECORD);
+      avro::GenericRecord& record(avro->generic_datum()->value<avro::GenericRecord>());
+      size_t nFields = record.fieldCount();
+      assert(columns.size() == nFields);
+      for (int j = 0; j < nFields; j++)
+      {
+        avro::GenericDatum& col = record.fieldAt(j); // expected union
+        int column_index = columns[j];
 
         if (PQgetisnull(pgres, row, column_index) == 1)
         {
@@ -636,7 +674,7 @@ namespace kspp {
           col.selectBranch(1);
           //au.selectBranch(1);
           //avro::GenericDatum& avro_item(au.datum());
-          const char* val = PQgetvalue(pgres, row, j);
+          const char* val = PQgetvalue(pgres, row, column_index);
 
           switch (col.type()) {
             case avro::AVRO_STRING:
@@ -174,17 +174,25 @@ namespace kspp {
 
     int nRows = PQntuples(result.get());
 
+    // resolve columns by name once per result
+    std::vector<int> key_columns;
+    std::vector<int> val_columns;
+    if (nRows > 0) {
+      key_columns = pq::column_indices(*key_schema_, result.get());
+      val_columns = pq::column_indices(*value_schema_, result.get());
+    }
+
     for (int i = 0; i < nRows; i++) {
       auto key = std::make_shared<kspp::generic_avro>(key_schema_, key_schema_id_);
-      pq::load_avro_by_name(key.get(), result.get(), i);
+      pq::load_avro_by_name(key.get(), result.get(), i, key_columns);
       auto val = std::make_shared<kspp::generic_avro>(value_schema_, value_schema_id_);
-      pq::load_avro_by_name(val.get(), result.get(), i);
+      pq::load_avro_by_name(val.get(), result.get(), i, val_columns);
 
       if (i == (nRows-1)) {
 
         if (!last_key_)
           last_key_ = std::make_unique<kspp::generic_avro>(key_schema_, key_schema_id_);
-        pq::load_avro_by_name(last_key_.get(), result.get(), i);
+        pq::load_avro_by_name(last_key_.get(), result.get(), i, key_columns);
       }
 
       read_cursor_.parse(result);
@@ -25,6 +25,7 @@ namespace kspp {
       , _table(table)
       , cp_(cp)
       , _id_columns(id_columns)
+      , _id_accessor(id_columns)
       , _client_encoding(client_encoding)
       , _max_items_in_insert(max_items_in_insert)
       , _table_checked(false)
@@ -213,7 +214,7 @@ namespace kspp {
 
           // we cannot have the id columns of this update more than once
           // postgres::exec failed ERROR:  ON CONFLICT DO UPDATE command cannot affect row a second time
-          auto key_string = pq::avro2sql_key_values(*msg->record()->value()->valid_schema(), _id_columns,
+          auto key_string = pq::avro2sql_key_values(_id_accessor.compile(msg->record()->value()->valid_schema()),
                                                     *msg->record()->value()->generic_datum());
           //LOG(INFO) << "key string " << key_string;
 
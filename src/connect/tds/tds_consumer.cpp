@@ -10,7 +10,7 @@
 using namespace std::chrono_literals;
 
 namespace kspp {
-  void tds_consumer::load_avro_by_name(kspp::generic_avro* avro, DBPROCESS *stream, COL *columns){
+  void tds_consumer::load_avro_by_name(kspp::generic_avro* avro, DBPROCESS *stream, COL *columns, std::vector<int>& src_columns){
     // key type is null if there is no key
     if (avro->type() == avro::AVRO_NULL)
       return;
@@ -19,20 +19,23 @@ namespace kspp {
     avro::GenericRecord &record(avro->generic_datum()->value<avro::GenericRecord>());
     size_t nFields = record.fieldCount();
 
-    // this checks the requested fields - should only be done once
-    for (int i = 0; i < nFields; i++)
-    {
-      if (!record.fieldAt(i).isUnion()) // TODO this should not hold - but we fail to create correct schemas for not null columns
-      {
-        LOG(FATAL) << "unexpected schema - bailing out, type:" << record.fieldAt(i).type();
-        break;
+    // checks the requested fields and resolves the columns by name once per result set
+    if (src_columns.empty()) {
+      for (int i = 0; i < nFields; i++) {
+        if (!record.fieldAt(i).isUnion()) // TODO this should not hold - but we fail to create correct schemas for not null columns
+        {
+          LOG(FATAL) << "unexpected schema - bailing out, type:" << record.fieldAt(i).type();
+          break;
+        }
+        auto src_column = tds::find_column_by_name(stream, record.schema()->nameAt(i));
+        if (src_column < 0)
+          LOG(FATAL) << "cannot find column, name: " << record.schema()->nameAt(i);
+        src_columns.push_back(src_column);
       }
     }
 
     for (int dst_column = 0; dst_column < nFields; dst_column++) {
-      auto src_column = tds::find_column_by_name(stream, record.schema()->nameAt(dst_column));
-      if (src_column < 0)
-        LOG(FATAL) << "cannot find column, name: " << record.schema()->nameAt(dst_column);
+      auto src_column = src_columns[dst_column];
 
       avro::GenericDatum& col = record.fieldAt(dst_column); // expected union
       //avro::GenericUnion &au(record.fieldAt(dst_column).value<avro::GenericUnion>());
@@ -303,14 +306,14 @@ namespace kspp {
     // for now this should be ok if the schema is not changed between queries...
 
     auto key = std::make_shared<kspp::generic_avro>(_key_schema, _key_schema_id);
-    load_avro_by_name(key.get(), stream, columns);
+    load_avro_by_name(key.get(), stream, columns, _key_columns);
     auto val = std::make_shared<kspp::generic_avro>(_val_schema, _val_schema_id);
-    load_avro_by_name(val.get(), stream, columns);
+    load_avro_by_name(val.get(), stream, columns, _val_columns);
 
     // could be done from the shared_ptr key?
     if (!_last_key)
       _last_key = std::make_unique<kspp::generic_avro>(_key_schema, _key_schema_id);
-    load_avro_by_name(_last_key.get(), stream, columns);
+    load_avro_by_name(_last_key.get(), stream, columns, _key_columns);
 
     _read_cursor.parse(stream);
     int64_t tick_ms = _read_cursor.last_ts_ms();
@@ -351,6 +354,10 @@ namespace kspp {
 
       auto ncols = dbnumcols(stream);
 
+      // the columns might differ between result sets
+      _key_columns.clear();
+      _val_columns.clear();
+
       /*
        * Read metadata and bind.
        * the only reason we do this is to parse SYBMSDATETIME2 (which we should lear how to do)
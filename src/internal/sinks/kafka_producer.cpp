@@ -8,18 +8,24 @@
 using namespace std::chrono_literals;
 
 namespace kspp {
+  // per message state, pooled by the producer
   struct producer_user_data
   {
-    producer_user_data(void* key, size_t keysz, void* val, size_t valsz, uint32_t hash, std::shared_ptr<event_done_marker> marker)
-        : key_ptr(key)
-        , key_sz(keysz)
-        , val_ptr(val)
-        , val_sz(valsz)
-        , partition_hash(hash)
-        , done_marker(marker) {
+    producer_user_data()
+        : key_ptr(nullptr)
+        , key_sz(0)
+        , val_ptr(nullptr)
+        , val_sz(0)
+        , has_key(false)
+        , has_value(false) {
     }
 
     ~producer_user_data() {
+      reset();
+    }
+
+    // frees the malloc'ed key and value and lets go of the marker, the pooled buffers keep their memory
+    void reset() {
       if (key_ptr)
         free(key_ptr);
       if (val_ptr)
@@ -27,23 +33,26 @@ namespace kspp {
 
       key_ptr = nullptr;
       val_ptr = nullptr;
+      key_sz = 0;
+      val_sz = 0;
+      has_key = false;
+      has_value = false;
+      done_marker.reset();
     }
 
-    uint32_t                           partition_hash;
     std::shared_ptr<event_done_marker> done_marker;
-    void*                              key_ptr;
+    void*                              key_ptr;     // FREE and COPY mode
     size_t                             key_sz;
     void*                              val_ptr;
     size_t                             val_sz;
+    output_buffer                      key_buf;     // pooled buffers
+    output_buffer                      val_buf;
+    bool                               has_key;
+    bool                               has_value;
   };
 
-  int32_t kafka_producer::MyHashPartitionerCb::partitioner_cb(const RdKafka::Topic *topic, const std::string *key, int32_t partition_cnt, void *msg_opaque) {
-    producer_user_data*  extra = (producer_user_data*) msg_opaque;
-    int32_t partition = extra->partition_hash % partition_cnt;
-    return partition;
-  }
-
-  kafka_producer::MyDeliveryReportCb::MyDeliveryReportCb() :
+  kafka_producer::MyDeliveryReportCb::MyDeliveryReportCb(kafka_producer* producer) :
+      _producer(producer),
       _status(RdKafka::ErrorCode::ERR_NO_ERROR) {}
 
   void kafka_producer::MyDeliveryReportCb::dr_cb(RdKafka::Message& message) {
@@ -56,7 +65,7 @@ namespace kspp {
         extra->done_marker->fail(message.err());
       _status = message.err();
     }
-    delete extra; // kill the marker here...
+    _producer->release(extra); // kill the marker here...
   }
 
   void kafka_producer::MyEventCb::event_cb (RdKafka::Event &event) {
@@ -87,9 +96,12 @@ namespace kspp {
       , _msg_cnt(0)
       , _msg_bytes(0)
       , _closed(false)
-      , _nr_of_partitions(0) {
+      , _nr_of_partitions(0)
+      , _next(nullptr)
+      , _delivery_report_cb(this) {
     LOG_IF(FATAL, cconfig->get_cluster_metadata()->wait_for_topic_leaders(topic, cconfig->get_cluster_state_timeout())==false)
     <<  "failed to wait for topic leaders, topic:" << topic;
+    _nr_of_partitions = cconfig->get_cluster_metadata()->get_number_partitions(topic);
 
     /*
     * Create configuration objects
@@ -113,7 +125,6 @@ namespace kspp {
       set_config(conf.get(), "message.send.max.retries", "1000000");
       set_config(conf.get(), "log.connection.close", "false");
       set_config(conf.get(), "event_cb", &_event_cb);
-      set_config(tconf.get(), "partitioner_cb", &_default_partitioner);
       set_config(conf.get(), "default_topic_conf", tconf.get());
     }
     catch (std::invalid_argument& e) {
@@ -131,7 +142,7 @@ namespace kspp {
       exit(1);
     }
 
-    // we have to keep this around otherwise the paritioner does not work...
+    // keeps the topic handle alive so produce by name does not have to recreate it
     _rd_topic = std::unique_ptr<RdKafka::Topic>(RdKafka::Topic::create(_producer.get(), _topic, tconf.get(), errstr));
 
     if (!_rd_topic) {
@@ -145,6 +156,9 @@ namespace kspp {
   kafka_producer::~kafka_producer() {
     if (!_closed)
       close();
+    delete _next;
+    for (auto i : _pool)
+      delete i;
   }
 
   void kafka_producer::close() {
@@ -176,8 +190,32 @@ namespace kspp {
   }
 
 
+  producer_user_data* kafka_producer::acquire() {
+    {
+      spinlock::scoped_lock xxx(_pool_lock);
+      if (_pool.size()) {
+        auto p = _pool.back();
+        _pool.pop_back();
+        return p;
+      }
+    }
+    return new producer_user_data();
+  }
+
+  void kafka_producer::release(producer_user_data* user_data) {
+    user_data->reset();
+    // don't hold on to the odd huge message
+    if (user_data->key_buf.capacity() <= MAX_POOLED_BUFFER_SIZE && user_data->val_buf.capacity() <= MAX_POOLED_BUFFER_SIZE) {
+      spinlock::scoped_lock xxx(_pool_lock);
+      if (_pool.size() < MAX_POOLED_USER_DATA) {
+        _pool.push_back(user_data);
+        return;
+      }
+    }
+    delete user_data;
+  }
+
   int kafka_producer::produce(uint32_t partition_hash, memory_management_mode mode, void* key, size_t keysz, void* value, size_t valuesz, int64_t timestamp, std::shared_ptr<event_done_marker> marker) {
-    producer_user_data* user_data = nullptr;
     if (mode == kafka_producer::COPY) {
       void* pkey = malloc(keysz);
       memcpy(pkey, key, keysz);
@@ -187,20 +225,74 @@ namespace kspp {
       memcpy(pval, value, valuesz);
       value = pval;
     }
-    user_data = new producer_user_data(key, keysz, value, valuesz, partition_hash, marker);
-
-    RdKafka::ErrorCode ec = _producer->produce(_topic, -1, 0, value, valuesz, key, keysz, timestamp, user_data); // note not using _rd_topic anymore...?
+    producer_user_data* user_data = acquire();
+    user_data->key_ptr = key;
+    user_data->key_sz = keysz;
+    user_data->val_ptr = value;
+    user_data->val_sz = valuesz;
+    user_data->done_marker = marker;
+
+    RdKafka::ErrorCode ec = _producer->produce(_topic, (int32_t) (partition_hash % _nr_of_partitions), 0, value, valuesz, key, keysz, timestamp, user_data); // topic by name since that is the only call taking a timestamp
     if (ec == RdKafka::ERR__QUEUE_FULL) {
       DLOG(INFO) << "kafka_producer, topic:" << _topic << ", queue full - retrying, msg_count (" << _msg_cnt << ")";
-      delete user_data;
+      release(user_data);
       return ec;
     }  else if (ec != RdKafka::ERR_NO_ERROR) {
       LOG(ERROR) << "kafka_producer, topic:" << _topic << ", produce failed: " << RdKafka::err2str(ec);
       // should this be a fatal?
-      delete user_data; // how do we signal failure to send data... the consumer should probably not continue...
+      release(user_data); // how do we signal failure to send data... the consumer should probably not continue...
+      return ec;
+    }
+
+    _msg_cnt++;
+    _msg_bytes += (valuesz + keysz);
+    return 0;
+  }
+
+  output_buffer& kafka_producer::key_buffer() {
+    if (!_next)
+      _next = acquire();
+    if (!_next->has_key) {
+      _next->key_buf.clear();
+      _next->has_key = true;
+    }
+    return _next->key_buf;
+  }
+
+  output_buffer& kafka_producer::value_buffer() {
+    if (!_next)
+      _next = acquire();
+    if (!_next->has_value) {
+      _next->val_buf.clear();
+      _next->has_value = true;
+    }
+    return _next->val_buf;
+  }
+
+  int kafka_producer::produce(uint32_t partition_hash, int64_t timestamp, std::shared_ptr<event_done_marker> marker) {
+    if (!_next)
+      _next = acquire();
+    producer_user_data* user_data = _next;
+    user_data->done_marker = marker;
+    void* key = user_data->has_key ? (void*) user_data->key_buf.data() : nullptr;
+    size_t keysz = user_data->has_key ? user_data->key_buf.size() : 0;
+    void* value = user_data->has_value ? (void*) user_data->val_buf.data() : nullptr;
+    size_t valuesz = user_data->has_value ? user_data->val_buf.size() : 0;
+
+    // librdkafka references the buffers until the delivery report
+    RdKafka::ErrorCode ec = _producer->produce(_topic, (int32_t) (partition_hash % _nr_of_partitions), 0, value, valuesz, key, keysz, timestamp, user_data);
+    if (ec) {
+      if (ec == RdKafka::ERR__QUEUE_FULL) {
+        DLOG(INFO) << "kafka_producer, topic:" << _topic << ", queue full - retrying, msg_count (" << _msg_cnt << ")";
+      } else {
+        LOG(ERROR) << "kafka_producer, topic:" << _topic << ", produce failed: " << RdKafka::err2str(ec);
+      }
+      // keep the message state for the next attempt, the caller encodes again
+      user_data->reset();
       return ec;
     }
 
+    _next = nullptr;
     _msg_cnt++;
     _msg_bytes += (valuesz + keysz);
     return 0;
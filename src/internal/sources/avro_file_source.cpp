@@ -1,5 +1,6 @@
 #include <kspp/sources/avro_file_source.h>
 #include <memory>
+#include <sstream>
 #include <avro/Generic.hh>
 #include <avro/DataFile.hh>
 #include <kspp/avro/avro_utils.h>
@@ -10,7 +11,15 @@ namespace kspp {
   generic_avro_file_source::generic_avro_file_source(std::shared_ptr<cluster_config> config, int32_t partition, std::string filename)
     : partition_source<void, kspp::generic_avro>(nullptr, partition)
       ,thread_(&generic_avro_file_source::thread_f, this)
-      , filename_(filename) {
+      , filename_(filename)
+      , memory_budget_(config->get_memory_budget())
+      , read_ahead_(memory_budget_, config->get_read_ahead_time())
+      , buffered_bytes_("buffered_bytes", "bytes")
+      , read_ahead_limit_("read_ahead_limit", "bytes")
+      , memory_budget_used_("memory_budget_used", "bytes") {
+    this->add_metric(&buffered_bytes_);
+    this->add_metric(&read_ahead_limit_);
+    this->add_metric(&memory_budget_used_);
     this->add_metrics_label(KSPP_PROCESSOR_TYPE_TAG, PROCESSOR_NAME);
     // if a given  a directory scan directory and add all avro files??
   }
@@ -48,19 +57,21 @@ namespace kspp {
   }
 
   size_t generic_avro_file_source::process(int64_t tick) {
-    if (incomming_msg_.size() == 0)
-      return 0;
     size_t processed = 0;
     while (!incomming_msg_.empty()) {
       auto p = incomming_msg_.front();
       if (p == nullptr || p->event_time() > tick)
-        return processed;
+        break;
       incomming_msg_.pop_front();
       this->send_to_sinks(p);
       ++(this->_processed_count);
       ++processed;
       this->_lag.add_event_time(tick, p->event_time());
     }
+    read_ahead_.remove(processed);
+    buffered_bytes_.set(read_ahead_.bytes());
+    read_ahead_limit_.set(read_ahead_.limit());
+    memory_budget_used_.set(memory_budget_->used());
     return processed;
   }
 
@@ -77,21 +88,27 @@ namespace kspp {
     auto dataSchema = reader.dataSchema();
     auto valid_schema = std::make_shared<const avro::ValidSchema>(dataSchema);
 
-    std::strstream output;
+    std::stringstream output;
     dataSchema.toJson(output);
     LOG(INFO) << output.str();
     //avro::GenericDatum datum(dataSchema);
 
     auto datum = std::make_shared<generic_avro>(valid_schema, -1);
-    // Write out data schema in JSON for grins
+    // records carry no size of their own - account the file in blocks, a block is released with its last record
+    int64_t block_start = reader.previousSync();
     while (!exit_ && reader.read(*datum)) {
+      int64_t sync = reader.previousSync();
+      if (sync != block_start) {
+        read_ahead_.add(0, sync - block_start);
+        block_start = sync;
+      }
       auto record = std::make_shared<krecord<void, generic_avro>>(datum, kspp::milliseconds_since_epoch());
       auto ev = std::make_shared<kevent<void, generic_avro>>(record);
+      read_ahead_.add(1, 0);
       incomming_msg_.push_back(ev);
       datum = std::make_shared<generic_avro>(valid_schema, -1); // create a new item to send
-      // to much work in queue - back off and let the consumers work
-      size_t sz = incomming_msg_.size();
-      while (incomming_msg_.size() > max_incomming_queue_size_ && !exit_) {
+      // read ahead limit or memory budget reached - back off and let the consumers work
+      while (read_ahead_.full() && !exit_) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
       }
     }
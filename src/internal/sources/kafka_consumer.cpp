@@ -45,7 +45,8 @@ namespace kspp {
       , _eof(false)
       , _msg_cnt(0)
       , _msg_bytes(0)
-      , _closed(false) {
+      , _closed(false)
+      , _paused(false) {
     // really try to make sure the partition & group exist before we continue
 
     if (check_cluster) {
@@ -57,6 +58,12 @@ namespace kspp {
 
     _topic_partition.push_back(RdKafka::TopicPartition::create(_topic, _partition));
 
+    if (_config->get_shared_consumer()) {
+      _shared = _config->shared_consumer(_consumer_group);
+      LOG(INFO) << "kafka_consumer topic:" << _topic << ":" << _partition << ", created (shared consumer)";
+      return;
+    }
+
     /*
      * Create configuration objects
     */
@@ -117,6 +124,13 @@ namespace kspp {
     if (_closed)
       return;
     _closed = true;
+    if (_shared) {
+      if (_shared_partition)
+        _shared->remove(_shared_partition);
+      _shared_partition.reset();
+      _shared.reset();
+      LOG(INFO) << "kafka_consumer topic:" << _topic << ":" << _partition << ", closed - consumed " << _msg_cnt << " messages (" << _msg_bytes << " bytes)";
+    }
     if (_consumer) {
       _consumer->close();
       LOG(INFO) << "kafka_consumer topic:" << _topic << ":" << _partition << ", closed - consumed " << _msg_cnt << " messages (" << _msg_bytes << " bytes)";
@@ -147,16 +161,80 @@ namespace kspp {
     /*
     * Subscribe to topics
     */
+    if (_shared) {
+      if (_shared_partition)
+        _shared->remove(_shared_partition);
+      _shared_partition = _shared->add(_topic, _partition, offset);
+      // a new partition starts fetching - keep a pause() from before start
+      if (_paused)
+        _shared->pause(*_shared_partition);
+      update_eof();
+      return;
+    }
+
     _topic_partition[0]->set_offset(offset);
     RdKafka::ErrorCode err0 = _consumer->assign(_topic_partition);
     if (err0) {
       LOG(FATAL) << "kafka_consumer topic:" << _topic << ":" << _partition << ", failed to subscribe, reason:" << RdKafka::err2str(err0);
     }
 
+    // so does a new assignment
+    if (_paused) {
+      RdKafka::ErrorCode ec = _consumer->pause(_topic_partition);
+      LOG_IF(ERROR, ec) << "kafka_consumer topic:" << _topic << ":" << _partition << ", pause failed, reason:" << RdKafka::err2str(ec);
+    }
+
     update_eof();
   }
 
+  bool kafka_consumer::start(int64_t offset, int64_t start_time_ms) {
+    int64_t time_offset = 0;
+    RdKafka::ErrorCode ec = offset_for_time(start_time_ms, time_offset);
+    if (ec) {
+      LOG(WARNING) << "kafka_consumer topic:" << _topic << ":" << _partition << ", offsets for time " << start_time_ms << " failed, reason:" << RdKafka::err2str(ec) << " - skipping older messages instead";
+      start(offset);
+      return false;
+    }
+
+    // nothing to skip
+    if (offset == kspp::OFFSET_END) {
+      start(offset);
+      return true;
+    }
+
+    int64_t from = offset;
+    if (offset == kspp::OFFSET_STORED) {
+      // a committed offset past the start point wins
+      _topic_partition[0]->set_offset(RdKafka::Topic::OFFSET_INVALID);
+      ec = handle()->committed(_topic_partition, 5000);
+      from = (ec == RdKafka::ERR_NO_ERROR) ? _topic_partition[0]->offset() : kspp::OFFSET_BEGINNING;
+    }
+
+    if (time_offset != kspp::OFFSET_END && from < time_offset)
+      from = time_offset;
+    else if (time_offset == kspp::OFFSET_END)
+      from = kspp::OFFSET_END; // every message is older than the start point
+
+    LOG(INFO) << "kafka_consumer topic:" << _topic << ":" << _partition << ", start time: " << start_time_ms << " resolved to offset: " << from;
+    start(from);
+    return true;
+  }
+
+  RdKafka::ErrorCode kafka_consumer::offset_for_time(int64_t ts, int64_t& offset) {
+    std::vector<RdKafka::TopicPartition*> tps = { RdKafka::TopicPartition::create(_topic, _partition, ts) };
+    RdKafka::ErrorCode ec = handle()->offsetsForTimes(tps, 5000);
+    if (ec == RdKafka::ERR_NO_ERROR)
+      ec = tps[0]->err();
+    offset = tps[0]->offset();
+    RdKafka::TopicPartition::destroy(tps);
+    return ec;
+  }
+
   void kafka_consumer::stop() {
+    if (_shared && _shared_partition) {
+      _shared->remove(_shared_partition);
+      _shared_partition.reset();
+    }
     if (_consumer) {
       RdKafka::ErrorCode err = _consumer->unassign();
       if (err) {
@@ -170,10 +248,36 @@ namespace kspp {
     }
   }
 
+  void kafka_consumer::pause() {
+    if (_closed || _paused)
+      return;
+    _paused = true;
+    if (_shared) {
+      if (_shared_partition)
+        _shared->pause(*_shared_partition);
+      return;
+    }
+    RdKafka::ErrorCode ec = _consumer->pause(_topic_partition);
+    LOG_IF(ERROR, ec) << "kafka_consumer topic:" << _topic << ":" << _partition << ", pause failed, reason:" << RdKafka::err2str(ec);
+  }
+
+  void kafka_consumer::resume() {
+    if (_closed || !_paused)
+      return;
+    _paused = false;
+    if (_shared) {
+      if (_shared_partition)
+        _shared->resume(*_shared_partition);
+      return;
+    }
+    RdKafka::ErrorCode ec = _consumer->resume(_topic_partition);
+    LOG_IF(ERROR, ec) << "kafka_consumer topic:" << _topic << ":" << _partition << ", resume failed, reason:" << RdKafka::err2str(ec);
+  }
+
   int kafka_consumer::update_eof(){
     int64_t low = 0;
     int64_t high = 0;
-    RdKafka::ErrorCode ec = _consumer->query_watermark_offsets(_topic, _partition, &low, &high, 1000);
+    RdKafka::ErrorCode ec = handle()->query_watermark_offsets(_topic, _partition, &low, &high, 1000);
     if (ec) {
       LOG(ERROR) << "kafka_consumer topic:" << _topic << ":" << _partition << ", consumer.query_watermark_offsets failed, reason:" << RdKafka::err2str(ec);
       return ec;
@@ -183,7 +287,7 @@ namespace kspp {
       _eof = true;
       LOG(INFO) << "kafka_consumer topic:" << _topic << ":" << _partition << " [empty], eof at:" << high;
     } else {
-      auto ec = _consumer->position(_topic_partition);
+      auto ec = handle()->position(_topic_partition);
       if (ec) {
         LOG(ERROR) << "kafka_consumer topic:" << _topic << ":" << _partition << ", consumer.position failed, reason:" << RdKafka::err2str(ec);
         return ec;
@@ -196,12 +300,21 @@ namespace kspp {
   }
 
   std::unique_ptr<RdKafka::Message> kafka_consumer::consume(int librdkafka_timeout) {
-    if (_closed || _consumer == nullptr) {
+    if (_closed || handle() == nullptr) {
       LOG(ERROR) << "topic:" << _topic << ":" << _partition << ", consume failed: closed()";
       return nullptr; // already closed
     }
 
-    std::unique_ptr<RdKafka::Message> msg(_consumer->consume(librdkafka_timeout));
+    std::unique_ptr<RdKafka::Message> msg;
+    if (_shared) {
+      if (!_shared_partition)
+        return nullptr; // not started
+      msg = _shared->consume(*_shared_partition, librdkafka_timeout);
+      if (!msg)
+        return nullptr;
+    } else {
+      msg.reset(_consumer->consume(librdkafka_timeout));
+    }
 
     switch (msg->err()) {
       case RdKafka::ERR_NO_ERROR:
@@ -231,6 +344,18 @@ namespace kspp {
     return nullptr;
   }
 
+  size_t kafka_consumer::consume(std::vector<std::unique_ptr<RdKafka::Message>>& dst, size_t max_messages, int librdkafka_timeout) {
+    size_t count = 0;
+    auto msg = consume(librdkafka_timeout);
+    while (msg) {
+      dst.push_back(std::move(msg));
+      if (++count == max_messages)
+        break;
+      msg = consume(0);
+    }
+    return count;
+  }
+
   // TBD add time based autocommit
   int32_t kafka_consumer::commit(int64_t offset, bool flush) {
     if (offset < 0) // not valid
@@ -244,7 +369,7 @@ namespace kspp {
       return 0;
     }
 
-    if (_closed || _consumer == nullptr) {
+    if (_closed || handle() == nullptr) {
       LOG(ERROR) << "kafka_consumer topic:" << _topic << ":" << _partition << ", consumer group: " << _consumer_group << ", commit on closed consumer, lost " << offset - _last_committed << " messsages";
       return -1; // already closed
     }
@@ -254,7 +379,7 @@ namespace kspp {
     if (flush) {
       LOG(INFO) << "kafka_consumer topic:" << _topic << ":" << _partition << ", consumer group: " << _consumer_group << ", commiting(flush) offset:" << _can_be_committed;
       _topic_partition[0]->set_offset(_can_be_committed);
-      ec = _consumer->commitSync(_topic_partition);
+      ec = handle()->commitSync(_topic_partition);
       if (ec == RdKafka::ERR_NO_ERROR) {
         _last_committed = _can_be_committed;
       } else {
@@ -263,7 +388,7 @@ namespace kspp {
     } else if ((_last_committed + _max_pending_commits) < _can_be_committed) {
       DLOG(INFO) << "kafka_consumer topic:" << _topic << ":" << _partition << ", consumer group: " << _consumer_group << ", lazy commit: offset:" << _can_be_committed;
       _topic_partition[0]->set_offset(_can_be_committed);
-      ec = _consumer->commitAsync(_topic_partition);
+      ec = handle()->commitAsync(_topic_partition);
       if (ec == RdKafka::ERR_NO_ERROR) {
         _last_committed = _can_be_committed; // not done yet but promised to be written on close...
       } else {
@@ -298,7 +423,7 @@ namespace kspp {
         std::this_thread::sleep_for(1s);
       }
 
-      err = rd_kafka_list_groups(_consumer->c_ptr(), consumer_group.c_str(), &grplist, 1000);
+      err = rd_kafka_list_groups(handle()->c_ptr(), consumer_group.c_str(), &grplist, 1000);
 
       DLOG_IF(INFO, err!=0) << "rd_kafka_list_groups: " << consumer_group.c_str() << ", res: " << err;
       DLOG_IF(INFO, err==0) << "rd_kafka_list_groups: " << consumer_group.c_str() << ", res: OK" << " grplist->group_cnt: "
@@ -0,0 +1,230 @@
+#include <kspp/internal/sources/kafka_shared_consumer.h>
+#include <algorithm>
+#include <chrono>
+#include <glog/logging.h>
+#include <kspp/internal/rd_kafka_utils.h>
+#include <kspp/cluster_config.h>
+
+using namespace std::chrono_literals;
+namespace kspp {
+  void kafka_shared_consumer::MyEventCb::event_cb (RdKafka::Event &event) {
+    switch (event.type())
+    {
+      case RdKafka::Event::EVENT_ERROR:
+        LOG(ERROR) << RdKafka::err2str(event.err()) << " " << event.str();
+        break;
+
+      case RdKafka::Event::EVENT_STATS:
+        LOG(INFO) << "STATS: " << event.str();
+        break;
+
+      case RdKafka::Event::EVENT_LOG:
+        LOG(INFO) << event.fac() << ", " << event.str();
+        break;
+
+      default:
+        LOG(INFO) << "EVENT " << event.type() << " (" << RdKafka::err2str(event.err()) << "): " << event.str();
+        break;
+    }
+  }
+
+  kafka_shared_consumer::kafka_shared_consumer(const cluster_config* config, std::string consumer_group)
+      : _consumer_group(consumer_group)
+      , _exit(false) {
+    std::unique_ptr<RdKafka::Conf> conf(RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL));
+    try {
+      set_broker_config(conf.get(), config);
+      set_config(conf.get(), "socket.nagle.disable", "true");
+      set_config(conf.get(), "fetch.wait.max.ms", std::to_string(config->get_consumer_buffering_time().count()));
+      set_config(conf.get(), "enable.auto.commit", "false");
+      set_config(conf.get(), "auto.commit.interval.ms", "5000"); // probably not needed
+      set_config(conf.get(), "enable.auto.offset.store", "false");
+      set_config(conf.get(), "group.id", _consumer_group);
+      set_config(conf.get(), "enable.partition.eof", "true");
+      set_config(conf.get(), "log.connection.close", "false");
+      set_config(conf.get(), "max.poll.interval.ms", "86400000"); // max poll interval before leaving consumer group
+      set_config(conf.get(), "event_cb", &_event_cb);
+
+      std::unique_ptr<RdKafka::Conf> tconf(RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC));
+      set_config(tconf.get(), "auto.offset.reset", "earliest");
+      set_config(conf.get(), "default_topic_conf", tconf.get());
+    }
+    catch (std::invalid_argument& e) {
+      LOG(FATAL) << "kafka_shared_consumer consumer group: " << _consumer_group << ", bad config " << e.what();
+    }
+
+    std::string errstr;
+    _consumer = std::unique_ptr<RdKafka::KafkaConsumer>(RdKafka::KafkaConsumer::create(conf.get(), errstr));
+    if (!_consumer) {
+      LOG(FATAL) << "kafka_shared_consumer consumer group: " << _consumer_group << ", failed to create consumer, reason: " << errstr;
+    }
+    _thread = std::thread([this]() { thread_f(); });
+    LOG(INFO) << "kafka_shared_consumer consumer group: " << _consumer_group << ", created";
+  }
+
+  kafka_shared_consumer::~kafka_shared_consumer() {
+    _exit = true;
+    _thread.join();
+    {
+      std::unique_lock<std::shared_mutex> lock(_assign_mutex);
+      _partitions.clear();
+    }
+    _consumer->close();
+    LOG(INFO) << "kafka_shared_consumer consumer group: " << _consumer_group << ", closed";
+  }
+
+  std::shared_ptr<kafka_shared_consumer::partition> kafka_shared_consumer::add(std::string topic, int32_t partition_id, int64_t offset) {
+    auto p = std::make_shared<partition>(topic, partition_id, offset);
+    std::unique_ptr<RdKafka::TopicPartition> tp(RdKafka::TopicPartition::create(topic, partition_id));
+    p->_queue.reset(_consumer->get_partition_queue(tp.get()));
+    LOG_IF(FATAL, p->_queue == nullptr) << "kafka_shared_consumer topic:" << topic << ":" << partition_id << ", failed to get partition queue";
+
+    std::unique_lock<std::shared_mutex> lock(_assign_mutex);
+    LOG_IF(FATAL, _partitions.find({topic, partition_id}) != _partitions.end()) << "kafka_shared_consumer topic:" << topic << ":" << partition_id << ", already assigned";
+    _partitions[{topic, partition_id}] = p;
+    reassign();
+    return p;
+  }
+
+  void kafka_shared_consumer::remove(std::shared_ptr<partition> p) {
+    std::unique_lock<std::shared_mutex> lock(_assign_mutex);
+    auto item = _partitions.find({p->_topic, p->_partition});
+    if (item == _partitions.end() || item->second != p)
+      return;
+    _partitions.erase(item);
+    reassign();
+  }
+
+  /*
+   * librdkafka before 1.6 has no incremental assign so every change replaces the whole assignment
+   * partitions already consumed restart at the offset after the last message handed out
+   * no source consumes while this runs so that offset is exact
+   */
+  void kafka_shared_consumer::reassign() {
+    RdKafka::ErrorCode ec = RdKafka::ERR_NO_ERROR;
+    if (_partitions.empty()) {
+      ec = _consumer->unassign();
+    } else {
+      std::vector<RdKafka::TopicPartition*> tps;
+      for (auto& i : _partitions) {
+        // pending messages are after _next_offset and are fetched again
+        {
+          std::lock_guard<std::mutex> guard(i.second->_mutex);
+          i.second->_pending.clear();
+        }
+        tps.push_back(RdKafka::TopicPartition::create(i.second->_topic, i.second->_partition, i.second->_next_offset));
+      }
+      ec = _consumer->assign(tps);
+      RdKafka::TopicPartition::destroy(tps);
+    }
+    if (ec) {
+      LOG(FATAL) << "kafka_shared_consumer consumer group: " << _consumer_group << ", failed to assign " << _partitions.size() << " partitions, reason:" << RdKafka::err2str(ec);
+    }
+
+    // assign forwards every partition to the consumer queue - split them off again
+    std::vector<RdKafka::TopicPartition*> paused;
+    for (auto& i : _partitions) {
+      i.second->_queue->forward(nullptr);
+      if (i.second->_paused)
+        paused.push_back(RdKafka::TopicPartition::create(i.second->_topic, i.second->_partition));
+    }
+
+    // a new assignment starts fetching everything
+    if (!paused.empty()) {
+      ec = _consumer->pause(paused);
+      LOG_IF(ERROR, ec) << "kafka_shared_consumer consumer group: " << _consumer_group << ", failed to pause " << paused.size() << " partitions, reason:" << RdKafka::err2str(ec);
+      RdKafka::TopicPartition::destroy(paused);
+    }
+
+    // anything fetched before the split is older than what ends up in the partition queues
+    while (true) {
+      std::unique_ptr<RdKafka::Message> msg(_consumer->consume(0));
+      if (!msg || msg->err() == RdKafka::ERR__TIMED_OUT)
+        break;
+      route(std::move(msg));
+    }
+    LOG(INFO) << "kafka_shared_consumer consumer group: " << _consumer_group << ", assigned " << _partitions.size() << " partitions";
+  }
+
+  void kafka_shared_consumer::route(std::unique_ptr<RdKafka::Message> msg) {
+    switch (msg->err()) {
+      case RdKafka::ERR__TIMED_OUT:
+        return;
+
+      case RdKafka::ERR_NO_ERROR:
+      case RdKafka::ERR__PARTITION_EOF: {
+        auto item = _partitions.find({msg->topic_name(), msg->partition()});
+        if (item == _partitions.end())
+          return; // no longer assigned
+        std::lock_guard<std::mutex> guard(item->second->_mutex);
+        item->second->_pending.push_back(std::move(msg));
+      }
+        return;
+
+      default:
+        LOG(ERROR) << "kafka_shared_consumer consumer group: " << _consumer_group << ", consume failed: " << msg->errstr();
+    }
+  }
+
+  // waits in short slices so a reassign does not have to wait for a long timeout
+  std::unique_ptr<RdKafka::Message> kafka_shared_consumer::consume(partition& p, int librdkafka_timeout) {
+    auto expires = std::chrono::steady_clock::now() + std::chrono::milliseconds(librdkafka_timeout);
+    while (true) {
+      std::unique_ptr<RdKafka::Message> msg;
+      {
+        std::shared_lock<std::shared_mutex> lock(_assign_mutex);
+        {
+          std::lock_guard<std::mutex> guard(p._mutex);
+          if (!p._pending.empty()) {
+            msg = std::move(p._pending.front());
+            p._pending.pop_front();
+          }
+        }
+        if (!msg) {
+          auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(expires - std::chrono::steady_clock::now()).count();
+          msg.reset(p._queue->consume((int) std::max<int64_t>(0, std::min<int64_t>(remaining, 10))));
+        }
+        if (msg && msg->err() == RdKafka::ERR_NO_ERROR)
+          p._next_offset = msg->offset() + 1;
+      }
+      if (!msg || msg->err() != RdKafka::ERR__TIMED_OUT || std::chrono::steady_clock::now() >= expires)
+        return msg;
+    }
+  }
+
+  void kafka_shared_consumer::pause(partition& p) {
+    set_paused(p, true);
+  }
+
+  void kafka_shared_consumer::resume(partition& p) {
+    set_paused(p, false);
+  }
+
+  // exclusive so it does not race a reassign
+  void kafka_shared_consumer::set_paused(partition& p, bool state) {
+    std::unique_lock<std::shared_mutex> lock(_assign_mutex);
+    if (p._paused == state)
+      return;
+    p._paused = state;
+    std::vector<RdKafka::TopicPartition*> tps = { RdKafka::TopicPartition::create(p._topic, p._partition) };
+    RdKafka::ErrorCode ec = state ? _consumer->pause(tps) : _consumer->resume(tps);
+    LOG_IF(ERROR, ec) << "kafka_shared_consumer topic:" << p._topic << ":" << p._partition << ", " << (state ? "pause" : "resume") << " failed, reason:" << RdKafka::err2str(ec);
+    RdKafka::TopicPartition::destroy(tps);
+  }
+
+  // serves events and anything that still ends up on the consumer queue
+  void kafka_shared_consumer::thread_f() {
+    while (!_exit) {
+      {
+        std::shared_lock<std::shared_mutex> lock(_assign_mutex);
+        while (true) {
+          std::unique_ptr<RdKafka::Message> msg(_consumer->consume(0));
+          if (!msg || msg->err() == RdKafka::ERR__TIMED_OUT)
+            break;
+          route(std::move(msg));
+        }
+      }
+      std::this_thread::sleep_for(100ms);
+    }
+  }
+} // namespace
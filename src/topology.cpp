@@ -115,6 +115,12 @@ namespace kspp {
 
     init_metrics();
 
+    for (auto &&i : _partition_processors)
+      i->register_schemas();
+
+    for (auto &&i : _sinks)
+      i->register_schemas();
+
     validate_preconditions();
 
     init_processing_graph();
@@ -33,6 +33,11 @@ namespace kspp {
     return get_env_and_log("KSPP_KAFKA_BROKER_URL", "plaintext://localhost:9092");
   }
 
+  // number of in process mock brokers to use instead of KSPP_KAFKA_BROKER_URL
+  std::string default_kafka_mock_brokers() {
+    return get_env_and_log("KSPP_KAFKA_MOCK_BROKERS");
+  }
+
   std::string default_kafka_rest_uri() {
     return get_env_and_log("KSPP_KAFKA_REST_URL", "http://localhost:8082");
   }
@@ -0,0 +1,62 @@
+#include <kspp/utils/kafka_mock_cluster.h>
+#include <glog/logging.h>
+#include <librdkafka/rdkafka.h>
+#include <kspp/utils/url_parser.h>
+
+#if __has_include(<librdkafka/rdkafka_mock.h>)
+#include <librdkafka/rdkafka_mock.h>
+#define KSPP_HAS_KAFKA_MOCK 1
+#else
+#define KSPP_HAS_KAFKA_MOCK 0
+#endif
+
+namespace kspp {
+  bool kafka_mock_cluster::available() {
+    return KSPP_HAS_KAFKA_MOCK;
+  }
+
+#if KSPP_HAS_KAFKA_MOCK
+  kafka_mock_cluster::kafka_mock_cluster(size_t nr_of_brokers)
+      : _nr_of_brokers(nr_of_brokers)
+      , _rk(nullptr)
+      , _cluster(nullptr) {
+    char errstr[512];
+    _rk = rd_kafka_new(RD_KAFKA_PRODUCER, rd_kafka_conf_new(), errstr, sizeof(errstr));
+    LOG_IF(FATAL, _rk == nullptr) << "kafka_mock_cluster, failed to create handle, reason: " << errstr;
+    _cluster = rd_kafka_mock_cluster_new(_rk, (int) nr_of_brokers);
+    LOG_IF(FATAL, _cluster == nullptr) << "kafka_mock_cluster, failed to create " << nr_of_brokers << " brokers";
+
+    // bootstraps are host:port,host:port - the broker config wants urls
+    for (auto &i : kspp::split_url_list(rd_kafka_mock_cluster_bootstraps(_cluster), "plaintext")) {
+      if (_brokers.size())
+        _brokers += ",";
+      _brokers += i.str();
+    }
+    LOG(INFO) << "kafka_mock_cluster, started " << nr_of_brokers << " brokers: " << _brokers;
+  }
+
+  kafka_mock_cluster::~kafka_mock_cluster() {
+    rd_kafka_mock_cluster_destroy(_cluster);
+    rd_kafka_destroy(_rk);
+    LOG(INFO) << "kafka_mock_cluster, stopped";
+  }
+
+  void kafka_mock_cluster::create_topic(std::string topic, int32_t nr_of_partitions, int32_t replication_factor) {
+    auto ec = rd_kafka_mock_topic_create(_cluster, topic.c_str(), nr_of_partitions, replication_factor);
+    LOG_IF(FATAL, ec) << "kafka_mock_cluster, failed to create topic: " << topic << ", reason: " << rd_kafka_err2str(ec);
+  }
+#else
+  kafka_mock_cluster::kafka_mock_cluster(size_t nr_of_brokers)
+      : _nr_of_brokers(nr_of_brokers)
+      , _rk(nullptr)
+      , _cluster(nullptr) {
+    LOG(FATAL) << "kafka_mock_cluster, librdkafka " << rd_kafka_version_str() << " has no mock cluster";
+  }
+
+  kafka_mock_cluster::~kafka_mock_cluster() {
+  }
+
+  void kafka_mock_cluster::create_topic(std::string topic, int32_t nr_of_partitions, int32_t replication_factor) {
+  }
+#endif
+}
@@ -0,0 +1,77 @@
+#include <kspp/utils/memory_budget.h>
+#include <algorithm>
+
+namespace kspp {
+  static const auto RATE_WINDOW = std::chrono::milliseconds(500);
+
+  read_ahead_buffer::read_ahead_buffer(std::shared_ptr<memory_budget> budget,
+                                       std::chrono::milliseconds read_ahead_time,
+                                       size_t min_bytes)
+      : _budget(budget)
+      , _read_ahead_time(read_ahead_time)
+      , _min_bytes(min_bytes)
+      , _bytes(0)
+      , _limit(min_bytes)
+      , _window_start(std::chrono::steady_clock::now()) {
+  }
+
+  read_ahead_buffer::~read_ahead_buffer() {
+    if (_budget)
+      _budget->release(_bytes);
+  }
+
+  void read_ahead_buffer::add(size_t events, size_t bytes) {
+    if (events == 0 && bytes == 0)
+      return;
+    {
+      spinlock::scoped_lock xxx(_spinlock);
+      _entries.push_back({events, bytes});
+    }
+    _bytes += bytes;
+    if (_budget)
+      _budget->acquire(bytes);
+  }
+
+  void read_ahead_buffer::remove(size_t events) {
+    if (events == 0)
+      return;
+    size_t released = 0;
+    {
+      spinlock::scoped_lock xxx(_spinlock);
+      while (!_entries.empty() && (events > 0 || _entries.front().events == 0)) {
+        auto &front = _entries.front();
+        if (front.events <= events) {
+          events -= front.events;
+          released += front.bytes;
+          _entries.pop_front();
+        } else {
+          // part of a batch - release its share
+          size_t bytes = front.bytes * events / front.events;
+          front.events -= events;
+          front.bytes -= bytes;
+          released += bytes;
+          events = 0;
+        }
+      }
+    }
+    _bytes -= released;
+    if (_budget)
+      _budget->release(released);
+    update_limit(released);
+  }
+
+  // only called from remove() so the window needs no lock
+  void read_ahead_buffer::update_limit(size_t released) {
+    _window_bytes += released;
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = now - _window_start;
+    if (elapsed < RATE_WINDOW)
+      return;
+    double rate = _window_bytes / std::chrono::duration<double>(elapsed).count();
+    _bytes_per_second = (_bytes_per_second == 0) ? rate : (_bytes_per_second + rate) / 2;
+    _window_bytes = 0;
+    _window_start = now;
+    size_t limit = (size_t) (_bytes_per_second * std::chrono::duration<double>(_read_ahead_time).count());
+    _limit = std::max(limit, _min_bytes);
+  }
+}
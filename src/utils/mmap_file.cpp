@@ -0,0 +1,212 @@
+#include <kspp/utils/mmap_file.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glog/logging.h>
+
+namespace kspp {
+  static const char MMAP_FILE_MAGIC[8] = {'K', 'S', 'P', 'P', 'M', 'M', 'A', 'P'};
+
+  static inline int64_t mtime_ns(const struct stat &st) {
+    return (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+  }
+
+  static inline int compare_keys(const char *a, size_t a_size, const char *b, size_t b_size) {
+    int res = memcmp(a, b, std::min(a_size, b_size));
+    if (res)
+      return res;
+    return (a_size < b_size) ? -1 : (a_size > b_size) ? 1 : 0;
+  }
+
+  mmap_file::mmap_file(std::string path)
+      : path_(path) {
+    fd_ = ::open(path_.c_str(), O_RDONLY);
+    if (fd_ < 0)
+      throw std::runtime_error("mmap_file, failed to open " + path_);
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size < HEADER_SIZE) {
+      ::close(fd_);
+      throw std::runtime_error("mmap_file, bad file " + path_);
+    }
+    file_size_ = st.st_size;
+    id_ = file_id(st.st_dev, st.st_ino, mtime_ns(st), st.st_size);
+
+    void *p = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd_);
+      throw std::runtime_error("mmap_file, mmap failed " + path_);
+    }
+    data_ = (const char *) p;
+
+    uint64_t count = 0;
+    memcpy(&count, data_ + sizeof(MMAP_FILE_MAGIC), sizeof(uint64_t));
+    // count is untrusted - compare without multiplying
+    if (memcmp(data_, MMAP_FILE_MAGIC, sizeof(MMAP_FILE_MAGIC)) != 0 ||
+        count > (file_size_ - HEADER_SIZE) / sizeof(uint64_t)) {
+      munmap((void *) data_, file_size_);
+      ::close(fd_);
+      throw std::runtime_error("mmap_file, not a mmap file " + path_);
+    }
+    count_ = count;
+    try {
+      madvise((void *) data_, file_size_, MADV_SEQUENTIAL);
+      validate();
+    } catch (std::runtime_error &) {
+      munmap((void *) data_, file_size_);
+      ::close(fd_);
+      throw;
+    }
+    madvise((void *) data_, file_size_, MADV_RANDOM);
+    LOG(INFO) << "mmap_file, mapped " << path_ << ", entries: " << count_ << ", size: " << file_size_;
+  }
+
+  mmap_file::~mmap_file() {
+    munmap((void *) data_, file_size_);
+    ::close(fd_);
+  }
+
+  void mmap_file::validate() const {
+    const uint64_t table_end = HEADER_SIZE + count_ * sizeof(uint64_t);
+    const char *prev_key = nullptr;
+    size_t prev_key_size = 0;
+    for (size_t i = 0; i != count_; ++i) {
+      uint64_t offset;
+      memcpy(&offset, data_ + HEADER_SIZE + i * sizeof(uint64_t), sizeof(uint64_t));
+      // every step checks the remaining bytes so nothing can overflow
+      if (offset < table_end || offset > file_size_ || file_size_ - offset < sizeof(uint32_t))
+        throw std::runtime_error("mmap_file, bad offset at entry " + std::to_string(i) + " " + path_);
+      uint64_t remaining = file_size_ - offset - sizeof(uint32_t);
+      uint64_t ksize = read_u32(data_ + offset);
+      if (ksize > remaining || remaining - ksize < sizeof(uint32_t))
+        throw std::runtime_error("mmap_file, bad key size at entry " + std::to_string(i) + " " + path_);
+      remaining -= ksize + sizeof(uint32_t);
+      uint64_t vsize = read_u32(data_ + offset + sizeof(uint32_t) + ksize);
+      if (vsize > remaining)
+        throw std::runtime_error("mmap_file, bad value size at entry " + std::to_string(i) + " " + path_);
+      // find() is a binary search - keys must be unique and sorted
+      const char *key = data_ + offset + sizeof(uint32_t);
+      if (prev_key && compare_keys(prev_key, prev_key_size, key, ksize) >= 0)
+        throw std::runtime_error("mmap_file, key out of order at entry " + std::to_string(i) + " " + path_);
+      prev_key = key;
+      prev_key_size = ksize;
+    }
+  }
+
+  std::shared_ptr<const mmap_file> mmap_file::open(std::experimental::filesystem::path path) {
+    static std::mutex mutex;
+    static std::map<file_id, std::weak_ptr<const mmap_file>> open_files;
+
+    std::string name = std::experimental::filesystem::absolute(path).generic_string();
+    std::lock_guard<std::mutex> guard(mutex);
+    struct stat st;
+    if (stat(name.c_str(), &st) == 0) {
+      auto item = open_files.find(file_id(st.st_dev, st.st_ino, mtime_ns(st), st.st_size));
+      if (item != open_files.end()) {
+        auto p = item->second.lock();
+        if (p)
+          return p;
+      }
+    }
+
+    for (auto i = open_files.begin(); i != open_files.end();) {
+      if (i->second.expired())
+        i = open_files.erase(i);
+      else
+        ++i;
+    }
+
+    // keyed on what was actually opened in case the file was replaced after stat
+    std::shared_ptr<const mmap_file> p(new mmap_file(name));
+    open_files[p->id_] = p;
+    return p;
+  }
+
+  size_t mmap_file::find(const char *key, size_t key_size) const {
+    size_t first = 0;
+    size_t last = count_;
+    while (first < last) {
+      size_t mid = first + (last - first) / 2;
+      int res = compare_keys(key_data(mid), this->key_size(mid), key, key_size);
+      if (res == 0)
+        return mid;
+      if (res < 0)
+        first = mid + 1;
+      else
+        last = mid;
+    }
+    return count_;
+  }
+
+  mmap_file_writer::mmap_file_writer(std::experimental::filesystem::path path)
+      : path_(path) {
+  }
+
+  mmap_file_writer::~mmap_file_writer() {
+    if (!closed_)
+      close();
+  }
+
+  void mmap_file_writer::add(std::string key, std::string value) {
+    entries_.emplace_back(std::move(key), std::move(value));
+  }
+
+  bool mmap_file_writer::close() {
+    closed_ = true;
+    auto less = [](const std::pair<std::string, std::string> &a, const std::pair<std::string, std::string> &b) {
+      return compare_keys(a.first.data(), a.first.size(), b.first.data(), b.first.size()) < 0;
+    };
+    std::stable_sort(entries_.begin(), entries_.end(), less);
+
+    // last added wins
+    std::vector<std::pair<std::string, std::string>> unique;
+    unique.reserve(entries_.size());
+    for (auto &i : entries_) {
+      if (!unique.empty() && unique.back().first == i.first)
+        unique.back() = std::move(i);
+      else
+        unique.push_back(std::move(i));
+    }
+    entries_.clear();
+
+    auto tmp_path = path_;
+    tmp_path += ".tmp";
+    std::ofstream os(tmp_path.generic_string(), std::ios::binary | std::ios::trunc);
+    if (!os.good()) {
+      LOG(ERROR) << "mmap_file_writer, failed to create " << tmp_path;
+      return false;
+    }
+
+    uint64_t count = unique.size();
+    os.write(MMAP_FILE_MAGIC, sizeof(MMAP_FILE_MAGIC));
+    os.write((const char *) &count, sizeof(uint64_t));
+    uint64_t offset = mmap_file::HEADER_SIZE + count * sizeof(uint64_t);
+    for (const auto &i : unique) {
+      os.write((const char *) &offset, sizeof(uint64_t));
+      offset += 2 * sizeof(uint32_t) + i.first.size() + i.second.size();
+    }
+    for (const auto &i : unique) {
+      uint32_t sz = i.first.size();
+      os.write((const char *) &sz, sizeof(uint32_t));
+      os.write(i.first.data(), sz);
+      sz = i.second.size();
+      os.write((const char *) &sz, sizeof(uint32_t));
+      os.write(i.second.data(), sz);
+    }
+    os.flush();
+    if (!os.good()) {
+      LOG(ERROR) << "mmap_file_writer, failed to write " << tmp_path;
+      return false;
+    }
+    os.close();
+    std::experimental::filesystem::rename(tmp_path, path_);
+    LOG(INFO) << "mmap_file_writer, wrote " << path_ << ", entries: " << count;
+    return true;
+  }
+}
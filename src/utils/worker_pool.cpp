@@ -0,0 +1,85 @@
+#include <kspp/utils/worker_pool.h>
+#include <atomic>
+#include <memory>
+
+namespace kspp {
+  worker_pool::worker_pool(size_t nr_of_threads)
+      : _exit(false) {
+    for (size_t i = 0; i != nr_of_threads; ++i)
+      _threads.emplace_back([this]() { thread_f(); });
+  }
+
+  worker_pool::~worker_pool() {
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _exit = true;
+    }
+    _cv.notify_all();
+    for (auto &t : _threads)
+      t.join();
+  }
+
+  void worker_pool::run(std::vector<std::function<void()>> &tasks) {
+    if (tasks.empty())
+      return;
+
+    struct completion {
+      std::atomic<size_t> remaining;
+      std::mutex mutex;
+      std::condition_variable cv;
+    };
+    auto done = std::make_shared<completion>();
+    done->remaining = tasks.size() - 1;
+
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      for (size_t i = 1; i < tasks.size(); ++i) {
+        auto &task = tasks[i];
+        _queue.emplace_back([&task, done]() {
+          task();
+          if (--done->remaining == 0) {
+            std::lock_guard<std::mutex> guard(done->mutex);
+            done->cv.notify_one();
+          }
+        });
+      }
+    }
+    _cv.notify_all();
+
+    tasks[0]();
+
+    // help out instead of just waiting - the queued tasks might belong to other callers
+    while (done->remaining > 0 && run_one());
+
+    std::unique_lock<std::mutex> lock(done->mutex);
+    done->cv.wait(lock, [&done]() { return done->remaining == 0; });
+  }
+
+  bool worker_pool::run_one() {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if (_queue.empty())
+        return false;
+      task = std::move(_queue.front());
+      _queue.pop_front();
+    }
+    task();
+    return true;
+  }
+
+  void worker_pool::thread_f() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [this]() { return _exit || !_queue.empty(); });
+        if (_exit && _queue.empty())
+          return;
+        task = std::move(_queue.front());
+        _queue.pop_front();
+      }
+      task();
+    }
+  }
+}
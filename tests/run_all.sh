@@ -48,6 +48,9 @@ echo "test7_url_vector"
 echo "test8_join"
 ./test8_join
 
+echo "test18_kafka_mock"
+./test18_kafka_mock
+
 echo "tests OK"
 
 
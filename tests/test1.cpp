@@ -1,8 +1,87 @@
+#include <cassert>
+#include <string>
+#include <kspp/krecord.h>
 
+// counts decodes to check that values are decoded once and only on access
+class test_lazy_value : public kspp::lazy_value<std::string> {
+public:
+  test_lazy_value(std::string encoded, int &decodes)
+      : _encoded(encoded)
+      , _decodes(decodes) {
+  }
+
+  std::shared_ptr<const std::string> decode() const override {
+    ++_decodes;
+    if (_encoded.empty())
+      return nullptr; // stands in for bytes that cannot be decoded
+    return std::make_shared<std::string>(_encoded);
+  }
+
+  const void *data() const override {
+    return _encoded.data();
+  }
+
+  size_t size() const override {
+    return _encoded.size();
+  }
+
+  const void *codec() const override {
+    return nullptr;
+  }
+
+private:
+  std::string _encoded;
+  int &_decodes;
+};
 
 int main(int argc, char **argv) {
-  //assert(... == 0);
-  return 0;
-}
+  // lazy values
+  {
+    int decodes = 0;
+    kspp::krecord<std::string, std::string> r("k", std::make_shared<test_lazy_value>("v", decodes), 1);
+    assert(decodes == 0);
+    assert(r.has_value());
+    assert(r.encoded_value()->size() == 1);
+    assert(decodes == 0);
+    assert(*r.value() == "v");
+    assert(*r.shared_value() == "v");
+    assert(decodes == 1);
+    assert(!r.decode_failed());
+
+    kspp::krecord<std::string, std::string> copy(r);
+    assert(*copy.value() == "v");
+    assert(copy.encoded_value() != nullptr);
+    assert(decodes == 1);
+    assert(copy == r);
+  }
+
+  {
+    int decodes = 0;
+    kspp::krecord<void, std::string> r(std::make_shared<test_lazy_value>("v", decodes), 1);
+    assert(decodes == 0);
+    assert(*r.value() == "v");
+    assert(*r.value() == "v");
+    assert(decodes == 1);
+  }
 
+  {
+    kspp::krecord<std::string, std::string> r("k", nullptr, 1);
+    assert(!r.has_value());
+    assert(r.value() == nullptr);
+    assert(r.encoded_value() == nullptr);
+  }
 
+  // a failed decode is not a delete
+  {
+    int decodes = 0;
+    kspp::krecord<std::string, std::string> r("k", std::make_shared<test_lazy_value>("", decodes), 1);
+    assert(r.has_value());
+    assert(r.value() == nullptr);
+    assert(r.decode_failed());
+    assert(decodes == 1);
+
+    kspp::krecord<std::string, std::string> deleted("k", nullptr, 1);
+    assert(!deleted.decode_failed());
+  }
+  return 0;
+}
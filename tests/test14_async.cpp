@@ -2,8 +2,11 @@
 #include <chrono>
 #include <iostream>       // std::cout
 #include <future>         // std::async, std::future
+#include <atomic>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <kspp/utils/async.h>
+#include <kspp/utils/worker_pool.h>
 #include <glog/logging.h>
 
 using namespace std::chrono_literals;
@@ -66,10 +69,42 @@ void test2(){
   LOG(INFO) << "exiting test2";
 }
 
+void test3(){
+  std::cout << "start test 3" << std::endl;
+  kspp::worker_pool pool(3);
+  std::vector<int> result(100, 0);
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i != 10; ++i) {
+    tasks.push_back([&result, i]() {
+      for (size_t j = i * 10; j != (i + 1) * 10; ++j)
+        result[j] = (int) j;
+    });
+  }
+
+  // several callers sharing the pool
+  std::thread other([&pool]() {
+    for (int k = 0; k != 100; ++k) {
+      std::atomic<int> count(0);
+      std::vector<std::function<void()>> t(5, [&count]() { ++count; });
+      pool.run(t);
+      assert(count == 5);
+    }
+  });
+
+  for (int k = 0; k != 100; ++k) {
+    std::fill(result.begin(), result.end(), -1);
+    pool.run(tasks);
+    for (int j = 0; j != 100; ++j)
+      assert(result[j] == j);
+  }
+  other.join();
+  LOG(INFO) << "exiting test3";
+}
 
 int main() {
   test1();
   test2();
+  test3();
   //gflags::ShutDownCommandLineFlags();
   return 0;
 }
@@ -0,0 +1,115 @@
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+#include <kspp/sources/mmap_store.h>
+#include <kspp/internal/serdes/binary_serdes.h>
+#include <kspp/utils/env.h>
+
+int main(int argc, char **argv) {
+  FLAGS_logtostderr = 1;
+  google::InitGoogleLogging(argv[0]);
+
+  std::experimental::filesystem::path path = kspp::default_statestore_root();
+  std::experimental::filesystem::create_directories(path);
+  path /= "test15_mmap_store.bin";
+
+  if (std::experimental::filesystem::exists(path))
+    std::experimental::filesystem::remove(path);
+
+  {
+    auto t0 = kspp::milliseconds_since_epoch();
+    std::vector<std::shared_ptr<const kspp::krecord<int32_t, std::string>>> v;
+    for (int32_t i = 999; i >= 0; --i)
+      v.push_back(std::make_shared<kspp::krecord<int32_t, std::string>>(i, "value" + std::to_string(i), t0));
+    // last added wins
+    v.push_back(std::make_shared<kspp::krecord<int32_t, std::string>>(2, "value2updated", t0));
+    // deletes are skipped
+    v.push_back(std::make_shared<kspp::krecord<int32_t, std::string>>(1000, nullptr, t0));
+    bool res = kspp::mmap_store<int32_t, std::string, kspp::binary_serdes>::write(path, v.begin(), v.end());
+    assert(res);
+  }
+
+  {
+    auto config = std::make_shared<kspp::cluster_config>("");
+    kspp::mmap_store<int32_t, std::string, kspp::binary_serdes> store0(config, 0, path);
+    kspp::mmap_store<int32_t, std::string, kspp::binary_serdes> store1(config, 1, path);
+    // relative to the storage root
+    kspp::mmap_store<int32_t, std::string, kspp::binary_serdes> store2(config, 2, path.filename());
+    assert(store2.get(42) != nullptr);
+
+    for (int32_t i = 0; i != 1000; ++i) {
+      auto record = store0.get(i);
+      assert(record != nullptr);
+      assert(record->key() == i);
+      assert(record->value() != nullptr);
+      if (i == 2)
+        assert(*record->value() == "value2updated");
+      else
+        assert(*record->value() == "value" + std::to_string(i));
+    }
+
+    assert(store1.get(1000) == nullptr);
+    assert(store1.get(-1) == nullptr);
+
+    size_t sz = 0;
+    for (auto i : store1) {
+      assert(i->value() != nullptr);
+      ++sz;
+    }
+    assert(sz == 1000);
+  }
+
+  // a file replaced in place gets a new mapping, a truncated file is rejected
+  {
+    auto file0 = kspp::mmap_file::open(path);
+    {
+      kspp::mmap_file_writer writer(path);
+      writer.add("key", "value");
+      assert(writer.close());
+    }
+    auto file1 = kspp::mmap_file::open(path);
+    assert(file1 != file0);
+    assert(file1->size() == 1);
+    assert(file0->size() == 1000);
+
+    std::experimental::filesystem::resize_file(path, std::experimental::filesystem::file_size(path) - 1);
+    bool failed = false;
+    try {
+      kspp::mmap_file::open(path);
+    } catch (std::runtime_error &e) {
+      failed = true;
+    }
+    assert(failed);
+  }
+
+  // keys out of order are rejected - find() would silently miss them
+  {
+    std::ofstream os(path.generic_string(), std::ios::binary | std::ios::trunc);
+    uint64_t count = 2;
+    os.write("KSPPMMAP", 8);
+    os.write((const char *) &count, sizeof(uint64_t));
+    uint64_t offset = 16 + count * sizeof(uint64_t);
+    for (size_t i = 0; i != count; ++i, offset += 2 * sizeof(uint32_t) + 2)
+      os.write((const char *) &offset, sizeof(uint64_t));
+    for (const char *key : {"b", "a"}) {
+      uint32_t sz = 1;
+      os.write((const char *) &sz, sizeof(uint32_t));
+      os.write(key, 1);
+      os.write((const char *) &sz, sizeof(uint32_t));
+      os.write("v", 1);
+    }
+    os.close();
+    bool failed = false;
+    try {
+      kspp::mmap_file::open(path);
+    } catch (std::runtime_error &e) {
+      failed = true;
+    }
+    assert(failed);
+  }
+
+  // cleanup
+  std::experimental::filesystem::remove(path);
+
+  return 0;
+}
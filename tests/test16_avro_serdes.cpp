@@ -0,0 +1,327 @@
+#include <cassert>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <kspp/serdes/avro_serdes.h>
+#include <kspp/utils/output_buffer.h>
+#include <kspp/utils/concurrent_id_map.h>
+#include <kspp/avro/avro_field_path.h>
+#include <kspp/avro/avro_fast_codec.h>
+#include <kspp/avro/avro_projection.h>
+#include <kspp/avro/avro_column_batch.h>
+#include <kspp/avro/compact_avro.h>
+#ifdef KSPP_TEST_FAST_CODEC
+#include <avro/Stream.hh>
+#include "test16_fast_codec.h" // kspp_avrogencpp --fast-codec schemas/test16_fast_codec.avsc
+#endif
+
+int main(int argc, char **argv) {
+  FLAGS_logtostderr = 1;
+  google::InitGoogleLogging(argv[0]);
+
+  // output_buffer through std::ostream
+  {
+    kspp::output_buffer buf(16);
+    std::ostream os(&buf);
+    std::string big(1000, 'x');
+    os << "abc";
+    os.write(big.data(), big.size());
+    assert(buf.size() == 1003);
+    assert(memcmp(buf.data(), "abc", 3) == 0);
+    assert(memcmp(buf.data() + 3, big.data(), big.size()) == 0);
+
+    char *p = buf.release();
+    assert(p != nullptr);
+    assert(buf.size() == 0);
+    free(p);
+
+    os << "def";
+    assert(buf.size() == 3);
+    assert(memcmp(buf.data(), "def", 3) == 0);
+  }
+
+  // direct encoding gives the same bytes as encoding through a stringstream
+  {
+    kspp::avro_serdes serdes(nullptr, false);
+    for (size_t sz : {0, 10, 300, 10000}) {
+      std::string value(sz, 'a');
+      std::stringstream ss;
+      size_t ss_size = serdes.encode(42, value, ss);
+
+      kspp::output_buffer buf;
+      size_t buf_size = serdes.encode(42, value, buf);
+      assert(ss_size == buf_size);
+      assert(buf.size() == buf_size);
+      assert(ss.str() == std::string(buf.data(), buf.size()));
+
+      // framing
+      assert(buf.data()[0] == 0x00);
+      int32_t encoded_schema_id;
+      memcpy(&encoded_schema_id, buf.data() + 1, 4);
+      assert(ntohl(encoded_schema_id) == 42);
+
+      // ostream backed by output_buffer takes the in place path
+      kspp::output_buffer buf2;
+      std::ostream os(&buf2);
+      serdes.encode(42, value, os);
+      assert(std::string(buf2.data(), buf2.size()) == ss.str());
+
+      std::string decoded;
+      auto schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString("{\"type\":\"string\"}"));
+      assert(serdes.decode(42, schema, buf.data(), buf.size(), decoded) == buf.size());
+      assert(decoded == value);
+    }
+  }
+  // schema id cache - more ids than slots ends up in overflow
+  {
+    kspp::concurrent_id_map<int> cache;
+    for (int i = 0; i != 3000; ++i)
+      assert(*cache.insert(i * 7, i) == i);
+    for (int i = 0; i != 3000; ++i)
+      assert(*cache.find(i * 7) == i);
+    assert(cache.find(1) == nullptr);
+    assert(*cache.insert(7, 42) == 1); // existing value is kept
+  }
+  // fast codecs are wire compatible with the avro encoder
+  {
+    kspp::avro_serdes serdes(nullptr, false);
+    for (int64_t v : std::vector<int64_t>{0, -1, 63, -64, 64, 1LL << 40, INT64_MIN, INT64_MAX}) {
+      kspp::output_buffer expected;
+      serdes.encode(42, v, expected);
+      kspp::output_buffer buf;
+      kspp::avro_fast::writer w(buf);
+      kspp::avro_fast::encode(w, v);
+      assert(std::string(buf.data(), buf.size()) == std::string(expected.data() + 5, expected.size() - 5));
+
+      kspp::avro_fast::reader r((const uint8_t *) buf.data(), buf.size());
+      int64_t decoded = 0;
+      kspp::avro_fast::decode(r, decoded);
+      assert(decoded == v);
+      assert(r.consumed() == buf.size());
+    }
+
+    std::vector<std::string> v = {"a", std::string(300, 'b')};
+    kspp::output_buffer expected;
+    serdes.encode(42, v, expected);
+    kspp::output_buffer buf;
+    kspp::avro_fast::writer w(buf);
+    kspp::avro_fast::encode(w, v);
+    assert(std::string(buf.data(), buf.size()) == std::string(expected.data() + 5, expected.size() - 5));
+
+    // truncated data throws
+    kspp::avro_fast::reader r((const uint8_t *) buf.data(), buf.size() - 1);
+    std::vector<std::string> decoded;
+    bool thrown = false;
+    try {
+      kspp::avro_fast::decode(r, decoded);
+    } catch (avro::Exception &e) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+
+#ifdef KSPP_TEST_FAST_CODEC
+  // generated fast codecs against the generated avro codec_traits - record, enum, unions, array, nested record
+  {
+    fast_record v;
+    v.id = -4711;
+    v.count = 42;
+    v.ratio = 0.25;
+    v.name = std::string(200, 'n');
+    v.active = true;
+    v.color = FAST_BLUE;
+    v.comment.set_string("hello");
+    v.choice.set_long(1LL << 40);
+    v.tags = {"a", "", "ccc"};
+    v.inner.value = INT64_MIN;
+
+    fast_record other; // null branches and defaults
+    other.choice.set_string("x");
+
+    for (const auto &src : std::vector<fast_record>{v, other}) {
+      auto os = avro::memoryOutputStream();
+      auto encoder = avro::binaryEncoder();
+      encoder->init(*os);
+      avro::encode(*encoder, src);
+      encoder->flush();
+      auto expected = avro::snapshot(*os);
+
+      kspp::output_buffer buf;
+      kspp::avro_fast::writer w(buf);
+      kspp::avro_fast::encode(w, src);
+      assert(std::string(buf.data(), buf.size()) == std::string((const char *) expected->data(), expected->size()));
+
+      fast_record decoded;
+      kspp::avro_fast::reader r(expected->data(), expected->size());
+      kspp::avro_fast::decode(r, decoded);
+      assert(r.consumed() == expected->size());
+      assert(decoded.id == src.id && decoded.count == src.count && decoded.ratio == src.ratio);
+      assert(decoded.name == src.name && decoded.active == src.active && decoded.color == src.color);
+      assert(decoded.comment.is_null() == src.comment.is_null());
+      assert(decoded.comment.is_null() || decoded.comment.get_string() == src.comment.get_string());
+      assert(decoded.choice.idx() == src.choice.idx());
+      assert(decoded.choice.idx() != 1 || decoded.choice.get_long() == src.choice.get_long());
+      assert(decoded.choice.idx() != 2 || decoded.choice.get_string() == src.choice.get_string());
+      assert(decoded.tags == src.tags && decoded.inner.value == src.inner.value);
+    }
+  }
+#endif
+
+  // compiled field paths into nested and nullable records
+  {
+    auto schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString(
+        "{\"type\":\"record\",\"name\":\"outer\",\"fields\":["
+        "{\"name\":\"id\",\"type\":\"long\"},"
+        "{\"name\":\"inner\",\"type\":[\"null\",{\"type\":\"record\",\"name\":\"inner_t\",\"fields\":["
+        "{\"name\":\"name\",\"type\":\"string\"}]}]}]}"));
+    kspp::generic_avro v(schema, -1);
+    auto record = v.mutable_record();
+    record.set<int64_t>("id", 17);
+    assert(record.get<int64_t>(record.field_index("id")) == 17);
+
+    kspp::avro_field_accessor accessor({"id", "inner.name"});
+    const auto &paths = accessor.compile(schema);
+    assert(&paths == &accessor.compile(schema)); // cached per schema
+    assert(paths[0].get<int64_t>(v) == 17);
+    assert(!paths[1].get_optional<std::string>(v)); // inner is null
+
+    avro::GenericDatum &inner = v.generic_datum()->value<avro::GenericRecord>().fieldAt(1);
+    inner.selectBranch(1);
+    inner.value<avro::GenericRecord>().fieldAt(0).value<std::string>() = "kalle";
+    assert(*paths[1].get_optional<std::string>(v) == "kalle");
+
+    bool thrown = false;
+    try {
+      kspp::avro_field_path(*schema, "inner.missing");
+    } catch (std::invalid_argument &e) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+  // projection skips the fields not asked for
+  {
+    auto schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString(
+        "{\"type\":\"record\",\"name\":\"wide\",\"fields\":["
+        "{\"name\":\"id\",\"type\":\"long\"},"
+        "{\"name\":\"tags\",\"type\":{\"type\":\"array\",\"items\":\"string\"}},"
+        "{\"name\":\"attrs\",\"type\":{\"type\":\"map\",\"values\":\"long\"}},"
+        "{\"name\":\"opt\",\"type\":[\"null\",\"double\"]},"
+        "{\"name\":\"inner\",\"type\":{\"type\":\"record\",\"name\":\"inner_t\",\"fields\":["
+        "{\"name\":\"name\",\"type\":\"string\"}]}},"
+        "{\"name\":\"last\",\"type\":\"string\"}]}"));
+    kspp::generic_avro v(schema, 42);
+    auto &record = v.generic_datum()->value<avro::GenericRecord>();
+    record.fieldAt(0).value<int64_t>() = 4711;
+    record.fieldAt(1).value<avro::GenericArray>().value().push_back(avro::GenericDatum(std::string("a")));
+    record.fieldAt(2).value<avro::GenericMap>().value().push_back(std::make_pair(std::string("k"), avro::GenericDatum(int64_t(1))));
+    record.fieldAt(3).selectBranch(1);
+    record.fieldAt(3).value<double>() = 0.5;
+    record.fieldAt(4).value<avro::GenericRecord>().fieldAt(0).value<std::string>() = "kalle";
+    record.fieldAt(5).value<std::string>() = "end";
+
+    kspp::avro_serdes serdes(nullptr, false);
+    kspp::output_buffer buf;
+    serdes.encode(42, *v.generic_datum(), buf);
+
+    kspp::avro_projection projection(schema, {"last", "opt", "inner"});
+    avro::GenericDatum projected(*projection.reader_schema());
+    size_t consumed = projection.decode((const uint8_t *) buf.data() + 5, buf.size() - 5, projected);
+    assert(consumed == buf.size() - 5);
+    auto &p = projected.value<avro::GenericRecord>();
+    assert(p.fieldCount() == 3);
+    assert(p.fieldAt(0).value<std::string>() == "end");
+    assert(p.fieldAt(1).value<double>() == 0.5);
+    assert(p.fieldAt(2).value<avro::GenericRecord>().fieldAt(0).value<std::string>() == "kalle");
+
+    bool thrown = false;
+    try {
+      kspp::avro_projection(schema, {"missing"});
+    } catch (std::invalid_argument &e) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+  // columnar batch decoding
+  {
+    auto schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString(
+        "{\"type\":\"record\",\"name\":\"measurement\",\"fields\":["
+        "{\"name\":\"ts\",\"type\":\"long\"},"
+        "{\"name\":\"tags\",\"type\":{\"type\":\"array\",\"items\":\"string\"}},"
+        "{\"name\":\"host\",\"type\":[\"null\",\"string\"]},"
+        "{\"name\":\"value\",\"type\":\"double\"}]}"));
+    kspp::avro_serdes serdes(nullptr, false);
+    std::vector<std::string> payloads;
+    for (int i = 0; i != 3; ++i) {
+      kspp::generic_avro v(schema, 7);
+      auto &record = v.generic_datum()->value<avro::GenericRecord>();
+      record.fieldAt(0).value<int64_t>() = 1000 + i;
+      record.fieldAt(1).value<avro::GenericArray>().value().push_back(avro::GenericDatum(std::string("t")));
+      if (i != 1) {
+        record.fieldAt(2).selectBranch(1);
+        record.fieldAt(2).value<std::string>() = "host" + std::to_string(i);
+      }
+      record.fieldAt(3).value<double>() = i * 0.5;
+      kspp::output_buffer buf;
+      serdes.encode(7, *v.generic_datum(), buf);
+      payloads.emplace_back(buf.data(), buf.size());
+    }
+
+    kspp::avro_column_decoder decoder(schema, 7);
+    auto batch = decoder.make_batch();
+    assert(batch->columns().size() == 3); // tags is not a column
+    assert(decoder.append(payloads.begin(), payloads.end(), *batch) == 3);
+    assert(!decoder.append(payloads[0].data(), payloads[0].size() - 2, *batch)); // truncated
+    assert(batch->rows() == 3);
+
+    auto ts = batch->column("ts");
+    auto host = batch->column("host");
+    auto value = batch->column("value");
+    assert(ts && host && value);
+    assert(ts->values<int64_t>()[2] == 1002);
+    assert(!ts->nullable() && host->nullable());
+    assert(!host->is_null(0) && host->is_null(1) && !host->is_null(2));
+    assert(host->string_at(0) == "host0" && host->string_at(1).empty() && host->string_at(2) == "host2");
+    assert(value->values<double>()[1] == 0.5);
+
+    batch->clear();
+    assert(batch->rows() == 0 && host->size() == 0);
+  }
+  // compact arena backed records
+  {
+    auto schema = std::make_shared<const avro::ValidSchema>(avro::compileJsonSchemaFromString(
+        "{\"type\":\"record\",\"name\":\"compact\",\"fields\":["
+        "{\"name\":\"id\",\"type\":\"long\"},"
+        "{\"name\":\"name\",\"type\":\"string\"},"
+        "{\"name\":\"tags\",\"type\":{\"type\":\"array\",\"items\":\"string\"}},"
+        "{\"name\":\"opt\",\"type\":[\"null\",\"int\"]}]}"));
+    kspp::generic_avro v(schema, 3);
+    auto &record = v.generic_datum()->value<avro::GenericRecord>();
+    record.fieldAt(0).value<int64_t>() = 77;
+    record.fieldAt(1).value<std::string>() = "nisse";
+    record.fieldAt(2).value<avro::GenericArray>().value().push_back(avro::GenericDatum(std::string("x")));
+
+    auto compact = kspp::compact_avro::from_generic(v);
+    assert(compact.schema_id() == 3);
+    auto r = compact.record();
+    assert(r.get<int64_t>("id") == 77);
+    assert(r.get<std::string>(r.field_index("name")) == "nisse");
+    assert(r.is_null("opt") && !r.get_optional<int32_t>("opt"));
+    assert(r.get<int32_t>("opt", 5) == 5);
+    assert(r.get<avro::GenericArray>("tags").value().size() == 1);
+
+    // same wire format as generic_avro
+    kspp::avro_serdes serdes(nullptr, false);
+    kspp::output_buffer generic_buf;
+    kspp::output_buffer compact_buf;
+    serdes.encode(3, *v.generic_datum(), generic_buf);
+    serdes.encode(3, compact, compact_buf);
+    assert(generic_buf.size() == compact_buf.size());
+    assert(memcmp(generic_buf.data(), compact_buf.data(), generic_buf.size()) == 0);
+
+    kspp::compact_avro decoded(schema, 3);
+    assert(decoded.decode((const uint8_t *) compact_buf.data() + 5, compact_buf.size() - 5) == compact_buf.size() - 5);
+    auto back = decoded.to_generic();
+    assert(back.record().get<std::string>("name") == "nisse");
+  }
+  return 0;
+}
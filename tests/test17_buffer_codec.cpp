@@ -0,0 +1,136 @@
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <kspp/internal/serdes/binary_serdes.h>
+#include <kspp/serdes/text_serdes.h>
+#include <kspp/serdes/buffer_codec.h>
+#include <kspp/kspp.h>
+
+// a user type that only implements the stream interface
+struct user_type {
+  int64_t ts;
+  std::string name;
+};
+
+// an enum with its own one byte encoding - must not be taken for an int32_t
+enum user_enum { RED = 1, GREEN = 2 };
+
+namespace kspp {
+  template<>
+  inline size_t binary_serdes::encode(const user_enum &src, std::ostream &dst) {
+    return binary_serdes::encode((uint8_t) src, dst);
+  }
+
+  template<>
+  inline size_t binary_serdes::encode(const user_type &src, std::ostream &dst) {
+    return binary_serdes::encode(src.ts, dst) + binary_serdes::encode(src.name, dst);
+  }
+
+  template<>
+  inline size_t binary_serdes::decode(std::istream &src, user_type &dst) {
+    return binary_serdes::decode(src, dst.ts) + binary_serdes::decode(src, dst.name);
+  }
+}
+
+int main(int argc, char **argv) {
+  // built in types are encoded without streams
+  {
+    kspp::binary_serdes codec;
+    kspp::output_buffer buf;
+    std::string s = "hello";
+    assert(kspp::codec_encode(codec, s, buf) == 9);
+    int64_t v = 4711;
+    assert(kspp::codec_encode(codec, v, buf) == 8);
+
+    kspp::input_buffer src(buf.data(), buf.size());
+    std::string s2;
+    int64_t v2 = 0;
+    assert(kspp::codec_decode(codec, src, s2) == 9);
+    assert(kspp::codec_decode(codec, src, v2) == 8);
+    assert(s2 == s && v2 == v);
+    assert(src.remaining() == 0);
+
+    // truncated
+    assert(codec.decode(buf.data(), 3, v2) == 0);
+    assert(codec.decode(buf.data(), 6, s2) == 0);
+  }
+
+  // stream only user types are adapted
+  {
+    kspp::binary_serdes codec;
+    kspp::output_buffer buf;
+    std::vector<user_type> v = {{1, "a"}, {2, "bb"}};
+    size_t sz = kspp::codec_encode(codec, v, buf);
+    assert(sz == buf.size());
+    std::vector<user_type> v2;
+    assert(codec.decode(buf.data(), buf.size(), v2) == sz);
+    assert(v2.size() == 2 && v2[1].ts == 2 && v2[1].name == "bb");
+
+    // a truncated item fails the whole vector
+    kspp::output_buffer buf2;
+    std::vector<std::string> strings = {"abc", "defgh"};
+    sz = kspp::codec_encode(codec, strings, buf2);
+    std::vector<std::string> strings2;
+    assert(codec.decode(buf2.data(), sz - 2, strings2) == 0);
+  }
+
+  // buffer overloads are exact types only
+  {
+    static_assert(!kspp::has_buffer_encode<kspp::binary_serdes, user_enum>::value);
+    static_assert(!kspp::has_buffer_encode<kspp::binary_serdes, int16_t>::value);
+    static_assert(!kspp::has_buffer_encode<kspp::text_serdes, short>::value);
+    static_assert(kspp::has_buffer_encode<kspp::text_serdes, unsigned long>::value);
+    static_assert(!kspp::has_buffer_decode<kspp::text_serdes, short>::value);
+    static_assert(kspp::has_buffer_decode<kspp::text_serdes, unsigned long>::value);
+    kspp::binary_serdes codec;
+    kspp::output_buffer buf;
+    assert(kspp::codec_encode(codec, GREEN, buf) == 1 && buf.data()[0] == 2);
+  }
+
+  // same bytes as the stream interface
+  {
+    kspp::binary_serdes codec;
+    kspp::output_buffer buf;
+    std::stringstream ss;
+    std::string s = "kspp";
+    kspp::codec_encode(codec, s, buf);
+    codec.encode(s, ss);
+    assert(ss.str() == std::string(buf.data(), buf.size()));
+  }
+
+  // text
+  {
+    kspp::text_serdes codec;
+    kspp::output_buffer buf;
+    long v = -42;
+    assert(kspp::codec_encode(codec, v, buf) == 3);
+    long v2 = 0;
+    codec.decode(buf.data(), buf.size(), v2);
+    assert(v2 == v);
+    std::string line;
+    assert(codec.decode("first\nsecond", 12, line) == 5 && line == "first");
+    bool b = false;
+    assert(codec.decode("true\n", 5, b) == 4 && b);
+  }
+  // partition hashes without encoding give the same result as hashing the encoded key
+  {
+    auto binary = std::make_shared<kspp::binary_serdes>();
+    auto text = std::make_shared<kspp::text_serdes>();
+    std::vector<std::string> keys = {"", "a", "abc", "abcd", "abcde", std::string(5000, 'x')};
+    for (auto &k : keys) {
+      kspp::output_buffer buf;
+      kspp::codec_encode(*binary, k, buf);
+      assert(kspp::get_partition_hash(k, binary) == MurmurHash2(buf.data(), (int) buf.size(), kspp::PARTITION_HASH_SEED));
+      assert(kspp::get_partition_hash(k, text) == MurmurHash2(k.data(), (int) k.size(), kspp::PARTITION_HASH_SEED));
+    }
+
+    std::vector<int64_t> numbers = {0, 1, -1, INT64_MAX, INT64_MIN};
+    auto hashes = kspp::get_partition_hashes(numbers, text);
+    for (size_t i = 0; i != numbers.size(); ++i) {
+      auto s = std::to_string(numbers[i]);
+      assert(hashes[i] == MurmurHash2(s.data(), (int) s.size(), kspp::PARTITION_HASH_SEED));
+      assert(kspp::get_partition_hash(numbers[i], binary) == MurmurHash2(&numbers[i], 8, kspp::PARTITION_HASH_SEED));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <chrono>
+#include <cassert>
+#include <kspp/internal/serdes/binary_serdes.h>
+#include <kspp/utils/kafka_utils.h>
+#include <kspp/utils/kafka_mock_cluster.h>
+#include <kspp/topology_builder.h>
+#include <kspp/sinks/kafka_sink.h>
+#include <kspp/sources/kafka_source.h>
+#include <kspp/sinks/null_sink.h>
+
+using namespace std::chrono_literals;
+using namespace kspp;
+
+#define TEST_SIZE 100000
+#define NR_OF_PARTITIONS 8
+
+// end to end source / sink throughput against in process brokers - no kafka installation needed
+int main(int argc, char **argv) {
+  FLAGS_logtostderr = 1;
+  google::InitGoogleLogging(argv[0]);
+
+  if (!kafka_mock_cluster::available()) {
+    LOG(INFO) << "librdkafka has no mock cluster - skipping";
+    return 0;
+  }
+
+  auto config = std::make_shared<cluster_config>(std::string("kspp-tests") + argv[0], cluster_config::KAFKA);
+  config->set_mock_cluster(3);
+  config->get_mock_cluster()->create_topic("kspp_test18", NR_OF_PARTITIONS);
+  config->set_producer_buffering_time(10ms);
+  config->set_consumer_buffering_time(10ms);
+  config->set_storage_root("/tmp/kspp_test18");
+  config->log(); // optional
+  config->validate();// optional
+
+  auto nr_of_partitions = kafka::get_number_partitions(config, "kspp_test18");
+  assert(nr_of_partitions == NR_OF_PARTITIONS);
+  auto partition_list = get_partition_list(nr_of_partitions);
+
+  kspp::topology_builder builder(config);
+  auto topology = builder.create_topology();
+  auto sink = topology->create_sink<kafka_sink<std::string, std::string, binary_serdes, binary_serdes>>("kspp_test18");
+  auto sources = topology->create_processors<kafka_source<std::string, std::string, binary_serdes, binary_serdes>>(
+      partition_list, "kspp_test18");
+  topology->create_sink<null_sink<std::string, std::string>>(sources, [](auto r) { /* noop */ });
+  topology->start(kspp::OFFSET_BEGINNING);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i != TEST_SIZE; ++i)
+    sink->push_back("key" + std::to_string(i), "value" + std::to_string(i), milliseconds_since_epoch());
+  sink->flush();
+  auto t1 = std::chrono::steady_clock::now();
+
+  int64_t consumed = 0;
+  auto end = std::chrono::steady_clock::now() + 30s;
+  while (consumed < TEST_SIZE && std::chrono::steady_clock::now() < end) {
+    topology->process(milliseconds_since_epoch());
+    consumed = 0;
+    for (auto &&i : sources)
+      consumed += i->get_metric("kspp.processed");
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  topology->commit(true);
+
+  assert(sink->get_metric("kspp.processed") == TEST_SIZE);
+  LOG(INFO) << "consumed: " << consumed << " expected : " << TEST_SIZE;
+  assert(consumed == TEST_SIZE);
+
+  auto produce_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count() + 1;
+  auto consume_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() + 1;
+  LOG(INFO) << "produce: " << produce_ms << " ms, " << (TEST_SIZE * 1000 / produce_ms) << " msg/s";
+  LOG(INFO) << "consume (after produce): " << consume_ms << " ms";
+  return 0;
+}
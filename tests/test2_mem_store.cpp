@@ -1,4 +1,5 @@
 #include <cassert>
+#include <thread>
 #include <kspp/state_stores/mem_store.h>
 
 using namespace std::chrono_literals;
@@ -57,6 +58,75 @@ int main(int argc, char **argv) {
       assert(record == nullptr);
     }
   }
+
+  // snapshots
+  {
+    kspp::mem_store<int32_t, std::string> store("");
+    assert(store.snapshot() == nullptr); // not enabled
+    store.enable_snapshots(100ms);
+    auto t0 = kspp::milliseconds_since_epoch();
+    store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(0, "value0", t0), 0);
+    store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(1, "value1", t0), 1);
+    store.publish_snapshot(t0);
+    auto snapshot = store.snapshot();
+    assert(snapshot != nullptr);
+    assert(snapshot->offset() == 1);
+
+    // changes are not visible in an existing snapshot
+    store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(2, "value2", t0), 2);
+    store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(0, nullptr, t0 + 10), 3);
+    store.publish_snapshot(t0 + 10); // before interval - nothing published
+    assert(store.snapshot() == snapshot);
+    assert(snapshot->get(0) != nullptr);
+    assert(snapshot->get(2) == nullptr);
+
+    store.publish_snapshot(t0 + 100);
+    auto snapshot2 = store.snapshot();
+    assert(snapshot2->offset() == 3);
+    assert(snapshot2->get(0) == nullptr);
+    assert(*snapshot2->get(2)->value() == "value2");
+
+    // old snapshot still intact
+    size_t sz = 0;
+    for (auto i = snapshot->begin(); i != snapshot->end(); ++i)
+      ++sz;
+    assert(sz == 2);
+
+    // range scan
+    auto it = snapshot2->seek(2);
+    assert(it != snapshot2->end());
+    assert((*it)->key() == 2);
+    ++it;
+    assert(it == snapshot2->end());
+  }
+
+  // many snapshots - changes are layered and merged in the background
+  {
+    kspp::mem_store<int32_t, std::string> store("");
+    store.enable_snapshots(1ms);
+    int64_t offset = 0;
+    for (int i = 0; i != 100; ++i)
+      store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(i, "a" + std::to_string(i), 1), offset++);
+    store.publish_snapshot(1);
+    for (int64_t tick = 2; tick != 50; ++tick) {
+      store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(tick, "b" + std::to_string(tick), tick), offset++);
+      store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(tick + 1, nullptr, tick), offset++);
+      store.publish_snapshot(tick);
+      std::this_thread::sleep_for(1ms);
+    }
+    auto snapshot = store.snapshot();
+    assert(snapshot->offset() == offset - 1);
+    auto expected = store.begin();
+    for (auto i = snapshot->begin(); i != snapshot->end(); ++i, ++expected) {
+      assert(expected != store.end());
+      assert((*i)->key() == (*expected)->key());
+      assert(*(*i)->value() == *(*expected)->value());
+    }
+    assert(expected == store.end());
+    assert(*snapshot->get(49)->value() == "b49");
+    assert(snapshot->get(50) == nullptr);
+    assert(*snapshot->get(51)->value() == "a51");
+  }
   return 0;
 }
 
@@ -82,6 +82,25 @@ int main(int argc, char **argv) {
     }
   }
 
+  {
+    // pre-aggregated increments must survive a reopen
+    kspp::rocksdb_counter_store<int32_t, int, kspp::binary_serdes> store(path);
+    auto t0 = kspp::milliseconds_since_epoch();
+    for (int i = 0; i != 100; ++i)
+      store.insert(std::make_shared<kspp::krecord<int32_t, int>>(0, 1, t0), -1);
+    auto record = store.get(0);
+    assert(record != nullptr);
+    assert(*record->value() == 99);
+  }
+
+  {
+    kspp::rocksdb_counter_store<int32_t, int, kspp::binary_serdes> store(path);
+    assert(store.exact_size() == 2);
+    auto record = store.get(0);
+    assert(record != nullptr);
+    assert(*record->value() == 99);
+  }
+
   // cleanup
   std::experimental::filesystem::remove_all(path);
 
@@ -65,6 +65,30 @@ int main(int argc, char **argv) {
       assert(record == nullptr);
     }
   }
+
+  // snapshots
+  {
+    kspp::rocksdb_store<int32_t, std::string, kspp::binary_serdes> store(path);
+    auto t0 = kspp::milliseconds_since_epoch();
+    store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(5, "value5", t0), 5);
+    auto snapshot = store.snapshot();
+    assert(snapshot != nullptr);
+    assert(snapshot->offset() == 5);
+    store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(5, "value5updated", t0 + 10), 6);
+    store.insert(std::make_shared<kspp::krecord<int32_t, std::string>>(6, "value6", t0 + 10), 7);
+    assert(*snapshot->get(5)->value() == "value5");
+    assert(snapshot->get(6) == nullptr);
+    assert(*store.snapshot()->get(5)->value() == "value5updated");
+
+    auto it = snapshot->seek(5);
+    assert(it != snapshot->end());
+    assert((*it)->key() == 5);
+
+    // snapshot keeps the database readable after close
+    store.close();
+    assert(store.snapshot() == nullptr);
+    assert(*snapshot->get(5)->value() == "value5");
+  }
   // cleanup
   std::experimental::filesystem::remove_all(path);
   return 0;
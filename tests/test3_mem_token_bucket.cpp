@@ -11,16 +11,16 @@ int main(int argc, char **argv) {
     // insert 3 check size
     kspp::mem_token_bucket_store<int32_t, int8_t> store(100ms, 2);
     auto t0 = kspp::milliseconds_since_epoch();
-    assert(store.consume(0, t0) == true);
-    assert(store.consume(1, t0) == true);
-    assert(store.consume(2, t0) == true);
+    assert(store.consume(0, t0, 0) == true);
+    assert(store.consume(1, t0, 1) == true);
+    assert(store.consume(2, t0, 2) == true);
     assert(store.exact_size() == 3);
 
     assert(store.exact_size() == 3); // tests iterators
 
     // consume existing key
     {
-      assert(store.consume(2, t0 + 10) == true);
+      assert(store.consume(2, t0 + 10, 3) == true);
       assert(store.exact_size() == 3);
       auto res = store.get(2);
       assert(res);
@@ -32,7 +32,7 @@ int main(int argc, char **argv) {
 
     // consume existing key to fast
     {
-      assert(store.consume(2, t0 + 20) == false);
+      assert(store.consume(2, t0 + 20, 4) == false);
       assert(store.exact_size() == 3);
       auto res = store.get(2);
       assert(res);
@@ -43,9 +43,10 @@ int main(int argc, char **argv) {
     }
 
     // consume existing key after one  should be available
+    // keys 0 and 1 are refilled to capacity by now and evicted
     {
-      assert(store.consume(2, t0 + 101) == true);
-      assert(store.exact_size() == 3);
+      assert(store.consume(2, t0 + 101, 5) == true);
+      assert(store.exact_size() == 1);
       auto res = store.get(2);
       assert(res);
       assert(res->key() == 2);
@@ -54,10 +55,10 @@ int main(int argc, char **argv) {
       assert(res->event_time() == t0 + 101);// more than full time period so reset
     }
 
-    // delete existing key 
+    // delete evicted key
     {
       store.del(1);
-      assert(store.exact_size() == 2);
+      assert(store.exact_size() == 1);
       auto res = store.get(1);
       assert(res);
       assert(res->key() == 1);
@@ -65,6 +66,19 @@ int main(int argc, char **argv) {
       assert(*res->value() == 2);
       assert(res->event_time() == -1);
     }
+
+    // a drained bucket is kept until it is refilled
+    {
+      store.consume(3, t0 + 200, 6);
+      store.consume(3, t0 + 200, 7);
+      assert(store.consume(3, t0 + 200, 8) == false);
+      store.garbage_collect(t0 + 250);
+      assert(store.exact_size() == 1);
+      store.garbage_collect(t0 + 310);
+      assert(store.exact_size() == 0);
+      auto res = store.get(3);
+      assert(*res->value() == 2);
+    }
   }
   return 0;
 }
@@ -0,0 +1,76 @@
+#include <cassert>
+#include <kspp/state_stores/rocksdb_token_bucket_store.h>
+#include <kspp/internal/serdes/binary_serdes.h>
+#include <kspp/utils/env.h>
+
+using namespace std::chrono_literals;
+
+int main(int argc, char **argv) {
+  FLAGS_logtostderr = 1;
+  google::InitGoogleLogging(argv[0]);
+
+  std::experimental::filesystem::path path = kspp::default_statestore_root();
+  path /= "test3_rocksdb_token_bucket";
+
+  if (std::experimental::filesystem::exists(path))
+    std::experimental::filesystem::remove_all(path);
+
+  auto t0 = kspp::milliseconds_since_epoch();
+  {
+    kspp::rocksdb_token_bucket_store<int32_t, size_t, kspp::binary_serdes> store(path, 100ms, 2);
+    assert(store.consume(0, t0, 0) == true);
+    assert(store.consume(1, t0, 1) == true);
+    assert(store.consume(2, t0, 2) == true);
+    assert(store.exact_size() == 3);
+
+    // consume existing key
+    {
+      assert(store.consume(2, t0 + 10, 3) == true);
+      auto res = store.get(2);
+      assert(res);
+      assert(res->key() == 2);
+      assert(res->value());
+      assert(*res->value() == 0);
+      assert(res->event_time() == t0); // less than one item so not incremented
+    }
+
+    // consume existing key to fast
+    {
+      assert(store.consume(2, t0 + 20, 4) == false);
+      auto res = store.get(2);
+      assert(*res->value() == 0);
+    }
+
+    // delete existing key
+    {
+      store.del(1);
+      assert(store.exact_size() == 2);
+      auto res = store.get(1);
+      assert(res);
+      assert(*res->value() == 2);
+      assert(res->event_time() == -1);
+    }
+
+    // offset is persisted on commit
+    {
+      store.insert(std::make_shared<kspp::krecord<int32_t, size_t>>(2, 0, t0 + 20), 42);
+      store.commit(true);
+      assert(store.offset() == 42);
+    }
+  }
+
+  // state survives a restart
+  {
+    kspp::rocksdb_token_bucket_store<int32_t, size_t, kspp::binary_serdes> store(path, 100ms, 2);
+    assert(store.exact_size() == 2);
+    assert(store.offset() == 42);
+    assert(store.consume(2, t0 + 30, 43) == false);
+    assert(store.consume(2, t0 + 101, 44) == true);
+    assert(store.offset() == 44);
+  }
+
+  // cleanup
+  std::experimental::filesystem::remove_all(path);
+
+  return 0;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <sstream>
+#include <boost/program_options.hpp>
+#include <avro/DataFile.hh>
+#include <kspp/kspp.h>
+#include <kspp/avro/generic_avro.h>
+#include <kspp/utils/env.h>
+#include <kspp/utils/mmap_file.h>
+
+#define SERVICE_NAME     "avro2mmap"
+
+/*
+ * converts an avro file (ie written by kafka2avro) to a mmap file that can be used by
+ * kspp::mmap_store<std::string, kspp::generic_avro, kspp::avro_serdes>
+ * the value schema is registered in the schema registry so the store can decode the values
+ */
+int main(int argc, char** argv) {
+  FLAGS_logtostderr = 1;
+  google::InitGoogleLogging(argv[0]);
+
+  boost::program_options::options_description desc("options");
+  desc.add_options()
+      ("help", "produce help message")
+      ("src", boost::program_options::value<std::string>(), "src")
+      ("dst", boost::program_options::value<std::string>(), "dst")
+      ("key", boost::program_options::value<std::string>(), "key")
+      ("subject", boost::program_options::value<std::string>(), "subject")
+      ;
+
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+  boost::program_options::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  std::string src;
+  if (vm.count("src")) {
+    src = vm["src"].as<std::string>();
+  }
+
+  if (src.empty()){
+    std::cerr << "src must be specified" << std::endl;
+    return -1;
+  }
+
+  std::string dst;
+  if (vm.count("dst")) {
+    dst = vm["dst"].as<std::string>();
+  }
+
+  if (dst.empty()){
+    std::cerr << "dst must be specified" << std::endl;
+    return -1;
+  }
+
+  std::string key;
+  if (vm.count("key")) {
+    key = vm["key"].as<std::string>();
+  }
+
+  if (key.empty()){
+    std::cerr << "key must be specified" << std::endl;
+    return -1;
+  }
+
+  std::string subject;
+  if (vm.count("subject")) {
+    subject = vm["subject"].as<std::string>();
+  } else {
+    subject = std::experimental::filesystem::path(dst).stem().generic_string() + "-value";
+  }
+
+  auto config = std::make_shared<kspp::cluster_config>("", kspp::cluster_config::SCHEMA_REGISTRY);
+  config->load_config_from_env();
+
+  LOG(INFO) << "src                    : " << src;
+  LOG(INFO) << "dst                    : " << dst;
+  LOG(INFO) << "key                    : " << key;
+  LOG(INFO) << "subject                : " << subject;
+
+  config->validate();
+  config->log();
+
+  auto serdes = config->avro_serdes();
+
+  avro::DataFileReader<kspp::generic_avro> reader(src.c_str());
+  auto valid_schema = std::make_shared<const avro::ValidSchema>(reader.dataSchema());
+  int32_t schema_id = serdes->register_schema(subject, kspp::generic_avro(valid_schema, -1));
+  if (schema_id < 0) {
+    LOG(ERROR) << "failed to register schema for " << subject;
+    return -1;
+  }
+
+  kspp::mmap_file_writer writer(dst);
+  size_t skipped = 0;
+  auto datum = std::make_shared<kspp::generic_avro>(valid_schema, schema_id);
+  while (reader.read(*datum)) {
+    auto k = datum->record().get_optional_as_string(key);
+    if (!k) {
+      ++skipped;
+      continue;
+    }
+    std::stringstream ks;
+    std::stringstream vs;
+    serdes->encode(*k, ks);
+    serdes->encode(*datum, vs);
+    writer.add(ks.str(), vs.str());
+  }
+
+  LOG(INFO) << "read " << writer.size() << " records, skipped " << skipped << " records without key";
+
+  if (!writer.close()) {
+    LOG(ERROR) << "failed to write " << dst;
+    return -1;
+  }
+  return 0;
+}
@@ -136,13 +136,15 @@ public:
           const std::string &schemaFile,
           const std::string &headerFile,
           const std::string &includePrefix,
-          bool noUnion)
+          bool noUnion,
+          bool fastCodec)
       : unionNumber_(0)
       , os_(os)
       , schemaFile_(schemaFile)
       , headerFile_(headerFile)
       , includePrefix_(includePrefix)
-      , noUnion_(noUnion) {
+      , noUnion_(noUnion)
+      , fastCodec_(fastCodec) {
   }
 
   void generate(const ValidSchema &schema);
@@ -172,6 +174,14 @@ public:
 
   void generateUnionTraits(const NodePtr &n);
 
+  void generateFastTraits(const NodePtr &n);
+
+  void generateFastEnumTraits(const NodePtr &n);
+
+  void generateFastRecordTraits(const NodePtr &n);
+
+  void generateFastUnionTraits(const NodePtr &n);
+
   void generateExtensions(const ValidSchema &schema);
 
   void generateNsDecraration(const NodePtr &n);
@@ -185,6 +195,7 @@ private:
   const std::string headerFile_;
   const std::string includePrefix_;
   const bool noUnion_;
+  const bool fastCodec_;
   std::string escaped_schema_string_;
   std::string root_name_;
 
@@ -193,6 +204,7 @@ private:
 
   map<NodePtr, string> done;
   set<NodePtr> doing;
+  set<NodePtr> fastDone;
 };
 
 string CodeGen::generateEnumType(const NodePtr &n) {
@@ -724,6 +736,117 @@ void CodeGen::generateTraits(const NodePtr &n) {
   }
 }
 
+/**
+ * kspp::avro_fast_codec_traits - straight line codecs on raw buffers, no virtual calls per field
+ * only the writer schema is supported, schema evolution goes through the generic avro codecs
+ */
+void CodeGen::generateFastEnumTraits(const NodePtr &n) {
+  string fn = fullname_cpp(n->name());
+  size_t c = n->names();
+  os_ << "template<> struct avro_fast_codec_traits<" << fn << "> {\n"
+      << "  static inline void encode(avro_fast::writer& w, " << fn << " v) {\n"
+      << "    if ((size_t) v >= " << c << ")\n"
+      << "      throw ::avro::Exception(\"enum value is out of bound for " << fn << " and cannot be encoded\");\n"
+      << "    w.write_long(v);\n"
+      << "  }\n"
+      << "  static inline void decode(avro_fast::reader& r, " << fn << "& v) {\n"
+      << "    int64_t index = r.read_long();\n"
+      << "    if (index < 0 || index >= " << c << ")\n"
+      << "      throw ::avro::Exception(\"enum value is out of bound for " << fn << " and cannot be decoded\");\n"
+      << "    v = static_cast<" << fn << ">(index);\n"
+      << "  }\n"
+      << "};\n\n";
+}
+
+void CodeGen::generateFastRecordTraits(const NodePtr &n) {
+  size_t c = n->leaves();
+  for (size_t i = 0; i < c; ++i) {
+    generateFastTraits(n->leafAt(i));
+  }
+
+  string fn = fullname_cpp(n->name());
+  os_ << "template<> struct avro_fast_codec_traits<" << fn << "> {\n"
+      << "  static inline void encode(avro_fast::writer& w, const " << fn << "& v) {\n";
+  for (size_t i = 0; i < c; ++i) {
+    os_ << "    avro_fast::encode(w, v." << n->nameAt(i) << ");\n";
+  }
+  os_ << "  }\n"
+      << "  static inline void decode(avro_fast::reader& r, " << fn << "& v) {\n";
+  for (size_t i = 0; i < c; ++i) {
+    os_ << "    avro_fast::decode(r, v." << n->nameAt(i) << ");\n";
+  }
+  os_ << "  }\n"
+      << "};\n\n";
+}
+
+void CodeGen::generateFastUnionTraits(const NodePtr &n) {
+  size_t c = n->leaves();
+  for (size_t i = 0; i < c; ++i) {
+    generateFastTraits(n->leafAt(i));
+  }
+
+  string fn = fullname_cpp(done[n]);
+  os_ << "template<> struct avro_fast_codec_traits<" << fn << "> {\n"
+      << "  static inline void encode(avro_fast::writer& w, const " << fn << "& v) {\n"
+      << "    w.write_long(v.idx());\n"
+      << "    switch (v.idx()) {\n";
+  for (size_t i = 0; i < c; ++i) {
+    const NodePtr &nn = n->leafAt(i);
+    if (nn->type() == avro::AVRO_NULL)
+      continue;
+    os_ << "    case " << i << ":\n"
+        << "      avro_fast::encode(w, v.get_" << cppNameOf(nn) << "());\n"
+        << "      break;\n";
+  }
+  os_ << "    }\n"
+      << "  }\n"
+      << "  static inline void decode(avro_fast::reader& r, " << fn << "& v) {\n"
+      << "    int64_t n = r.read_long();\n"
+      << "    switch (n) {\n";
+  for (size_t i = 0; i < c; ++i) {
+    const NodePtr &nn = n->leafAt(i);
+    os_ << "    case " << i << ":\n";
+    if (nn->type() == avro::AVRO_NULL) {
+      os_ << "      v.set_null();\n";
+    } else {
+      os_ << "      {\n"
+          << "        " << cppTypeOf(nn) << " vv;\n"
+          << "        avro_fast::decode(r, vv);\n"
+          << "        v.set_" << cppNameOf(nn) << "(vv);\n"
+          << "      }\n";
+    }
+    os_ << "      break;\n";
+  }
+  os_ << "    default:\n"
+      << "      throw ::avro::Exception(\"Union index too big\");\n"
+      << "    }\n"
+      << "  }\n"
+      << "};\n\n";
+}
+
+void CodeGen::generateFastTraits(const NodePtr &n) {
+  if (fastDone.find(n) != fastDone.end())
+    return;
+  fastDone.insert(n);
+  switch (n->type()) {
+    case avro::AVRO_RECORD:
+      generateFastRecordTraits(n);
+      break;
+    case avro::AVRO_ENUM:
+      generateFastEnumTraits(n);
+      break;
+    case avro::AVRO_ARRAY:
+    case avro::AVRO_MAP:
+      generateFastTraits(n->leafAt(n->type() == avro::AVRO_ARRAY ? 0 : 1));
+      break;
+    case avro::AVRO_UNION:
+      generateFastUnionTraits(n);
+      break;
+    default:
+      break;
+  }
+}
+
 template<class OutIter>
 static OutIter escape_string(std::string const &s, OutIter out) {
   //*out++ = '"';
@@ -779,8 +902,10 @@ void CodeGen::generate(const ValidSchema &schema) {
       << "#include \"" << includePrefix_ << "Specific.hh\"\n"
       << "#include \"" << includePrefix_ << "Encoder.hh\"\n"
       << "#include \"" << includePrefix_ << "Decoder.hh\"\n"
-      << "#include \"" << includePrefix_ << "Compiler.hh\"\n"
-      << "#pragma once\n"
+      << "#include \"" << includePrefix_ << "Compiler.hh\"\n";
+  if (fastCodec_)
+    os_ << "#include <kspp/avro/avro_fast_codec.h>\n";
+  os_ << "#pragma once\n"
       << "\n";
 
   const NodePtr &root = schema.root();
@@ -813,6 +938,13 @@ void CodeGen::generate(const ValidSchema &schema) {
   generateTraits(root);
 
   os_ << "}\n";
+
+  if (fastCodec_) {
+    os_ << "\n";
+    os_ << "namespace kspp {\n";
+    generateFastTraits(root);
+    os_ << "}\n";
+  }
   os_.flush();
 }
 
@@ -823,6 +955,7 @@ static const string OUT("output");
 static const string IN("input");
 static const string INCLUDE_PREFIX("include-prefix");
 static const string NO_UNION_TYPEDEF("no-union-typedef");
+static const string FAST_CODEC("fast-codec");
 
 static string readGuard(const string &filename) {
   std::ifstream ifs(filename.c_str());
@@ -852,6 +985,7 @@ int main(int argc, char **argv) {
           ("include-prefix,p", po::value<string>()->default_value("avro"),
            "prefix for include headers, - for none, default: avro")
           ("no-union-typedef,U", "do not generate typedefs for unions in records")
+          ("fast-codec,f", "also generate straight line codecs for kspp::avro_fast_serdes")
           ("input,i", po::value<string>(), "input file")
           ("output,o", po::value<string>(), "output file to generate");
 
@@ -868,6 +1002,7 @@ int main(int argc, char **argv) {
   string inf = vm.count(IN) > 0 ? vm[IN].as<string>() : string();
   string incPrefix = vm[INCLUDE_PREFIX].as<string>();
   bool noUnion = vm.count(NO_UNION_TYPEDEF) != 0;
+  bool fastCodec = vm.count(FAST_CODEC) != 0;
   if (incPrefix == "-") {
     incPrefix.clear();
   } else if (*incPrefix.rbegin() != '/') {
@@ -895,9 +1030,9 @@ int main(int argc, char **argv) {
         }
       }
       ofstream out(outf.c_str());
-      CodeGen(out, inf, outf, incPrefix, noUnion).generate(schema);
+      CodeGen(out, inf, outf, incPrefix, noUnion, fastCodec).generate(schema);
     } else {
-      CodeGen(std::cout, inf, outf,  incPrefix, noUnion).generate(schema);
+      CodeGen(std::cout, inf, outf,  incPrefix, noUnion, fastCodec).generate(schema);
     }
     return 0;
   } catch (std::exception &e) {